@@ -0,0 +1,45 @@
+#ifndef ANALOG_FILTER_H
+#define ANALOG_FILTER_H
+
+#include <stdint.h>
+#include "ModbusMap.h"
+
+#define ANALOG_FILTER_CHANNEL_COUNT     4
+#define ANALOG_FILTER_MAX_WINDOW        16   // Cửa sổ lớn nhất của trung bình trượt
+#define ANALOG_FILTER_MAX_MEDIAN        5    // Số mẫu lớn nhất của bộ lọc trung vị
+#define ANALOG_FILTER_IIR_MAX_SHIFT     8    // alpha = 1 / 2^param
+#define ANALOG_FILTER_IIR_FRAC_BITS     16
+
+/* Loại bộ lọc - giá trị thanh ghi REG_ANALOG_x_FILTER_TYPE */
+typedef enum
+{
+    ANALOG_FILTER_NONE = 0,             // Không lọc
+    ANALOG_FILTER_MOVING_AVERAGE = 1,   // Trung bình trượt, param = số mẫu (1-16)
+    ANALOG_FILTER_IIR = 2,              // IIR bậc 1, param = k với alpha = 1/2^k (1-8)
+    ANALOG_FILTER_MEDIAN = 3            // Trung vị, param = số mẫu (3 hoặc 5)
+} Analog_Filter_Type_t;
+
+/* Trạng thái bộ lọc của một kênh - cấp phát tĩnh, O(1) mỗi mẫu */
+typedef struct
+{
+    uint8_t type;
+    uint8_t param;
+    uint8_t count;                      // Số mẫu hợp lệ trong cửa sổ
+    uint8_t index;                      // Vị trí ghi mẫu tiếp theo
+    uint16_t window[ANALOG_FILTER_MAX_WINDOW];
+    uint32_t sum;                       // Tổng chạy của trung bình trượt
+    int32_t iir_state;                  // Trạng thái IIR (Q.ANALOG_FILTER_IIR_FRAC_BITS)
+
+    /* Cấu hình mới do task ghi, ISR áp dụng ở mẫu kế tiếp */
+    volatile uint8_t pending_type;
+    volatile uint8_t pending_param;
+    volatile uint8_t pending;
+} Analog_Filter_t;
+
+extern Analog_Filter_t g_analog_filters[ANALOG_FILTER_CHANNEL_COUNT];
+
+void Analog_Filter_Init(void);
+void Analog_Filter_Configure(uint8_t channel, uint8_t type, uint8_t param);
+uint16_t Analog_Filter_Process(uint8_t channel, uint16_t sample);
+
+#endif
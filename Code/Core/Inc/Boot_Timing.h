@@ -0,0 +1,45 @@
+#ifndef BOOT_TIMING_H
+#define BOOT_TIMING_H
+
+#include <stdint.h>
+#include "main.h"
+#include "ModbusMap.h"
+
+/* Mốc thời gian khởi động (us tính từ đầu main), đo bằng DWT CYCCNT. Mỗi khoảng được quy đổi
+ * theo SystemCoreClock lúc bắt đầu khoảng đó (HSI 8 MHz trước SystemClock_Config). */
+
+/* Các pha - thứ tự này là thứ tự trong input registers */
+typedef enum
+{
+    BOOT_PHASE_SAFE_OUTPUTS = 0,        // RELAY1/LED1 ở trạng thái an toàn
+    BOOT_PHASE_CLOCK,                   // SystemClock_Config xong
+    BOOT_PHASE_CONFIG,                  // Thanh ghi mặc định + cấu hình từ flash
+    BOOT_PHASE_PERIPHERALS,             // MX_*_Init và Safety_Monitor_Init (ADC đang chạy)
+    BOOT_PHASE_SCHEDULER,               // Safety task chạy lệnh đầu tiên
+    BOOT_PHASE_FIRST_EVALUATION,        // Vòng safety đầu tiên xong - relay do đánh giá điều khiển
+    BOOT_PHASE_MODBUS_READY,            // UART bắt đầu nhận
+    BOOT_PHASE_COUNT
+} Boot_Phase_t;
+
+/* Bit của INPUT_REG_BOOT_STATUS */
+#define BOOT_STATUS_CONFIG_RESTORED     0x0001U     // Cấu hình được nạp từ flash (0 = mặc định)
+
+_Static_assert(BOOT_PHASE_COUNT * 2 == INPUT_REG_BOOT_COUNT,
+               "INPUT_REG_BOOT_COUNT does not match the boot phases");
+
+/**
+ * @brief Bật bộ đếm chu kỳ và lấy mốc 0 - gọi ngay sau HAL_Init()
+ */
+void Boot_Timing_Start(void);
+
+/**
+ * @brief Ghi thời điểm kết thúc một pha vào input registers (32 bit, word cao trước)
+ */
+void Boot_Timing_Mark(Boot_Phase_t phase);
+
+/**
+ * @brief Bật bit trạng thái khởi động (BOOT_STATUS_*)
+ */
+void Boot_Timing_Set_Status(uint16_t flags);
+
+#endif
@@ -0,0 +1,74 @@
+#ifndef CONFIG_STORE_H
+#define CONFIG_STORE_H
+
+#include <stdint.h>
+#include "main.h"
+#include "ModbusMap.h"
+
+/* Lưu thanh ghi cấu hình vào 4 KB flash cuối (0x0800F000-0x0800FFFF, đã bỏ khỏi vùng FLASH
+ * trong STM32F103C8TX_FLASH.ld). Hai bank x 2 trang dùng luân phiên:
+ *  - Mỗi lần ghi là một bản ghi (địa chỉ, giá trị, CRC) nối vào cuối bank đang dùng.
+ *  - Bank đầy thì chép giá trị hiện tại của mọi thanh ghi được lưu sang bank kia (đã xóa trắng),
+ *    ghi header (thế hệ + 1) sau cùng - mất điện giữa chừng vẫn còn một bank hợp lệ.
+ *  - Bank cũ được xóa sau, từng trang một, chỉ khi RELAY1 đã cắt hoặc master ra lệnh
+ *    REG_CONFIG_ERASE_COMMAND. Trong lúc chờ, bank dự phòng chưa trắng thì lần chép kế tiếp
+ *    (và các giá trị mới) chờ theo.
+ * Lúc ghi/xóa flash CPU dừng đọc lệnh (F1 chỉ có một bank flash, kể cả ISR): mỗi halfword
+ * tới 70 us, giữa hai halfword task ưu tiên cao hơn chạy bình thường; mỗi trang xóa tới 40 ms,
+ * lớn hơn cả REG_SAFETY_RESPONSE_TIME nhỏ - vì vậy mới chỉ xóa khi đầu ra đã an toàn. */
+#define CONFIG_STORE_BASE           0x0800F000UL
+#define CONFIG_STORE_PAGE_SIZE      0x400UL     // FLASH_PAGE_SIZE của STM32F103x8/xB
+#define CONFIG_STORE_BANK_PAGES     2U
+#define CONFIG_STORE_BANK_SIZE      (CONFIG_STORE_BANK_PAGES * CONFIG_STORE_PAGE_SIZE)
+#define CONFIG_STORE_BANK_COUNT     2U
+
+#define CONFIG_STORE_MAGIC          0xC5F6U
+#define CONFIG_STORE_LAYOUT         1U          // Tăng khi danh sách thanh ghi được lưu đổi địa chỉ -> bỏ dữ liệu cũ
+#define CONFIG_STORE_SERVICE_MS     100U        // Chu kỳ software timer
+#define CONFIG_STORE_COALESCE_MS    1000U       // Master ngừng ghi chừng này thì mới ghi flash
+
+/* Header đầu mỗi bank - ghi sau cùng khi chép bank */
+typedef struct
+{
+    uint16_t magic;
+    uint16_t layout;
+    uint16_t generation;                // Bank hợp lệ có thế hệ mới hơn là bank đang dùng
+    uint16_t crc;
+} Config_Store_Header_t;
+
+/* Một bản ghi trong log - ô còn xóa (0xFFFF x 3) là cuối log */
+typedef struct
+{
+    uint16_t addr;
+    uint16_t value;
+    uint16_t crc;                       // CRC-16/MODBUS của addr, value
+} Config_Store_Record_t;
+
+/**
+ * @brief Nạp cấu hình mới nhất từ flash vào g_holdingRegisters
+ * @return HAL_StatusTypeDef HAL_ERROR nếu flash chưa có bank hợp lệ (giữ giá trị mặc định)
+ * @note Gọi sau initializeModbusRegisters() và trước Safety_Monitor_Init(); đánh dấu mọi nhóm
+ *       cấu hình để Safety_Register_Load áp dụng ở chu kỳ đầu.
+ */
+HAL_StatusTypeDef Config_Store_Restore(void);
+
+/**
+ * @brief Đánh dấu các thanh ghi được lưu trong [addr, addr + qty) cần ghi xuống flash
+ * @note Gọi từ markRegistersDirty (modbusTask) - chỉ set bit, không chạm flash
+ */
+void Config_Store_Mark_Dirty(uint16_t addr, uint16_t qty);
+
+/**
+ * @brief Software timer chu kỳ CONFIG_STORE_SERVICE_MS (chạy trong timer task, ưu tiên thấp)
+ * @note Gộp các lần ghi: chỉ ghi flash khi master đã ngừng ghi CONFIG_STORE_COALESCE_MS,
+ *       mỗi thanh ghi một bản ghi, bỏ qua thanh ghi có giá trị trùng bản ghi mới nhất.
+ */
+void Config_Store_Service(void *argument);
+
+/**
+ * @brief Cho phép xóa bank dự phòng ở lần Config_Store_Service kế tiếp dù RELAY1 chưa cắt
+ * @note Gọi khi master ghi 1 vào REG_CONFIG_ERASE_COMMAND; thanh ghi về 0 khi bank đã trắng
+ */
+void Config_Store_Request_Erase(void);
+
+#endif
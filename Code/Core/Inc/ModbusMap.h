@@ -14,6 +14,23 @@
 #define REG_SYSTEM_STATUS          0x0107
 #define REG_SYSTEM_ERROR           0x0108
 #define REG_RESET_ERROR_COMMAND    0x0109
+#define REG_PROFILER_RESET_COMMAND 0x010A  // Ghi 1 để xóa thống kê profiler
+#define REG_CONFIG_ERASE_COMMAND   0x010B  // Ghi 1 để xóa flash cấu hình dự phòng dù relay chưa cắt
+
+// Status Snapshot (FC3, chỉ đọc) - chụp một lần mỗi chu kỳ safety, một lệnh FC3 đọc trọn khối
+#define REG_SNAPSHOT_BASE          0x0110
+#define REG_SNAPSHOT_SEQUENCE      0x0110  // Tăng mỗi chu kỳ safety
+#define REG_SNAPSHOT_SYSTEM_STATUS 0x0111  // Như REG_SAFETY_SYSTEM_STATUS
+#define REG_SNAPSHOT_RESET_FLAG    0x0112  // Như REG_RESET_FLAG (1 = relay đang cắt, chờ reset)
+#define REG_SNAPSHOT_ERROR_CODE    0x0113  // Như REG_SAFETY_ERROR_CODE
+#define REG_SNAPSHOT_ANALOG_1      0x0114  // Khoảng cách AI1..AI4 (0x0114-0x0117)
+#define REG_SNAPSHOT_DI_STATE      0x0118  // Bit n = DIn_Status
+#define REG_SNAPSHOT_ANALOG_STATUS 0x0119  // 4 bit mỗi kênh: SENSOR_STATUS_x của AI1 ở bit 0-3
+#define REG_SNAPSHOT_DI_STATUS     0x011A  // 4 bit mỗi kênh: SENSOR_STATUS_x của DI1 ở bit 0-3
+#define REG_SNAPSHOT_SYSTEM_ERROR  0x011B  // Như REG_SYSTEM_ERROR
+#define REG_SNAPSHOT_LOOP_OVERRUN  0x011C  // Số lần vòng safety trễ hạn (32 bit, word cao trước)
+#define REG_SNAPSHOT_COUNT         14
+#define REG_SNAPSHOT_LAST          (REG_SNAPSHOT_BASE + REG_SNAPSHOT_COUNT - 1)   // 0x011D
 
 
 // Motor 1 Registers (Base Address: 0x0010)
@@ -41,10 +58,10 @@
 #define REG_ANALOG_2_ENABLE        0x001B
 #define REG_ANALOG_3_ENABLE        0x001C
 #define REG_ANALOG_4_ENABLE        0x001D
-#define REG_ANALOG_1_OFFSET        0x001E
-#define REG_ANALOG_2_OFFSET        0x001F
-#define REG_ANALOG_3_OFFSET        0x0020
-#define REG_ANALOG_4_OFFSET        0x0021
+#define REG_ANALOG_1_OFFSET        0x001E  // Offset khoảng cách AI1 (int16, x100)
+#define REG_ANALOG_2_OFFSET        0x001F  // Offset khoảng cách AI2 (int16, x100)
+#define REG_ANALOG_3_OFFSET        0x0020  // Offset khoảng cách AI3 (int16, x100)
+#define REG_ANALOG_4_OFFSET        0x0021  // Offset khoảng cách AI4 (int16, x100)
 
 
 // Digital Input Registers
@@ -60,6 +77,17 @@
 #define REG_DI2_ACTIVE_LEVEL       0x002B
 #define REG_DI3_ACTIVE_LEVEL       0x002C
 #define REG_DI4_ACTIVE_LEVEL       0x002D
+#define REG_DI_DEBOUNCE_TIME       0x002E  // Debounce time for DI1-DI4 (ms)
+
+// Analog Filter Registers
+#define REG_ANALOG_1_FILTER_TYPE   0x0030  // Filter type AI1 (0=None, 1=Moving avg, 2=IIR, 3=Median)
+#define REG_ANALOG_2_FILTER_TYPE   0x0031  // Filter type AI2
+#define REG_ANALOG_3_FILTER_TYPE   0x0032  // Filter type AI3
+#define REG_ANALOG_4_FILTER_TYPE   0x0033  // Filter type AI4
+#define REG_ANALOG_1_FILTER_PARAM  0x0034  // Window length / IIR shift / median size AI1
+#define REG_ANALOG_2_FILTER_PARAM  0x0035  // Filter parameter AI2
+#define REG_ANALOG_3_FILTER_PARAM  0x0036  // Filter parameter AI3
+#define REG_ANALOG_4_FILTER_PARAM  0x0037  // Filter parameter AI4
 
 // Relay Output Control Registers  
 #define REG_RELAY1_CONTROL         0x0040  // Control Relay Output 1
@@ -76,6 +104,55 @@
 #define REG_SAFETY_RESPONSE_TIME   0x0049  // Safety response time (ms)
 #define REG_AUTO_RESET_ENABLE      0x004A  // Enable auto reset (0=Off, 1=On)
 #define REG_SAFETY_MODE            0x004B  // Safety mode (1=Normal, 2=Warning, 3=Protective Stop, 4=Emergency Stop)
+#define REG_SAFETY_LOOP_PERIOD     0x004C  // Safety loop period (ms, 1-100)
+
+// Hiệu chuẩn riêng từng kênh - 0 = dùng REG_ANALOG_COEFFICIENT / REG_ANALOG_CALIBRATION chung
+#define REG_ANALOG_1_GAIN          0x0050  // AI1 gain (x100)
+#define REG_ANALOG_2_GAIN          0x0051  // AI2 gain (x100)
+#define REG_ANALOG_3_GAIN          0x0052  // AI3 gain (x100)
+#define REG_ANALOG_4_GAIN          0x0053  // AI4 gain (x100)
+#define REG_ANALOG_1_EXPONENT      0x0054  // AI1 exponent (x100)
+#define REG_ANALOG_2_EXPONENT      0x0055  // AI2 exponent (x100)
+#define REG_ANALOG_3_EXPONENT      0x0056  // AI3 exponent (x100)
+#define REG_ANALOG_4_EXPONENT      0x0057  // AI4 exponent (x100)
+
+// Mô hình cảm biến từng kênh (0 = luật lũy thừa gain/exponent/offset, 1 = đường cong điểm gãy)
+#define REG_ANALOG_1_MODEL         0x0058
+#define REG_ANALOG_2_MODEL         0x0059
+#define REG_ANALOG_3_MODEL         0x005A
+#define REG_ANALOG_4_MODEL         0x005B
+
+// Đường cong điểm gãy: mỗi kênh một khối liên tiếp [số điểm, mã ADC 1, giá trị 1, mã ADC 2, giá trị 2, ...]
+// để master nạp cả đường cong bằng một lệnh FC16. Mã ADC tăng dần (0-ADC_CODE_MAX), giá trị int16
+// cùng đơn vị với REG_SAFETY_ZONEx_THRESHOLD.
+#define ANALOG_CURVE_MAX_POINTS    16
+#define REG_ANALOG_CURVE_STRIDE    (1 + 2 * ANALOG_CURVE_MAX_POINTS)
+#define REG_ANALOG_CURVE_BASE      0x0060
+#define REG_ANALOG_CURVE(ch)       (REG_ANALOG_CURVE_BASE + (ch) * REG_ANALOG_CURVE_STRIDE)
+#define REG_ANALOG_CURVE_LAST      (REG_ANALOG_CURVE(4) - 1)   // 0x00E3
+
+// Input Registers (FC4) - Profiler, mỗi đoạn 16 thanh ghi (xem Profiler.h)
+#define INPUT_REG_PROFILER_BASE    0x0010
+#define INPUT_REG_PROFILER_COUNT   80      // 5 đoạn x 16 thanh ghi
+// Input Registers (FC4) - Thời gian phản ứng an toàn (xem Safety_Reaction_Stats_t)
+#define INPUT_REG_REACTION_BASE    0x0060
+#define INPUT_REG_REACTION_COUNT   18      // count(2) last(2) worst(2) over_budget(2) hist(10)
+// Input Registers (FC4) - Số lần vòng safety trễ hạn (32 bit, word cao trước)
+#define INPUT_REG_LOOP_OVERRUN     0x0072
+#define INPUT_REG_LOOP_COUNT       2
+// Input Registers (FC4) - Mốc khởi động, us từ đầu main (32 bit, word cao trước, xem Boot_Timing.h)
+#define INPUT_REG_BOOT_BASE        0x0074
+#define INPUT_REG_BOOT_COUNT       14      // 7 pha x 2 thanh ghi
+#define INPUT_REG_BOOT_STATUS      0x0082  // Bit 0: cấu hình nạp từ flash
+// Input Registers (FC4) - Hàng đợi khung nhận Modbus (32 bit, word cao trước)
+#define INPUT_REG_RX_DROPPED       0x0083  // Khung bị bỏ (quá dài hoặc hàng đợi đầy)
+#define INPUT_REG_RX_OVERFLOW      0x0085  // Khung bị bỏ vì hàng đợi đầy
+#define INPUT_REG_RX_QUEUE_PEAK    0x0087  // Số ô hàng đợi dùng nhiều nhất (16 bit)
+
+// Giới hạn giá trị ghi qua Modbus (ngoài giới hạn: exception 3)
+#define LIMIT_SAFETY_THRESHOLD_MAX      30000   // Ngưỡng vùng/proximity, bằng DISTANCE_LUT_MAX
+#define LIMIT_SAFETY_RESPONSE_TIME_MAX  10000   // ms
+#define LIMIT_DI_DEBOUNCE_MAX           1000    // ms
 
 // Total register count  
 #define TOTAL_HOLDING_REG_COUNT    0x0036  // Total number of registers (0x0000-0x0035)
@@ -108,11 +185,18 @@
 #define DEFAULT_ANALOG_2_ENABLE     0
 #define DEFAULT_ANALOG_3_ENABLE     0
 #define DEFAULT_ANALOG_4_ENABLE     0
+#define DEFAULT_ANALOG_FILTER_TYPE  0         // Mặc định không lọc
+#define DEFAULT_ANALOG_FILTER_PARAM 0
+#define DEFAULT_ANALOG_OFFSET       0
+#define DEFAULT_ANALOG_GAIN         0         // 0 = dùng hệ số chung
+#define DEFAULT_ANALOG_EXPONENT     0         // 0 = dùng số mũ chung
+#define DEFAULT_ANALOG_MODEL        0         // Luật lũy thừa
 
 #define DEFAULT_DI1_ENABLE     0
 #define DEFAULT_DI2_ENABLE     0
 #define DEFAULT_DI3_ENABLE     0
 #define DEFAULT_DI4_ENABLE     0
+#define DEFAULT_DI_DEBOUNCE_TIME 5       // Thời gian chống dội DI mặc định (ms)
 #define DEFAULT_RESET_FLAG     0
 #define DEFAULT_RELAY1_CONTROL       0
 #define DEFAULT_RELAY2_CONTROL       0
@@ -127,6 +211,7 @@
 #define DEFAULT_SAFETY_RESPONSE_TIME    50
 #define DEFAULT_AUTO_RESET_ENABLE       0
 #define DEFAULT_SAFETY_MODE             1
+#define DEFAULT_SAFETY_LOOP_PERIOD      1
 
 // Giá trị mặc định cho các thanh ghi Digital Input
 #define DEFAULT_DI1_STATUS          0        // Trạng thái mặc định DI1
@@ -7,6 +7,10 @@
 
 #define OUTPUT_CONTROL_COUNT 4
 
+/* Kênh n = REG_RELAY(n+1)_CONTROL = coil n. Kênh 0 (RELAY1) thuộc safety logic, thanh ghi/coil
+ * của nó không tác động chân. Kênh 1 ra RELAY2 (PB4). Kênh 2-3 không có chân trên bo: chỉ là
+ * thanh ghi lệnh, master đọc lại được nhưng không có tác dụng vật lý. */
+#define OUTPUT_CONTROL_FIRST 1
 
 typedef struct {
     uint8_t output_channel;
@@ -16,7 +20,8 @@ typedef struct {
 extern Output_Control_t g_output_control[OUTPUT_CONTROL_COUNT];
 
 void Output_Control_Init(void);
+// Áp dụng REG_RELAY2..4_CONTROL cho đầu ra - gọi mỗi chu kỳ safety, chỉ ghi chân khi đổi
 void Output_Control_Process(void);
 void Set_Output_Control_State(uint8_t output_channel, uint8_t output_state);
 
-#endif
\ No newline at end of file
+#endif
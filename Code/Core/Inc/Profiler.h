@@ -0,0 +1,92 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <stdint.h>
+#include "ModbusMap.h"
+
+/* Đo thời gian các đoạn code bằng bộ đếm chu kỳ DWT CYCCNT (Cortex-M3).
+ * Đặt PROFILER_ENABLE = 0 thì mọi macro PROFILE_* biến mất khi biên dịch. */
+#ifndef PROFILER_ENABLE
+#define PROFILER_ENABLE             1
+#endif
+
+#define PROFILER_HIST_BUCKETS       8
+#define PROFILER_HIST_BASE_BITS     6   // Bucket 0: < 64 chu kỳ, mỗi bucket sau rộng gấp 4
+#define PROFILER_REGS_PER_SECTION   16  // count(2) min(2) max(2) mean(2) hist(8)
+
+/* Các đoạn được đo - thứ tự này là thứ tự khối trong input registers */
+typedef enum
+{
+    PROFILE_LOOP_PERIOD = 0,        // Khoảng giữa hai lần bắt đầu vòng safety (jitter)
+    PROFILE_REGISTER_LOAD,          // Safety_Register_Load
+    PROFILE_SAFETY_PROCESS,         // Safety_Monitor_Process
+    PROFILE_REGISTER_SAVE,          // Safety_Register_Save
+    PROFILE_MODBUS_FRAME,           // processModbusFrame
+    PROFILE_SECTION_COUNT
+} Profile_Section_t;
+
+typedef struct
+{
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint64_t total;
+    uint32_t last_mark;             // Mốc của PROFILE_MARK trước đó
+    uint32_t hist[PROFILER_HIST_BUCKETS];
+} Profile_Stats_t;
+
+/* Nguồn thời gian dùng chung - luôn có, kể cả khi PROFILER_ENABLE = 0 (đo thời gian phản ứng cần nó) */
+#ifdef SAFETY_HOST_BUILD
+#define PROFILER_TICKS_PER_US       1000U
+uint32_t Fake_Cycle_Counter(void);
+static inline void Profiler_Timebase_Init(void)
+{
+}
+// Bản host: cùng API, đơn vị là ns theo thời gian mô phỏng (Code/Test/Fake)
+static inline uint32_t Profiler_Now(void)
+{
+    return Fake_Cycle_Counter();
+}
+#else
+#include "main.h"
+#define PROFILER_TICKS_PER_US       (SystemCoreClock / 1000000U)
+static inline void Profiler_Timebase_Init(void)
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+static inline uint32_t Profiler_Now(void)
+{
+    return DWT->CYCCNT;
+}
+#endif
+
+#if PROFILER_ENABLE
+
+extern Profile_Stats_t g_profile_stats[PROFILE_SECTION_COUNT];
+
+void Profiler_Init(void);
+void Profiler_Reset(void);
+void Profiler_Record(Profile_Section_t section, uint32_t cycles);
+void Profiler_Mark(Profile_Section_t section);
+void Profiler_Export(uint16_t *regs);
+
+#define PROFILE_BEGIN(section)      uint32_t profile_start_##section = Profiler_Now()
+#define PROFILE_END(section)        Profiler_Record((section), Profiler_Now() - profile_start_##section)
+#define PROFILE_MARK(section)       Profiler_Mark(section)
+#define PROFILE_INIT()              Profiler_Init()
+#define PROFILE_RESET()             Profiler_Reset()
+#define PROFILE_EXPORT(regs)        Profiler_Export(regs)
+
+#else
+
+#define PROFILE_BEGIN(section)      do { } while (0)
+#define PROFILE_END(section)        do { } while (0)
+#define PROFILE_MARK(section)       do { } while (0)
+#define PROFILE_INIT()              do { } while (0)
+#define PROFILE_RESET()             do { } while (0)
+#define PROFILE_EXPORT(regs)        do { (void)(regs); } while (0)
+
+#endif
+
+#endif
@@ -4,6 +4,7 @@
 #include "main.h"
 #include "UartModbus.h"
 #include "ModbusMap.h"
+#include "Profiler.h"
 #include "FreeRTOS.h"
 #include "semphr.h"
 
@@ -13,6 +14,97 @@
 #define SENSOR_NAME_LENGTH          16
 #define ADC_RESOLUTION              4096.0f
 #define ADC_VREF                    3.3f
+#define ADC_NATIVE_MAX              4095U
+
+/* Lấy mẫu ADC: TIM2_CC2 kích ADC1 quét 4 kênh với tần số cố định, DMA vòng ping-pong.
+ * Mỗi nửa bộ đệm cộng ADC_OVERSAMPLE_RATIO mẫu/kênh rồi decimate thành một giá trị. */
+#define ADC_SCAN_RATE_HZ            16000U                              // Tần số quét (mỗi lần 4 kênh)
+#define ADC_OVERSAMPLE_BITS         2U                                  // Số bit hiệu dụng thêm được
+#define ADC_OVERSAMPLE_RATIO        (1U << (2U * ADC_OVERSAMPLE_BITS))  // 16 mẫu -> 14 bit
+#define ADC_DMA_BUFFER_LENGTH       (ADC_OVERSAMPLE_RATIO * ANALOG_SENSOR_COUNT * 2U)
+#define ADC_CODE_BITS               (12U + ADC_OVERSAMPLE_BITS)
+#define ADC_CODE_MAX                (ADC_NATIVE_MAX << ADC_OVERSAMPLE_BITS)
+#define ADC_HALF_BUFFER_US          (ADC_OVERSAMPLE_RATIO * 1000000U / ADC_SCAN_RATE_HZ)  // Thời gian thu một nửa bộ đệm (1 ms)
+
+/* Digital input: DI1-DI4 nằm liên tiếp trên PB12-PB15, đọc cả 4 chân bằng một lần GPIOB->IDR */
+#define DI_GPIO_SHIFT               12U
+#define DI_GPIO_MASK                ((1U << DIGITAL_SENSOR_COUNT) - 1U)
+#define DI_READ_ALL()               ((uint8_t)((DI1_GPIO_Port->IDR >> DI_GPIO_SHIFT) & DI_GPIO_MASK))
+
+/* Đường cắt nhanh trong ISR: vùng 1 (so mã ADC thô) và DI tích cực đóng RELAY1 ngay trong
+ * callback ADC DMA / EXTI, task chỉ chốt trạng thái và ghi thống kê. Đặt 0 để chỉ dùng task. */
+#ifndef SAFETY_FAST_TRIP_ENABLE
+#define SAFETY_FAST_TRIP_ENABLE     1
+#endif
+#define FAST_TRIP_CODE_DISABLED     0xFFFFU  // Lớn hơn mọi mã ADC - kênh không cắt nhanh
+
+/* Chu kỳ vòng safety (REG_SAFETY_LOOP_PERIOD) */
+#define SAFETY_LOOP_PERIOD_MIN_MS   1U
+#define SAFETY_LOOP_PERIOD_MAX_MS   100U
+
+/* Thời gian phản ứng: từ mẫu/sườn vượt ngưỡng đến lúc đóng RELAY1 (đơn vị us) */
+#define REACTION_HIST_BUCKETS       10
+#define REACTION_HIST_BASE_US       250U    // Bucket i: < 250us * 2^i, bucket cuối gom phần còn lại
+
+/* Bit của REG_SAFETY_ERROR_CODE */
+#define SAFETY_ERROR_REACTION_TIME  0x0001  // Thời gian phản ứng vượt REG_SAFETY_RESPONSE_TIME
+#define SAFETY_ERROR_CALIBRATION    0x0002  // Đường cong điểm gãy không hợp lệ, kênh giữ cách đổi trước đó
+#define SAFETY_ERROR_PARAMETERS     0x0004  // Tham số an toàn nạp từ flash không nhất quán, đang dùng mặc định
+
+/* Bộ tham số an toàn REG_SAFETY_ZONE1_THRESHOLD..REG_SAFETY_LOOP_PERIOD: modbusTask ghi vào bản
+ * nháp, kiểm tra cả bộ rồi công bố; safety task nhận bộ mới ở đầu chu kỳ (ba bộ đệm, không khóa) */
+#define SAFETY_PARAM_FIRST          REG_SAFETY_ZONE1_THRESHOLD
+#define SAFETY_PARAM_LAST           REG_SAFETY_LOOP_PERIOD
+#define SAFETY_PARAM_COUNT          (SAFETY_PARAM_LAST - SAFETY_PARAM_FIRST + 1)
+#define SAFETY_PARAM(params, reg)   ((params)->regs[(reg) - SAFETY_PARAM_FIRST])
+
+typedef struct
+{
+    uint16_t regs[SAFETY_PARAM_COUNT];  // Cùng thứ tự với thanh ghi
+} Safety_Params_t;
+
+/* Mô hình cảm biến (REG_ANALOG_x_MODEL) */
+#define ANALOG_MODEL_POWER_LAW      0       // gain/100 * V^(-exponent/100) + offset/100 qua bảng tra
+#define ANALOG_MODEL_CURVE          1       // Đường cong điểm gãy nạp qua Modbus
+
+/* Bảng tra khoảng cách tuyến tính từng đoạn (thay cho powf mỗi chu kỳ) */
+#define DISTANCE_LUT_SEGMENT_BITS   7                                   // 128 đoạn
+#define DISTANCE_LUT_SIZE           ((1U << DISTANCE_LUT_SEGMENT_BITS) + 1U)
+#define DISTANCE_LUT_SHIFT          (ADC_CODE_BITS - DISTANCE_LUT_SEGMENT_BITS)
+#define DISTANCE_LUT_MAX            30000.0f                            // Giới hạn giá trị bảng (vừa Q16.16)
+#define DISTANCE_MIN_VOLTAGE        0.1f                                // Dưới ngưỡng này coi như không có tín hiệu
+#define DISTANCE_VALID_MIN          10                                  // Luật lũy thừa: ngoài [MIN, MAX] coi là lỗi cảm biến
+#define DISTANCE_VALID_MAX          95
+
+/* Phân loại vùng: 1 = so mã ADC thô với ngưỡng tính sẵn khi thanh ghi thay đổi, khoảng cách
+ * (REG_ANALOG_INPUT_x) chỉ tính khi master đọc; 0 = đổi sang khoảng cách mỗi chu kỳ rồi so sánh */
+#ifndef SAFETY_CLASSIFY_RAW_CODE
+#define SAFETY_CLASSIFY_RAW_CODE    1
+#endif
+
+/* Kiểu số của pipeline analog: 1 = fixed-point Q16.16, 0 = float (tham chiếu).
+ * Hai chế độ cho cùng kết quả phân vùng (trừ giá trị sát số nguyên); khoảng cách Q16.16 lệch
+ * khỏi cùng bảng tra nội suy chính xác <= 2/65536 + 2^-23 * |khoảng cách| (Test_Fixed_Point). */
+#ifndef SAFETY_USE_FIXED_POINT
+#define SAFETY_USE_FIXED_POINT      1
+#endif
+
+#if SAFETY_USE_FIXED_POINT
+typedef int32_t Safety_Value_t;                                         // Q16.16
+#define SAFETY_VALUE_FRAC_BITS      16
+#define SAFETY_VALUE_FROM_INT(x)    ((Safety_Value_t)((int32_t)(x) * (1L << SAFETY_VALUE_FRAC_BITS)))
+#define SAFETY_VALUE_TO_INT(x)      ((int32_t)((x) >> SAFETY_VALUE_FRAC_BITS))
+#define SAFETY_VALUE_FROM_FLOAT(x)  ((Safety_Value_t)((x) * (float)(1L << SAFETY_VALUE_FRAC_BITS)))
+#define SAFETY_VALUE_TO_FLOAT(x)    ((float)(x) * (1.0f / (float)(1L << SAFETY_VALUE_FRAC_BITS)))
+#define SAFETY_VALUE_FROM_RATIO(n, d) ((Safety_Value_t)(((int64_t)(n) << SAFETY_VALUE_FRAC_BITS) / (d)))
+#else
+typedef float Safety_Value_t;
+#define SAFETY_VALUE_FROM_INT(x)    ((float)(x))
+#define SAFETY_VALUE_TO_INT(x)      ((int32_t)(x))
+#define SAFETY_VALUE_FROM_FLOAT(x)  ((float)(x))
+#define SAFETY_VALUE_TO_FLOAT(x)    ((float)(x))
+#define SAFETY_VALUE_FROM_RATIO(n, d) ((float)(n) / (float)(d))
+#endif
 
 /* Sensor status flags */
 #define SENSOR_STATUS_OK            0x00
@@ -20,6 +112,17 @@
 #define SENSOR_STATUS_CRITICAL      0x02
 #define SENSOR_STATUS_ERROR         0x04
 
+/* Kết quả phân loại một cảm biến analog */
+typedef enum
+{
+    ANALOG_ZONE_ERROR = 0,          // Luật lũy thừa: ngoài [DISTANCE_VALID_MIN, DISTANCE_VALID_MAX]; đường cong: mã ngoài [điểm đầu, điểm cuối]
+    ANALOG_ZONE_1,                  // <= REG_SAFETY_ZONE1_THRESHOLD
+    ANALOG_ZONE_2,
+    ANALOG_ZONE_3,
+    ANALOG_ZONE_4,
+    ANALOG_ZONE_SAFE
+} Analog_Zone_t;
+
 /* Safety system status */
 typedef enum
 {
@@ -36,27 +139,29 @@ typedef struct
     uint8_t sensor_active;          // Sensor enable/disable flag
     
     
-    float voltage;
-    float filtered_value;           // Filtered value
+    Safety_Value_t voltage;
+    Safety_Value_t filtered_value;  // Filtered value
     
     /* Configuration */
-    float min_range;
-    float max_range;
-    float warning_low;              // Warning low threshold
-    float warning_high;
-    float critical_low;
-    float critical_high;
+    Safety_Value_t min_range;
+    Safety_Value_t max_range;
+    Safety_Value_t warning_low;     // Warning low threshold
+    Safety_Value_t warning_high;
+    Safety_Value_t critical_low;
+    Safety_Value_t critical_high;
     
     /* Calibration */
-    float calibration_offset;       // Calibration offset
-    float calibration_gain;         // Calibration gain
+    Safety_Value_t calibration_gain;    // Gain hiệu lực (REG_ANALOG_x_GAIN hoặc REG_ANALOG_COEFFICIENT) / 100
+    Safety_Value_t calibration_exponent;// Số mũ hiệu lực (REG_ANALOG_x_EXPONENT hoặc REG_ANALOG_CALIBRATION) / 100
+    Safety_Value_t calibration_offset;  // Offset khoảng cách (REG_ANALOG_x_OFFSET / 100)
     
     /* Status and alarms */
     uint8_t sensor_status;          // Current sensor status
     uint8_t alarm_flags;            // Alarm condition flags    
+    uint32_t critical_timestamp;    // Profiler_Now() của mẫu đầu tiên vào vùng CRITICAL
     /* Statistics */
-    float min_recorded;             // Minimum recorded value
-    float max_recorded;             // Maximum recorded value
+    Safety_Value_t min_recorded;    // Minimum recorded value
+    Safety_Value_t max_recorded;    // Maximum recorded value
     uint32_t error_count;           // Error counter
 } Analog_Sensor_t;
 
@@ -80,6 +185,7 @@ typedef struct
     uint8_t rising_edge_detected;   // Rising edge flag
     uint8_t falling_edge_detected;  // Falling edge flag
     uint32_t last_edge_time;        // Last edge detection timestamp
+    uint32_t edge_timestamp;        // Profiler_Now() of the last edge (reaction time start)
     
     /* Status and counters */
     uint8_t sensor_status;          // Current sensor status
@@ -88,6 +194,17 @@ typedef struct
     uint8_t alarm_flags;            // Alarm condition flags
 } Digital_Sensor_t;
 
+/* Thống kê thời gian phản ứng an toàn (mỗi lần chuyển sang CRITICAL) */
+typedef struct
+{
+    uint32_t count;                 // Số lần đo
+    uint32_t last_us;               // Lần gần nhất
+    uint32_t worst_us;              // Lớn nhất từ lần reset lỗi gần nhất
+    uint32_t over_budget_count;     // Số lần vượt REG_SAFETY_RESPONSE_TIME
+    uint32_t budget_us;             // REG_SAFETY_RESPONSE_TIME * 1000
+    uint32_t hist[REACTION_HIST_BUCKETS];
+} Safety_Reaction_Stats_t;
+
 /* Safety system global data structure */
 typedef struct
 {    
@@ -96,6 +213,8 @@ typedef struct
     uint8_t emergency_stop_active;
     uint32_t system_uptime;
     uint32_t last_safety_check;
+    uint16_t loop_period_ms;        // Chu kỳ vòng safety (đã giới hạn)
+    uint32_t loop_overrun_count;    // Số lần vòng safety trễ hạn
     
     /* Statistics */
     uint32_t warning_count;
@@ -111,6 +230,7 @@ typedef struct
 extern Safety_System_Data_t g_safety_system;
 extern Analog_Sensor_t g_analog_sensors[ANALOG_SENSOR_COUNT];
 extern Digital_Sensor_t g_digital_sensors[DIGITAL_SENSOR_COUNT];
+extern Safety_Reaction_Stats_t g_reaction_stats;
 
 /* ========================== FUNCTION DECLARATIONS ========================== */
 
@@ -122,6 +242,19 @@ extern Digital_Sensor_t g_digital_sensors[DIGITAL_SENSOR_COUNT];
  */
 HAL_StatusTypeDef Safety_Monitor_Init(void);
 
+/**
+ * @brief Đưa RELAY1/LED1 về trạng thái cắt an toàn ngay khi khởi động
+ * @note Gọi ngay sau HAL_Init(), trước SystemClock_Config - relay giữ trạng thái này đến khi
+ *       vòng safety đầu tiên đánh giá xong
+ */
+void Safety_Boot_Safe_Outputs(void);
+
+/**
+ * @brief Đã có mẫu ADC decimate đầu tiên chưa
+ * @return uint8_t 1 nếu adc_buffer đã có dữ liệu thật
+ */
+uint8_t Safety_Monitor_Sample_Ready(void);
+
 /**
  * @brief Hàm xử lý giám sát an toàn chính (được gọi từ Safety Task)
  * @param Không có
@@ -198,6 +331,12 @@ HAL_StatusTypeDef Safety_Set_Digital_Enable(uint8_t sensor_id, uint8_t enable);
  */
 Safety_Monitor_Status_t Safety_Get_System_Status(void);
 
+/**
+ * @brief RELAY1 đang ở trạng thái cắt (an toàn)
+ * @return uint8_t 1 nếu đã cắt - lúc này CPU dừng (xóa flash) không làm trễ phản ứng an toàn
+ */
+uint8_t Safety_Outputs_Tripped(void);
+
 /* ========================== CÁC HÀM GIAO TIẾP MODBUS ========================== */
 /**
  * @brief Tải tham số an toàn từ thanh ghi Modbus
@@ -216,8 +355,59 @@ HAL_StatusTypeDef Safety_Register_Save(void);
 /**
  * @brief Chuyển đổi giá trị cảm biến sang khoảng cách
  * @param sensor_id: ID cảm biến (0-3)
- * @return float Giá trị khoảng cách
+ * @return Safety_Value_t Giá trị khoảng cách (Q16.16 hoặc float tùy SAFETY_USE_FIXED_POINT)
+ */
+Safety_Value_t Safety_Convert_To_Distance(uint8_t sensor_id);
+
+/**
+ * @brief Nạp đường cong điểm gãy của một kênh từ khối thanh ghi
+ * @param sensor_id: ID cảm biến (0-3)
+ * @param regs: Khối REG_ANALOG_CURVE(sensor_id) - [số điểm, mã 1, giá trị 1, ...]
+ * @return HAL_StatusTypeDef HAL_ERROR nếu số điểm ngoài 2..ANALOG_CURVE_MAX_POINTS hoặc mã
+ *         không tăng dần; khi đó kênh giữ nguyên cách đổi đang dùng
+ */
+HAL_StatusTypeDef Safety_Load_Sensor_Curve(uint8_t sensor_id, const uint16_t *regs);
+
+/**
+ * @brief Tính lại bảng tra khoảng cách của một kênh
+ * @param sensor_id: ID cảm biến (0-3)
+ * @param gain: Gain x100
+ * @param exponent: Số mũ x100
+ * @param offset: Offset khoảng cách x100 (có dấu)
+ * @return HAL_StatusTypeDef HAL_ERROR nếu sensor_id không hợp lệ
+ * @note Chỉ gọi khi tham số của kênh đó thay đổi - powf chỉ chạy DISTANCE_LUT_SIZE lần mỗi lần tính
+ */
+HAL_StatusTypeDef Safety_Build_Distance_Table(uint8_t sensor_id, uint16_t gain, uint16_t exponent, int16_t offset);
+
+/**
+ * @brief Tính lại các ngưỡng theo mã ADC thô (vùng 1-4, giới hạn lỗi, cắt nhanh) và mức DI cắt nhanh
+ * @note Gọi sau khi bảng tra, REG_SAFETY_ZONEx_THRESHOLD hoặc cấu hình enable/active level thay đổi
+ */
+void Safety_Update_Code_Thresholds(void);
+
+/**
+ * @brief Đưa lệnh ghi Modbus trùng khối tham số an toàn vào bản nháp và công bố nếu cả bộ hợp lệ
+ * @param addr: Địa chỉ đầu của lệnh ghi
+ * @param qty: Số thanh ghi
+ * @param data: Giá trị big-endian như trong khung Modbus (2 * qty byte)
+ * @return HAL_StatusTypeDef HAL_ERROR nếu bộ tham số sau khi ghi không nhất quán (vùng 1-4 không
+ *         tăng ngặt...) - khi đó không có gì thay đổi. HAL_OK nếu lệnh ghi không chạm khối.
+ * @note Chỉ gọi từ modbusTask, sau khi từng giá trị đã qua kiểm tra min/max và trước khi ghi
+ *       thanh ghi. Safety task áp dụng bộ mới ở đầu chu kỳ kế tiếp (Safety_Register_Load).
+ */
+HAL_StatusTypeDef Safety_Params_Stage(uint16_t addr, uint16_t qty, const uint8_t *data);
+
+/**
+ * @brief Tính khoảng cách từ mã ADC hiện tại vào REG_ANALOG_INPUT_x (chế độ SAFETY_CLASSIFY_RAW_CODE)
+ * @note Gọi từ modbusTask khi master đọc FC3 trùng khối REG_ANALOG_INPUT_1..4
+ */
+void Safety_Refresh_Analog_Registers(void);
+
+/**
+ * @brief Chép snapshot trạng thái của chu kỳ safety gần nhất vào REG_SNAPSHOT_BASE..REG_SNAPSHOT_LAST
+ * @note Gọi từ modbusTask khi master đọc FC3 trùng khối snapshot. Safety task ghi bộ đệm sau rồi
+ *       mới đổi chỉ số, modbusTask (ưu tiên cao hơn) chỉ đọc bộ đệm trước - không bao giờ đọc dở.
  */
-float Safety_Convert_To_Distance(uint8_t sensor_id);
+void Safety_Refresh_Snapshot_Registers(void);
 
 #endif /* SAFETY_MONITOR_H */
\ No newline at end of file
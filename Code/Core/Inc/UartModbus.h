@@ -2,51 +2,137 @@
 #define UART_MODBUS_H
 
 #include "main.h"
+#include "cmsis_os.h"
+#include "ModbusMap.h"
 #include <stdint.h>
 
 #define MODBUS_SLAVE_ADDRESS    5
 #define MODBUS_BAUDRATE         115200
 #define HOLDING_REG_START       0x0000
-#define HOLDING_REG_COUNT       300  // Increased to cover all register addresses
+#define HOLDING_REG_COUNT       (REG_SNAPSHOT_LAST + 1)  // Hết không gian địa chỉ holding (không phải số ô lưu trữ)
 #define INPUT_REG_START         0x0000
-#define INPUT_REG_COUNT         5
+#define INPUT_REG_COUNT         (INPUT_REG_RX_QUEUE_PEAK + 1)
 #define COIL_START              0x0000
-#define COIL_COUNT              8
+#define COIL_COUNT              4    // FC1/5/15: coil n = REG_RELAY(n+1)_CONTROL, xem Output_Control.h
 #define DISCRETE_START          0x0000
-#define DISCRETE_COUNT          4
-#define RX_BUFFER_SIZE          256
+#define DISCRETE_COUNT          4    // FC2: discrete input n = REG_DIn_STATUS
+#define RX_BUFFER_SIZE          256  // Một ô hàng đợi nhận: khung RTU tối đa
+// Số ô hàng đợi khung nhận (lũy thừa của 2, tối đa 128): mỗi ô tốn RX_BUFFER_SIZE + 4 byte RAM
+#ifndef MODBUS_RX_QUEUE_DEPTH
+#define MODBUS_RX_QUEUE_DEPTH   4
+#endif
+#define RX_DMA_BUFFER_SIZE      128  // Vòng DMA nhận; IDLE line đánh dấu hết khung
+#define TX_BUFFER_SIZE          256  // Khung RTU tối đa
+#define MODBUS_MAX_READ_BITS    2000 // Giới hạn FC1/FC2 theo chuẩn Modbus
+#define MODBUS_MAX_WRITE_BITS   1968 // Giới hạn FC15
+#define MODBUS_MAX_READ_REGS    125  // Giới hạn FC3/FC4/FC23 (đọc) theo chuẩn Modbus
+#define MODBUS_MAX_WRITE_REGS   123  // Giới hạn FC16
+#define MODBUS_MAX_RW_WRITE_REGS 121 // Giới hạn FC23 (ghi)
+#define MODBUS_FIXED_FRAME_LENGTH 8  // FC1-FC6: địa chỉ, FC, 2 trường 16 bit, CRC
+
+/* Lưu trữ holding register dạng nén: chỉ các khối địa chỉ có thanh ghi, nối liền nhau trong
+ * g_holdingRegisters. HOLDING_REG(addr) đổi địa chỉ sang ô lưu trữ - hằng số khi addr là hằng,
+ * vài phép so sánh khi addr là biến. Chỉ dùng cho địa chỉ nằm trong một khối; địa chỉ từ master
+ * phải qua bảng mô tả trong UartModbus.c trước. */
+#define HREG_BLOCK_SIZE(first, last)    ((last) - (first) + 1)
+#define HREG_INDEX_STATUS       0
+#define HREG_INDEX_ANALOG       (HREG_INDEX_STATUS + HREG_BLOCK_SIZE(REG_SAFETY_SYSTEM_STATUS, REG_SAFETY_ERROR_CODE))
+#define HREG_INDEX_FILTER       (HREG_INDEX_ANALOG + HREG_BLOCK_SIZE(REG_ANALOG_INPUT_1, REG_DI_DEBOUNCE_TIME))
+#define HREG_INDEX_SAFETY       (HREG_INDEX_FILTER + HREG_BLOCK_SIZE(REG_ANALOG_1_FILTER_TYPE, REG_ANALOG_4_FILTER_PARAM))
+#define HREG_INDEX_CALIBRATION  (HREG_INDEX_SAFETY + HREG_BLOCK_SIZE(REG_RELAY1_CONTROL, REG_SAFETY_LOOP_PERIOD))
+#define HREG_INDEX_CURVE        (HREG_INDEX_CALIBRATION + HREG_BLOCK_SIZE(REG_ANALOG_1_GAIN, REG_ANALOG_4_MODEL))
+#define HREG_INDEX_SYSTEM       (HREG_INDEX_CURVE + HREG_BLOCK_SIZE(REG_ANALOG_CURVE_BASE, REG_ANALOG_CURVE_LAST))
+#define HREG_INDEX_SNAPSHOT     (HREG_INDEX_SYSTEM + HREG_BLOCK_SIZE(REG_DEVICE_ID, REG_CONFIG_ERASE_COMMAND))
+#define HOLDING_REG_STORAGE     (HREG_INDEX_SNAPSHOT + REG_SNAPSHOT_COUNT)
+
+#define HOLDING_REG_INDEX(addr) \
+    ((addr) >= REG_SNAPSHOT_BASE      ? HREG_INDEX_SNAPSHOT    + ((addr) - REG_SNAPSHOT_BASE)         : \
+     (addr) >= REG_DEVICE_ID          ? HREG_INDEX_SYSTEM      + ((addr) - REG_DEVICE_ID)             : \
+     (addr) >= REG_ANALOG_CURVE_BASE  ? HREG_INDEX_CURVE       + ((addr) - REG_ANALOG_CURVE_BASE)     : \
+     (addr) >= REG_ANALOG_1_GAIN      ? HREG_INDEX_CALIBRATION + ((addr) - REG_ANALOG_1_GAIN)         : \
+     (addr) >= REG_RELAY1_CONTROL     ? HREG_INDEX_SAFETY      + ((addr) - REG_RELAY1_CONTROL)        : \
+     (addr) >= REG_ANALOG_1_FILTER_TYPE ? HREG_INDEX_FILTER    + ((addr) - REG_ANALOG_1_FILTER_TYPE)  : \
+     (addr) >= REG_ANALOG_INPUT_1     ? HREG_INDEX_ANALOG      + ((addr) - REG_ANALOG_INPUT_1)        : \
+                                        HREG_INDEX_STATUS      + (addr))
+#define HOLDING_REG(addr)       (g_holdingRegisters[HOLDING_REG_INDEX(addr)])
+
+// Cờ thông báo cho modbusTask (osThreadFlags)
+#define MODBUS_FLAG_FRAME_READY     0x0001U  // ISR nhận đã chuyển một khung hoàn chỉnh
+#define MODBUS_FLAG_UART_TIMEOUT    0x0002U  // Watchdog: UART im lặng quá MODBUS_UART_TIMEOUT_MS
+#define MODBUS_FLAG_SAFETY_READY    0x0004U  // Safety task đã xong vòng đánh giá đầu tiên
+#define MODBUS_FLAG_TX_DONE         0x0008U  // Phản hồi phát xong trong khi còn khung chờ trong hàng đợi
+#define MODBUS_UART_TIMEOUT_MS      10000U
+#define MODBUS_WATCHDOG_PERIOD_MS   100U
+
+// Nhóm thanh ghi cấu hình: modbus đánh dấu khi ghi, safety task áp dụng rồi xóa.
+// 0x0040-0x004C không có nhóm: relay do Output_Control đọc trực tiếp mỗi chu kỳ, tham số an toàn
+// đi qua Safety_Params_Stage (bộ đệm ba)
+#define REG_GROUP_ANALOG_CONFIG     (1UL << 0)  // 0x0014-0x0015, 0x001A-0x0021, 0x0030-0x0037, 0x0050-0x00E3
+#define REG_GROUP_DIGITAL_CONFIG    (1UL << 1)  // 0x0026-0x002E
+#define REG_GROUP_SYSTEM_CONFIG     (1UL << 2)  // 0x0100-0x0103, 0x0109
+#define REG_GROUP_ALL               (REG_GROUP_ANALOG_CONFIG | REG_GROUP_DIGITAL_CONFIG | REG_GROUP_SYSTEM_CONFIG)
+
+// CRC-16/MODBUS: 1 = bảng 256 phần tử (512 byte flash), 0 = bảng nibble 16 phần tử (32 byte flash)
+#ifndef MODBUS_CRC_FULL_TABLE
+#define MODBUS_CRC_FULL_TABLE   1
+#endif
+#define MODBUS_CRC_INIT         0xFFFF
+
+// RS-485 bán song công: định nghĩa chân DE (driver enable) của transceiver nếu có.
+// Chân phải được cấu hình output push-pull, mức thấp trong MX_GPIO_Init.
+// #define MODBUS_RS485_DE_GPIO_Port  GPIOA
+// #define MODBUS_RS485_DE_Pin        GPIO_PIN_1
 
 extern UART_HandleTypeDef huart2;
+extern osThreadId_t modbusTaskHandle;
 // Global register arrays
-extern uint16_t g_holdingRegisters[HOLDING_REG_COUNT];
+extern uint16_t g_holdingRegisters[HOLDING_REG_STORAGE];   // Truy cập qua HOLDING_REG(addr)
 extern uint16_t g_inputRegisters[INPUT_REG_COUNT];
-extern uint8_t g_coils[COIL_COUNT];
-extern uint8_t g_discreteInputs[DISCRETE_COUNT];
 extern uint8_t current_baudrate;
+extern volatile uint32_t g_registerDirtyMask;
 
 // Task counters
 extern uint32_t g_taskCounter;
 extern uint32_t g_modbusCounter;
 
+// Một khung RTU trong hàng đợi nhận; ISR ghi thẳng vào ô nên không cần chép lại
+typedef struct {
+    uint16_t length;
+    uint16_t crc;                   // CRC của cả khung kể cả 2 byte CRC: 0 nếu khung hợp lệ
+    uint8_t data[RX_BUFFER_SIZE];
+} Modbus_Rx_Frame_t;
+
 // UART buffer variables
-extern uint8_t rxBuffer[RX_BUFFER_SIZE];
-extern uint8_t rxIndex;
-extern uint8_t frameReceived;
-extern uint32_t g_lastUARTActivity;
+extern volatile uint32_t g_lastUARTActivity;
 
 // Diagnostic variables
 extern uint32_t g_totalReceived;
 extern uint32_t g_corruptionCount;
 extern uint8_t g_receivedIndex;
+extern uint32_t g_rxDroppedFrames;     // Mọi khung bị bỏ: quá dài hoặc hàng đợi đầy
+extern uint32_t g_rxQueueOverflows;    // Phần của g_rxDroppedFrames do hàng đợi đầy
+extern uint8_t g_rxQueuePeak;          // Số ô hàng đợi dùng nhiều nhất
+extern uint32_t g_txFrames;
+extern uint32_t g_txDroppedFrames;
 
 // Function declarations
-static void MX_USART2_UART_Init(void);
 uint16_t calcCRC(uint8_t *buf, int len);
-void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart);
+uint16_t updateCRC(uint16_t crc, const uint8_t *buf, int len);
+void HAL_UARTEx_RxEventCallback(UART_HandleTypeDef *huart, uint16_t Size);
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart);
 void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart);
+uint8_t isModbusTxBusy(void);
+void startUARTReception(void);
+void checkUARTIdleAtWrap(void);
 void resetUARTCommunication(void);
-void processModbusFrame(void);
+void modbusWatchdogCallback(void *argument);
+uint8_t isModbusFramePending(void);
+uint8_t processModbusFrame(void);
 void initializeModbusRegisters(void);
+void markRegistersDirty(uint16_t addr, uint16_t qty);
+uint32_t takeDirtyRegisters(void);
+// Số lệnh ghi nhóm analog đã xong - safety task so trước/sau khi chép khối hiệu chuẩn/đường cong
+uint32_t getAnalogWriteCount(void);
 void updateSystemStatus(void);
 void updateMotorStatus(void);
 void updateDigitalIOStatus(void);
@@ -0,0 +1,136 @@
+#include "Analog_Filter.h"
+
+Analog_Filter_t g_analog_filters[ANALOG_FILTER_CHANNEL_COUNT];
+
+// Đưa tham số về khoảng hợp lệ của từng loại bộ lọc
+static uint8_t Analog_Filter_Clamp_Param(uint8_t type, uint8_t param)
+{
+    switch (type) {
+    case ANALOG_FILTER_MOVING_AVERAGE:
+        if (param < 1) return 1;
+        if (param > ANALOG_FILTER_MAX_WINDOW) return ANALOG_FILTER_MAX_WINDOW;
+        return param;
+    case ANALOG_FILTER_IIR:
+        if (param < 1) return 1;
+        if (param > ANALOG_FILTER_IIR_MAX_SHIFT) return ANALOG_FILTER_IIR_MAX_SHIFT;
+        return param;
+    case ANALOG_FILTER_MEDIAN:
+        return (param >= ANALOG_FILTER_MAX_MEDIAN) ? ANALOG_FILTER_MAX_MEDIAN : 3;
+    default:
+        return 0;
+    }
+}
+
+// Áp dụng cấu hình mới và xóa trạng thái (chạy trong ngữ cảnh ISR ADC)
+static void Analog_Filter_Apply(Analog_Filter_t *filter)
+{
+    filter->type = filter->pending_type;
+    filter->param = Analog_Filter_Clamp_Param(filter->type, filter->pending_param);
+    filter->count = 0;
+    filter->index = 0;
+    filter->sum = 0;
+    filter->iir_state = 0;
+    filter->pending = 0;
+}
+
+void Analog_Filter_Init(void)
+{
+    for (uint8_t i = 0; i < ANALOG_FILTER_CHANNEL_COUNT; i++) {
+        g_analog_filters[i].pending_type = ANALOG_FILTER_NONE;
+        g_analog_filters[i].pending_param = 0;
+        Analog_Filter_Apply(&g_analog_filters[i]);
+    }
+}
+
+/**
+ * @brief Đặt loại bộ lọc cho một kênh (gọi từ task)
+ * @note Không ghi trực tiếp trạng thái đang dùng trong ISR; ISR áp dụng ở mẫu kế tiếp.
+ *       So với cấu hình sẽ chạy (bộ chờ nếu ISR chưa áp dụng): đổi rồi đổi lại trong cùng nửa
+ *       bộ đệm phải ghi đè bộ chờ, không được bỏ qua vì trùng bộ đang chạy
+ */
+void Analog_Filter_Configure(uint8_t channel, uint8_t type, uint8_t param)
+{
+    if (channel >= ANALOG_FILTER_CHANNEL_COUNT) return;
+    if (type > ANALOG_FILTER_MEDIAN) type = ANALOG_FILTER_NONE;
+
+    Analog_Filter_t *filter = &g_analog_filters[channel];
+    uint8_t target_type = filter->pending ? filter->pending_type : filter->type;
+    uint8_t target_param = filter->pending ? Analog_Filter_Clamp_Param(filter->pending_type, filter->pending_param)
+                                           : filter->param;
+    if (target_type == type && target_param == Analog_Filter_Clamp_Param(type, param)) {
+        return;
+    }
+    filter->pending_type = type;
+    filter->pending_param = param;
+    filter->pending = 1;
+}
+
+// Trung vị của tối đa ANALOG_FILTER_MAX_MEDIAN mẫu (sắp xếp chèn trên bản sao)
+static uint16_t Analog_Filter_Median(const Analog_Filter_t *filter)
+{
+    uint16_t sorted[ANALOG_FILTER_MAX_MEDIAN];
+    uint8_t n = filter->count;
+
+    for (uint8_t i = 0; i < n; i++) {
+        uint16_t value = filter->window[i];
+        int8_t j = (int8_t)i - 1;
+        while (j >= 0 && sorted[j] > value) {
+            sorted[j + 1] = sorted[j];
+            j--;
+        }
+        sorted[j + 1] = value;
+    }
+    return sorted[n / 2];
+}
+
+/**
+ * @brief Lọc một mẫu đã decimate của kênh
+ * @param channel: Kênh (0-3)
+ * @param sample: Mã ADC
+ * @return uint16_t Mã ADC sau lọc
+ */
+uint16_t Analog_Filter_Process(uint8_t channel, uint16_t sample)
+{
+    Analog_Filter_t *filter = &g_analog_filters[channel];
+
+    if (filter->pending) {
+        Analog_Filter_Apply(filter);
+    }
+
+    switch (filter->type) {
+    case ANALOG_FILTER_MOVING_AVERAGE:
+        // Tổng chạy: trừ mẫu cũ nhất, cộng mẫu mới
+        if (filter->count == filter->param) {
+            filter->sum -= filter->window[filter->index];
+        } else {
+            filter->count++;
+        }
+        filter->window[filter->index] = sample;
+        filter->sum += sample;
+        filter->index = (filter->index + 1 < filter->param) ? filter->index + 1 : 0;
+        return (uint16_t)(filter->sum / filter->count);
+
+    case ANALOG_FILTER_IIR:
+        // y += (x - y) / 2^k, trạng thái giữ phần lẻ để không mất độ phân giải
+        if (filter->count == 0) {
+            filter->iir_state = (int32_t)sample << ANALOG_FILTER_IIR_FRAC_BITS;
+            filter->count = 1;
+        } else {
+            filter->iir_state += (((int32_t)sample << ANALOG_FILTER_IIR_FRAC_BITS) - filter->iir_state)
+                                 >> filter->param;
+        }
+        return (uint16_t)((filter->iir_state + (1L << (ANALOG_FILTER_IIR_FRAC_BITS - 1)))
+                          >> ANALOG_FILTER_IIR_FRAC_BITS);
+
+    case ANALOG_FILTER_MEDIAN:
+        filter->window[filter->index] = sample;
+        filter->index = (filter->index + 1 < filter->param) ? filter->index + 1 : 0;
+        if (filter->count < filter->param) {
+            filter->count++;
+        }
+        return Analog_Filter_Median(filter);
+
+    default:
+        return sample;
+    }
+}
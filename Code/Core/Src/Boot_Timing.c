@@ -0,0 +1,44 @@
+#include "Boot_Timing.h"
+#include "Profiler.h"
+#include "UartModbus.h"
+
+static uint32_t s_boot_us[BOOT_PHASE_COUNT];
+static uint16_t s_boot_status;
+static uint32_t s_last_mark;
+static uint32_t s_last_ticks_per_us;
+static uint32_t s_elapsed_us;
+
+// initializeModbusRegisters() xóa input registers sau vài mốc đầu, nên mỗi lần ghi lại cả khối
+static void Boot_Timing_Export(void)
+{
+    for (uint8_t i = 0; i < BOOT_PHASE_COUNT; i++) {
+        g_inputRegisters[INPUT_REG_BOOT_BASE + 2 * i] = (uint16_t)(s_boot_us[i] >> 16);
+        g_inputRegisters[INPUT_REG_BOOT_BASE + 2 * i + 1] = (uint16_t)s_boot_us[i];
+    }
+    g_inputRegisters[INPUT_REG_BOOT_STATUS] = s_boot_status;
+}
+
+void Boot_Timing_Start(void)
+{
+    Profiler_Timebase_Init();
+    s_last_mark = Profiler_Now();
+    s_last_ticks_per_us = PROFILER_TICKS_PER_US;
+    s_elapsed_us = 0;
+}
+
+void Boot_Timing_Mark(Boot_Phase_t phase)
+{
+    uint32_t now = Profiler_Now();
+
+    s_elapsed_us += (now - s_last_mark) / s_last_ticks_per_us;
+    s_last_mark = now;
+    s_last_ticks_per_us = PROFILER_TICKS_PER_US;
+    s_boot_us[phase] = s_elapsed_us;
+    Boot_Timing_Export();
+}
+
+void Boot_Timing_Set_Status(uint16_t flags)
+{
+    s_boot_status |= flags;
+    Boot_Timing_Export();
+}
@@ -0,0 +1,341 @@
+#include "Config_Store.h"
+#include "UartModbus.h"
+#include "Safety_Monitor.h"
+
+#define CONFIG_STORE_RECORD_COUNT   ((CONFIG_STORE_BANK_SIZE - sizeof(Config_Store_Header_t)) / sizeof(Config_Store_Record_t))
+#define CONFIG_STORE_ERASED         0xFFFFU
+#define CONFIG_STORE_PENDING_WORDS  ((HOLDING_REG_COUNT + 31U) / 32U)
+
+_Static_assert(CONFIG_STORE_BASE + CONFIG_STORE_BANK_COUNT * CONFIG_STORE_BANK_SIZE == 0x08010000UL,
+               "Config store must occupy the last pages of the 64K flash");
+
+// Các thanh ghi được lưu: cấu hình do master ghi. Không lưu relay control, lệnh và thanh ghi trạng thái.
+typedef struct {
+    uint16_t first;
+    uint16_t last;
+} Config_Store_Range_t;
+
+static const Config_Store_Range_t s_persistentRanges[] = {
+    { REG_ANALOG_COEFFICIENT,     REG_ANALOG_CALIBRATION    },
+    { REG_ANALOG_1_ENABLE,        REG_ANALOG_4_OFFSET       },
+    { REG_DI1_ENABLE,             REG_DI_DEBOUNCE_TIME      },
+    { REG_ANALOG_1_FILTER_TYPE,   REG_ANALOG_4_FILTER_PARAM },
+    { REG_SAFETY_ZONE1_THRESHOLD, REG_SAFETY_LOOP_PERIOD    },
+    { REG_ANALOG_1_GAIN,          REG_ANALOG_CURVE_LAST     },
+    { REG_DEVICE_ID,              REG_CONFIG_STOP_BIT       },
+};
+
+#define CONFIG_STORE_RANGE_COUNT    (sizeof(s_persistentRanges) / sizeof(s_persistentRanges[0]))
+
+// Bit thanh ghi chờ ghi: modbusTask set, timer task lấy và xóa (atomic, không khóa)
+static uint32_t s_pending[CONFIG_STORE_PENDING_WORDS];
+static volatile uint32_t s_last_mark_tick;
+
+// Bank đang dùng (-1 = flash chưa có dữ liệu), thế hệ của nó và ô trống kế tiếp
+static int8_t s_active_bank = -1;
+static uint16_t s_generation;
+static uint16_t s_next_slot;
+
+// Bank đã xóa trắng (đích chép được ngay, không cần xóa) và lệnh xóa từ master
+static uint8_t s_bank_blank[CONFIG_STORE_BANK_COUNT];
+static volatile uint8_t s_erase_requested;
+
+static inline uint32_t Config_Store_Bank_Address(uint8_t bank)
+{
+    return CONFIG_STORE_BASE + (uint32_t)bank * CONFIG_STORE_BANK_SIZE;
+}
+
+static inline const Config_Store_Header_t *Config_Store_Header(uint8_t bank)
+{
+    return (const Config_Store_Header_t *)Config_Store_Bank_Address(bank);
+}
+
+static inline uint32_t Config_Store_Slot_Address(uint8_t bank, uint16_t slot)
+{
+    return Config_Store_Bank_Address(bank) + sizeof(Config_Store_Header_t) +
+           (uint32_t)slot * sizeof(Config_Store_Record_t);
+}
+
+static inline const Config_Store_Record_t *Config_Store_Slot(uint8_t bank, uint16_t slot)
+{
+    return (const Config_Store_Record_t *)Config_Store_Slot_Address(bank, slot);
+}
+
+static uint16_t Config_Store_CRC(uint16_t a, uint16_t b)
+{
+    uint8_t buf[4] = { (uint8_t)a, (uint8_t)(a >> 8), (uint8_t)b, (uint8_t)(b >> 8) };
+    return calcCRC(buf, sizeof(buf));
+}
+
+static uint16_t Config_Store_Header_CRC(uint16_t layout, uint16_t generation)
+{
+    return Config_Store_CRC(layout, generation) ^ CONFIG_STORE_MAGIC;
+}
+
+static uint8_t Config_Store_Header_Valid(uint8_t bank)
+{
+    const Config_Store_Header_t *header = Config_Store_Header(bank);
+    return header->magic == CONFIG_STORE_MAGIC && header->layout == CONFIG_STORE_LAYOUT &&
+           header->crc == Config_Store_Header_CRC(header->layout, header->generation);
+}
+
+static uint8_t Config_Store_Is_Persistent(uint16_t addr)
+{
+    for (uint8_t i = 0; i < CONFIG_STORE_RANGE_COUNT; i++) {
+        if (addr >= s_persistentRanges[i].first && addr <= s_persistentRanges[i].last) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static uint8_t Config_Store_Slot_Erased(const Config_Store_Record_t *record)
+{
+    return record->addr == CONFIG_STORE_ERASED && record->value == CONFIG_STORE_ERASED &&
+           record->crc == CONFIG_STORE_ERASED;
+}
+
+static uint8_t Config_Store_Page_Blank(uint32_t address)
+{
+    const uint32_t *word = (const uint32_t *)address;
+    for (uint32_t i = 0; i < CONFIG_STORE_PAGE_SIZE / sizeof(uint32_t); i++) {
+        if (word[i] != 0xFFFFFFFFUL) return 0;
+    }
+    return 1;
+}
+
+static uint8_t Config_Store_Bank_Blank(uint8_t bank)
+{
+    for (uint8_t page = 0; page < CONFIG_STORE_BANK_PAGES; page++) {
+        if (!Config_Store_Page_Blank(Config_Store_Bank_Address(bank) + page * CONFIG_STORE_PAGE_SIZE)) return 0;
+    }
+    return 1;
+}
+
+// Bank đích cho lần chép kế tiếp: bank không dùng; khi chưa có bank hợp lệ thì ưu tiên bank đã trắng
+static uint8_t Config_Store_Spare_Bank(void)
+{
+    if (s_active_bank >= 0) {
+        return (s_active_bank == 0) ? 1U : 0U;
+    }
+    return s_bank_blank[0] ? 0U : 1U;
+}
+
+HAL_StatusTypeDef Config_Store_Restore(void)
+{
+    for (uint8_t bank = 0; bank < CONFIG_STORE_BANK_COUNT; bank++) {
+        s_bank_blank[bank] = Config_Store_Bank_Blank(bank);
+    }
+
+    // Chọn bank hợp lệ có thế hệ mới nhất (cả hai hợp lệ = lần chép trước chưa kịp xóa bank cũ)
+    s_active_bank = -1;
+    for (uint8_t bank = 0; bank < CONFIG_STORE_BANK_COUNT; bank++) {
+        if (!Config_Store_Header_Valid(bank)) continue;
+        uint16_t generation = Config_Store_Header(bank)->generation;
+        if (s_active_bank < 0 || (int16_t)(generation - s_generation) > 0) {
+            s_active_bank = (int8_t)bank;
+            s_generation = generation;
+        }
+    }
+    if (s_active_bank < 0) {
+        return HAL_ERROR;
+    }
+
+    // Phát lại log theo thứ tự ghi; bản ghi hỏng (mất điện lúc ghi) bị bỏ qua
+    uint16_t slot = 0;
+    for (; slot < CONFIG_STORE_RECORD_COUNT; slot++) {
+        const Config_Store_Record_t *record = Config_Store_Slot((uint8_t)s_active_bank, slot);
+        if (Config_Store_Slot_Erased(record)) break;
+        if (record->crc == Config_Store_CRC(record->addr, record->value) &&
+            Config_Store_Is_Persistent(record->addr)) {
+            HOLDING_REG(record->addr) = record->value;
+        }
+    }
+    s_next_slot = slot;
+
+    // Để safety task áp dụng cấu hình đã nạp; giá trị vừa đọc từ flash không cần ghi lại
+    markRegistersDirty(0, HOLDING_REG_COUNT);
+    for (uint8_t w = 0; w < CONFIG_STORE_PENDING_WORDS; w++) {
+        s_pending[w] = 0;
+    }
+    return HAL_OK;
+}
+
+void Config_Store_Mark_Dirty(uint16_t addr, uint16_t qty)
+{
+    uint32_t last = (uint32_t)addr + qty - 1U;
+    uint8_t marked = 0;
+
+    for (uint8_t i = 0; i < CONFIG_STORE_RANGE_COUNT; i++) {
+        uint32_t first = (addr > s_persistentRanges[i].first) ? addr : s_persistentRanges[i].first;
+        uint32_t end = (last < s_persistentRanges[i].last) ? last : s_persistentRanges[i].last;
+        for (uint32_t reg = first; reg <= end; reg++) {
+            __atomic_fetch_or(&s_pending[reg >> 5], 1UL << (reg & 31U), __ATOMIC_RELAXED);
+            marked = 1;
+        }
+    }
+    if (marked) {
+        s_last_mark_tick = HAL_GetTick();
+    }
+}
+
+static HAL_StatusTypeDef Config_Store_Program(uint32_t address, uint16_t data)
+{
+    return HAL_FLASH_Program(FLASH_TYPEPROGRAM_HALFWORD, address, data);
+}
+
+static HAL_StatusTypeDef Config_Store_Write_Record(uint8_t bank, uint16_t slot, uint16_t addr, uint16_t value)
+{
+    uint32_t address = Config_Store_Slot_Address(bank, slot);
+
+    if (Config_Store_Program(address, addr) != HAL_OK) return HAL_ERROR;
+    if (Config_Store_Program(address + 2U, value) != HAL_OK) return HAL_ERROR;
+    return Config_Store_Program(address + 4U, Config_Store_CRC(addr, value));
+}
+
+/**
+ * @brief Xóa một trang chưa trắng của bank dự phòng - mỗi lần gọi tối đa một trang
+ * @note CPU dừng cả lúc xóa trang (t_ERASE tới 40 ms), nên chỉ gọi khi được phép xóa
+ */
+static HAL_StatusTypeDef Config_Store_Erase_Step(uint8_t bank)
+{
+    for (uint8_t page = 0; page < CONFIG_STORE_BANK_PAGES; page++) {
+        uint32_t address = Config_Store_Bank_Address(bank) + page * CONFIG_STORE_PAGE_SIZE;
+        if (Config_Store_Page_Blank(address)) continue;
+
+        FLASH_EraseInitTypeDef erase = {
+            .TypeErase = FLASH_TYPEERASE_PAGES,
+            .PageAddress = address,
+            .NbPages = 1,
+        };
+        uint32_t page_error;
+        HAL_StatusTypeDef status = HAL_FLASHEx_Erase(&erase, &page_error);
+        s_bank_blank[bank] = (status == HAL_OK) && Config_Store_Bank_Blank(bank);
+        return status;
+    }
+    s_bank_blank[bank] = 1;
+    return HAL_OK;
+}
+
+/* Chỉ xóa flash khi RELAY1 đã cắt (đầu ra đã ở trạng thái an toàn nên CPU dừng không làm trễ
+ * phản ứng) hoặc master ra lệnh REG_CONFIG_ERASE_COMMAND */
+static uint8_t Config_Store_Erase_Allowed(void)
+{
+    return s_erase_requested || Safety_Outputs_Tripped();
+}
+
+// Giá trị trong bản ghi mới nhất của addr ở bank đang dùng
+static uint8_t Config_Store_Find(uint16_t addr, uint16_t *value)
+{
+    for (uint16_t slot = s_next_slot; slot > 0; slot--) {
+        const Config_Store_Record_t *record = Config_Store_Slot((uint8_t)s_active_bank, slot - 1U);
+        if (record->addr == addr && record->crc == Config_Store_CRC(record->addr, record->value)) {
+            *value = record->value;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Chép giá trị hiện tại của mọi thanh ghi được lưu sang bank dự phòng (đã trắng)
+ * @note Thứ tự: ghi bản ghi, ghi header (thế hệ + 1). Chỉ ghi từng halfword, không xóa;
+ *       bank cũ được xóa sau bởi Config_Store_Erase_Step khi được phép.
+ */
+static HAL_StatusTypeDef Config_Store_Compact(void)
+{
+    uint8_t target = Config_Store_Spare_Bank();
+    uint16_t generation = (uint16_t)(s_generation + 1U);
+    uint16_t slot = 0;
+
+    if (!s_bank_blank[target]) return HAL_BUSY;
+    s_bank_blank[target] = 0;
+
+    for (uint8_t i = 0; i < CONFIG_STORE_RANGE_COUNT; i++) {
+        for (uint16_t reg = s_persistentRanges[i].first; reg <= s_persistentRanges[i].last; reg++) {
+            if (Config_Store_Write_Record(target, slot, reg, HOLDING_REG(reg)) != HAL_OK) {
+                return HAL_ERROR;
+            }
+            slot++;
+        }
+    }
+
+    uint32_t header = Config_Store_Bank_Address(target);
+    if (Config_Store_Program(header + 2U, CONFIG_STORE_LAYOUT) != HAL_OK ||
+        Config_Store_Program(header + 4U, generation) != HAL_OK ||
+        Config_Store_Program(header + 6U, Config_Store_Header_CRC(CONFIG_STORE_LAYOUT, generation)) != HAL_OK ||
+        Config_Store_Program(header, CONFIG_STORE_MAGIC) != HAL_OK) {
+        return HAL_ERROR;
+    }
+
+    s_active_bank = (int8_t)target;
+    s_generation = generation;
+    s_next_slot = slot;
+    return HAL_OK;
+}
+
+void Config_Store_Service(void *argument)
+{
+    uint32_t taken[CONFIG_STORE_PENDING_WORDS];
+    uint8_t any = 0;
+
+    // Dọn bank dự phòng (bank cũ sau lần chép, hoặc dở dang do mất điện) để lần chép sau không phải chờ
+    uint8_t spare = Config_Store_Spare_Bank();
+    if (!s_bank_blank[spare] && Config_Store_Erase_Allowed()) {
+        HAL_FLASH_Unlock();
+        HAL_StatusTypeDef erased = Config_Store_Erase_Step(spare);
+        HAL_FLASH_Lock();
+        if (erased != HAL_OK) {
+            return;
+        }
+    }
+    if (s_bank_blank[spare] && s_erase_requested) {
+        s_erase_requested = 0;
+        HOLDING_REG(REG_CONFIG_ERASE_COMMAND) = 0;
+    }
+
+    for (uint8_t w = 0; w < CONFIG_STORE_PENDING_WORDS; w++) {
+        any |= (s_pending[w] != 0);
+    }
+    if (!any || HAL_GetTick() - s_last_mark_tick < CONFIG_STORE_COALESCE_MS) {
+        return;
+    }
+    for (uint8_t w = 0; w < CONFIG_STORE_PENDING_WORDS; w++) {
+        taken[w] = __atomic_exchange_n(&s_pending[w], 0, __ATOMIC_ACQUIRE);
+    }
+
+    HAL_StatusTypeDef status = HAL_OK;
+    HAL_FLASH_Unlock();
+    for (uint16_t reg = 0; reg < HOLDING_REG_COUNT && status == HAL_OK; reg++) {
+        if (!(taken[reg >> 5] & (1UL << (reg & 31U)))) continue;
+
+        uint16_t value = HOLDING_REG(reg);
+        uint16_t stored;
+        if (s_active_bank >= 0 && Config_Store_Find(reg, &stored) && stored == value) {
+            continue;
+        }
+        if (s_active_bank < 0 || s_next_slot >= CONFIG_STORE_RECORD_COUNT) {
+            // Bank chép ghi giá trị hiện tại của mọi thanh ghi, các bit còn lại đã được lưu
+            status = Config_Store_Compact();
+            if (status == HAL_OK) break;
+        } else {
+            status = Config_Store_Write_Record((uint8_t)s_active_bank, s_next_slot++, reg, value);
+        }
+    }
+    HAL_FLASH_Lock();
+
+    if (status != HAL_OK) {
+        // Thử lại ở lần sau; HAL_BUSY = bank đầy, chờ được phép xóa bank dự phòng (không chờ gộp lại)
+        for (uint8_t w = 0; w < CONFIG_STORE_PENDING_WORDS; w++) {
+            __atomic_fetch_or(&s_pending[w], taken[w], __ATOMIC_RELAXED);
+        }
+        if (status != HAL_BUSY) {
+            s_last_mark_tick = HAL_GetTick();
+        }
+    }
+}
+
+void Config_Store_Request_Erase(void)
+{
+    s_erase_requested = 1;
+}
@@ -1,4 +1,5 @@
 #include "Output_Control.h"
+#include "UartModbus.h"
 
 Output_Control_t g_output_control[OUTPUT_CONTROL_COUNT];
 
@@ -10,14 +11,19 @@ void Output_Control_Init(void){
 }
 
 void Output_Control_Process(void){
+    for(uint8_t i = OUTPUT_CONTROL_FIRST; i < OUTPUT_CONTROL_COUNT; i++){
+        uint8_t state = HOLDING_REG(REG_RELAY1_CONTROL + i) ? 1U : 0U;
+        if(state != g_output_control[i].output_state){
+            g_output_control[i].output_state = state;
+            Set_Output_Control_State(i, state);
+        }
+    }
 }
 
 void Set_Output_Control_State(uint8_t output_channel, uint8_t output_state)
 {
-    if(output_channel == 0){
-        HAL_GPIO_WritePin(RELAY1_GPIO_Port, RELAY1_Pin, output_state);
-    }
-    else if(output_channel == 1){
-        HAL_GPIO_WritePin(RELAY2_GPIO_Port, RELAY2_Pin, output_state);
+    // RELAY1 chỉ do safety logic cắt/nhả (Safety_Monitor_Process, cắt nhanh trong ISR)
+    if(output_channel == 1){
+        HAL_GPIO_WritePin(RELAY2_GPIO_Port, RELAY2_Pin, output_state ? GPIO_PIN_SET : GPIO_PIN_RESET);
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,104 @@
+#include "Profiler.h"
+
+#if PROFILER_ENABLE
+
+_Static_assert(PROFILE_SECTION_COUNT * PROFILER_REGS_PER_SECTION == INPUT_REG_PROFILER_COUNT,
+               "INPUT_REG_PROFILER_COUNT does not match the profiler sections");
+
+Profile_Stats_t g_profile_stats[PROFILE_SECTION_COUNT];
+
+/**
+ * @brief Bật bộ đếm chu kỳ DWT và xóa thống kê
+ */
+void Profiler_Init(void)
+{
+    Profiler_Timebase_Init();
+    Profiler_Reset();
+}
+
+void Profiler_Reset(void)
+{
+    for (uint8_t i = 0; i < PROFILE_SECTION_COUNT; i++) {
+        Profile_Stats_t *stats = &g_profile_stats[i];
+        stats->count = 0;
+        stats->min = UINT32_MAX;
+        stats->max = 0;
+        stats->total = 0;
+        stats->last_mark = 0;
+        for (uint8_t b = 0; b < PROFILER_HIST_BUCKETS; b++) {
+            stats->hist[b] = 0;
+        }
+    }
+}
+
+// Bucket theo log4: [0,64) [64,256) [256,1024) ... bucket cuối gom phần còn lại
+static uint8_t Profiler_Bucket(uint32_t cycles)
+{
+    if (cycles < (1UL << PROFILER_HIST_BASE_BITS)) {
+        return 0;
+    }
+    uint32_t bucket = ((31U - (uint32_t)__builtin_clz(cycles) - PROFILER_HIST_BASE_BITS) >> 1) + 1U;
+    return (bucket < PROFILER_HIST_BUCKETS) ? (uint8_t)bucket : (PROFILER_HIST_BUCKETS - 1U);
+}
+
+/**
+ * @brief Ghi một lần đo của đoạn code
+ * @param section: Đoạn được đo
+ * @param cycles: Thời gian (chu kỳ CPU, hoặc ns trên bản host)
+ */
+void Profiler_Record(Profile_Section_t section, uint32_t cycles)
+{
+    Profile_Stats_t *stats = &g_profile_stats[section];
+
+    stats->count++;
+    stats->total += cycles;
+    if (cycles < stats->min) stats->min = cycles;
+    if (cycles > stats->max) stats->max = cycles;
+    stats->hist[Profiler_Bucket(cycles)]++;
+}
+
+/**
+ * @brief Đo khoảng cách giữa hai lần gọi liên tiếp (chu kỳ vòng lặp và jitter)
+ * @note Lần gọi đầu tiên chỉ lấy mốc
+ */
+void Profiler_Mark(Profile_Section_t section)
+{
+    Profile_Stats_t *stats = &g_profile_stats[section];
+    uint32_t now = Profiler_Now();
+
+    if (stats->last_mark != 0) {
+        Profiler_Record(section, now - stats->last_mark);
+    }
+    stats->last_mark = now;
+}
+
+static inline void Profiler_Put32(uint16_t *regs, uint32_t value)
+{
+    regs[0] = (uint16_t)(value >> 16);
+    regs[1] = (uint16_t)value;
+}
+
+/**
+ * @brief Chép thống kê vào khối input registers
+ * @param regs: Thanh ghi đầu khối (INPUT_REG_PROFILER_BASE)
+ * @note Gọi khi master đọc khối (FC4); giá trị 32 bit ghi word cao trước, histogram bão hòa ở 0xFFFF
+ */
+void Profiler_Export(uint16_t *regs)
+{
+    for (uint8_t i = 0; i < PROFILE_SECTION_COUNT; i++) {
+        const Profile_Stats_t *stats = &g_profile_stats[i];
+        uint32_t count = stats->count;
+        uint32_t mean = count ? (uint32_t)(stats->total / count) : 0;
+
+        Profiler_Put32(&regs[0], count);
+        Profiler_Put32(&regs[2], count ? stats->min : 0);
+        Profiler_Put32(&regs[4], stats->max);
+        Profiler_Put32(&regs[6], mean);
+        for (uint8_t b = 0; b < PROFILER_HIST_BUCKETS; b++) {
+            regs[8 + b] = (stats->hist[b] > 0xFFFFU) ? 0xFFFFU : (uint16_t)stats->hist[b];
+        }
+        regs += PROFILER_REGS_PER_SECTION;
+    }
+}
+
+#endif
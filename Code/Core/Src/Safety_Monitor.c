@@ -1,4 +1,6 @@
 #include "Safety_Monitor.h"
+#include "Analog_Filter.h"
+#include <math.h>
 
 // MODIFICATION LOG
 // Date: 2025-01-14 
@@ -10,6 +12,7 @@
 
 // External ADC handle from main.c
 extern ADC_HandleTypeDef hadc1;
+extern TIM_HandleTypeDef htim2;
 
 // Missing constants for proper compilation
 #define MAX_ANALOG_SENSORS      4
@@ -22,29 +25,241 @@ Safety_System_Data_t g_safety_system;
 Analog_Sensor_t g_analog_sensors[ANALOG_SENSOR_COUNT];
 Digital_Sensor_t g_digital_sensors[DIGITAL_SENSOR_COUNT];
 
+// Giá trị đã decimate (ADC_CODE_BITS bit) cho từng kênh, cập nhật mỗi nửa bộ đệm DMA
 volatile uint16_t adc_buffer[4];
+// Bộ đệm DMA vòng: hai nửa, mỗi nửa ADC_OVERSAMPLE_RATIO lần quét 4 kênh
+static uint16_t adc_dma_buffer[ADC_DMA_BUFFER_LENGTH];
+
+// Bảng tra khoảng cách riêng từng kênh và tham số đã dùng để tạo bảng
+typedef struct {
+    uint16_t gain;
+    uint16_t exponent;
+    int16_t offset;
+} Distance_Table_Params_t;
+
+// Đường cong điểm gãy (ANALOG_MODEL_CURVE)
+typedef struct {
+    uint8_t count;
+    uint16_t code[ANALOG_CURVE_MAX_POINTS];
+    int16_t value[ANALOG_CURVE_MAX_POINTS];
+} Sensor_Curve_t;
+
+// Cách đổi mã ADC -> khoảng cách của một kênh: mô hình, mã ADC nhỏ nhất có nghĩa,
+// cờ khoảng cách đơn điệu giảm theo mã, miền hợp lệ (ngoài miền là lỗi cảm biến)
+// và bảng tra hoặc đường cong tương ứng (chung vùng nhớ, chọn theo model: 536 thay vì 604 byte/bảng)
+typedef struct {
+    uint8_t model;
+    uint8_t monotonic;
+    uint16_t min_code;
+    uint16_t valid_code_min;
+    uint16_t valid_code_max;
+    int16_t valid_min;
+    int16_t valid_max;
+    Distance_Table_Params_t params;
+    union {
+        Safety_Value_t lut[DISTANCE_LUT_SIZE];     // ANALOG_MODEL_POWER_LAW
+        Sensor_Curve_t curve;                      // ANALOG_MODEL_CURVE
+    };
+} Distance_Map_t;
+
+/* Mỗi kênh trỏ tới một bảng trong s_distance_maps, thêm một bảng dư dùng chung cho cả 4 kênh
+ * (5 x 536 = 2680 byte .bss). Safety task tạo bảng mới
+ * trong bảng dư rồi đổi chỉ số; bảng cũ thành bảng dư. modbusTask (ưu tiên cao hơn) đọc bảng khi
+ * master đọc REG_ANALOG_INPUT_x nên không bao giờ thấy bảng đang tạo dở, và vì safety task không
+ * chiếm được modbusTask nên bảng dư không thể đang được đọc dở khi bị ghi đè */
+static Distance_Map_t s_distance_maps[ANALOG_SENSOR_COUNT + 1];
+static uint8_t s_distance_map_index[ANALOG_SENSOR_COUNT] = { 0, 1, 2, 3 };
+static uint8_t s_distance_map_spare = ANALOG_SENSOR_COUNT;
+
+// Sườn DI do EXTI ghi nhận: bit kênh, thời điểm (ms) và mốc Profiler_Now(), task đọc rồi xóa
+static volatile uint8_t s_di_edge_pending;
+static volatile uint32_t s_di_edge_time[DIGITAL_SENSOR_COUNT];
+static volatile uint32_t s_di_edge_stamp[DIGITAL_SENSOR_COUNT];
+
+// Mốc Profiler_Now() của nửa bộ đệm ADC vừa decimate, cờ đã có mẫu đầu tiên
+static volatile uint32_t s_adc_sample_stamp;
+static volatile uint8_t s_adc_sample_ready;
+
+// Đo thời gian phản ứng: mốc lúc relay được phép tác động lại (sau reset) và cờ đã chốt
+Safety_Reaction_Stats_t g_reaction_stats;
+static uint32_t s_reaction_armed_stamp;
+static uint8_t s_reaction_latched;
+static uint8_t s_reaction_publish;
+
+/* Ba bộ tham số an toàn: safety task giữ s_params_active, modbusTask giữ s_params_staging,
+ * s_params_ready là bộ chờ trao đổi (chỉ số | SAFETY_PARAMS_NEW nếu chưa được nhận) */
+#define SAFETY_PARAMS_INDEX         0x03U
+#define SAFETY_PARAMS_NEW           0x80U
+static Safety_Params_t s_params[3];
+static uint8_t s_params_active = 0;
+static uint8_t s_params_staging = 2;
+static uint8_t s_params_ready = 1;
+
+// Snapshot trạng thái, hai bộ đệm: safety task ghi bộ đệm sau rồi đổi s_snapshot_front
+static uint16_t s_snapshot[2][REG_SNAPSHOT_COUNT];
+#if SAFETY_CLASSIFY_RAW_CODE
+// Mã ADC đã phân vùng trong chu kỳ (SNAPSHOT_CODE_INACTIVE = kênh tắt) - đổi ra khoảng cách khi master đọc
+#define SNAPSHOT_CODE_INACTIVE      0xFFFFU
+static uint16_t s_snapshot_code[2][ANALOG_SENSOR_COUNT];
+static uint16_t s_cycle_code[ANALOG_SENSOR_COUNT];
+#endif
+static uint8_t s_snapshot_front;
+static uint16_t s_snapshot_sequence;
+
+// Ngưỡng theo mã ADC thô (từng kênh): khoảng cách giảm khi mã tăng, nên "khoảng cách <= X" tương đương "mã >= code(X)"
+static uint8_t s_code_thresholds_valid[ANALOG_SENSOR_COUNT];
+#if SAFETY_CLASSIFY_RAW_CODE
+static uint16_t s_zone_code[ANALOG_SENSOR_COUNT][4];
+static uint16_t s_code_valid_far[ANALOG_SENSOR_COUNT];    // Mã < giá trị này: ngoài miền hợp lệ phía xa
+static uint16_t s_code_valid_near[ANALOG_SENSOR_COUNT];   // Mã >= giá trị này: ngoài miền hợp lệ phía gần
+#endif
+
+#if SAFETY_FAST_TRIP_ENABLE
+// Cắt nhanh trong ISR: ngưỡng mã ADC mỗi kênh, mặt nạ/mức DI, và trạng thái lần cắt chưa được task chốt
+static volatile uint16_t s_fast_trip_code[ANALOG_SENSOR_COUNT] = {
+    FAST_TRIP_CODE_DISABLED, FAST_TRIP_CODE_DISABLED, FAST_TRIP_CODE_DISABLED, FAST_TRIP_CODE_DISABLED
+};
+static volatile uint8_t s_fast_trip_di_mask;
+static volatile uint8_t s_fast_trip_di_level;
+static volatile uint8_t s_fast_trip_latched;
+static volatile uint32_t s_fast_trip_start;
+static volatile uint32_t s_fast_trip_end;
+#endif
+
+void Safety_Boot_Safe_Outputs(void)
+{
+    GPIO_InitTypeDef GPIO_InitStruct = {0};
+
+    __HAL_RCC_GPIOB_CLK_ENABLE();
+    // Ghi ODR trước khi chuyển chân sang output để không có xung ở mức nhả relay
+    HAL_GPIO_WritePin(RELAY1_GPIO_Port, RELAY1_Pin, GPIO_PIN_SET);
+    HAL_GPIO_WritePin(LED1_GPIO_Port, LED1_Pin, GPIO_PIN_SET);
+
+    GPIO_InitStruct.Mode = GPIO_MODE_OUTPUT_PP;
+    GPIO_InitStruct.Pull = GPIO_NOPULL;
+    GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_LOW;
+    GPIO_InitStruct.Pin = RELAY1_Pin;
+    HAL_GPIO_Init(RELAY1_GPIO_Port, &GPIO_InitStruct);
+    GPIO_InitStruct.Pin = LED1_Pin;
+    HAL_GPIO_Init(LED1_GPIO_Port, &GPIO_InitStruct);
+}
+
+// Ràng buộc giữa các tham số; min/max từng thanh ghi đã được bảng thanh ghi Modbus kiểm tra
+static uint8_t Safety_Params_Valid(const Safety_Params_t *params)
+{
+    for (uint8_t z = 1; z < 4; z++) {
+        if (SAFETY_PARAM(params, REG_SAFETY_ZONE1_THRESHOLD + z) <= SAFETY_PARAM(params, REG_SAFETY_ZONE1_THRESHOLD + z - 1)) {
+            return 0;
+        }
+    }
+    uint16_t period = SAFETY_PARAM(params, REG_SAFETY_LOOP_PERIOD);
+    return period >= SAFETY_LOOP_PERIOD_MIN_MS && period <= SAFETY_LOOP_PERIOD_MAX_MS &&
+           SAFETY_PARAM(params, REG_SAFETY_RESPONSE_TIME) != 0;
+}
+
+static void Safety_Params_Apply(const Safety_Params_t *params)
+{
+    g_reaction_stats.budget_us = (uint32_t)SAFETY_PARAM(params, REG_SAFETY_RESPONSE_TIME) * 1000U;
+    g_safety_system.loop_period_ms = SAFETY_PARAM(params, REG_SAFETY_LOOP_PERIOD);
+}
+
+// Bộ tham số ban đầu từ thanh ghi (mặc định hoặc cấu hình nạp từ flash)
+static void Safety_Params_Init(void)
+{
+    static const uint16_t defaults[SAFETY_PARAM_COUNT] = {
+        DEFAULT_SAFETY_ZONE1_THRESHOLD, DEFAULT_SAFETY_ZONE2_THRESHOLD, DEFAULT_SAFETY_ZONE3_THRESHOLD,
+        DEFAULT_SAFETY_ZONE4_THRESHOLD, DEFAULT_PROXIMITY_THRESHOLD, DEFAULT_SAFETY_RESPONSE_TIME,
+        DEFAULT_AUTO_RESET_ENABLE, DEFAULT_SAFETY_MODE, DEFAULT_SAFETY_LOOP_PERIOD
+    };
+    Safety_Params_t *params = &s_params[s_params_active];
+
+    for (uint8_t i = 0; i < SAFETY_PARAM_COUNT; i++) {
+        params->regs[i] = HOLDING_REG(SAFETY_PARAM_FIRST + i);
+    }
+    if (!Safety_Params_Valid(params)) {
+        // Cấu hình flash cũ (trước khi có kiểm tra) - dùng mặc định và cho master thấy giá trị đang dùng
+        for (uint8_t i = 0; i < SAFETY_PARAM_COUNT; i++) {
+            params->regs[i] = defaults[i];
+            HOLDING_REG(SAFETY_PARAM_FIRST + i) = defaults[i];
+        }
+        HOLDING_REG(REG_SAFETY_ERROR_CODE) |= SAFETY_ERROR_PARAMETERS;
+    }
+    Safety_Params_Apply(params);
+}
+
+HAL_StatusTypeDef Safety_Params_Stage(uint16_t addr, uint16_t qty, const uint8_t *data)
+{
+    uint32_t last = (uint32_t)addr + qty - 1U;
+    if (addr > SAFETY_PARAM_LAST || last < SAFETY_PARAM_FIRST) {
+        return HAL_OK;
+    }
+
+    // Bản nháp = bộ đã công bố gần nhất (thanh ghi chỉ nhận lệnh ghi hợp lệ) + giá trị mới
+    Safety_Params_t *staged = &s_params[s_params_staging];
+    for (uint8_t i = 0; i < SAFETY_PARAM_COUNT; i++) {
+        staged->regs[i] = HOLDING_REG(SAFETY_PARAM_FIRST + i);
+    }
+    for (uint16_t i = 0; i < qty; i++) {
+        uint32_t reg = (uint32_t)addr + i;
+        if (reg >= SAFETY_PARAM_FIRST && reg <= SAFETY_PARAM_LAST) {
+            staged->regs[reg - SAFETY_PARAM_FIRST] = (uint16_t)((data[2 * i] << 8) | data[2 * i + 1]);
+        }
+    }
+    if (!Safety_Params_Valid(staged)) {
+        return HAL_ERROR;
+    }
+
+    // Công bố: bộ nháp thành bộ chờ, bộ chờ cũ (đã nhận hoặc bị thay) thành bộ nháp kế tiếp
+    uint8_t previous = __atomic_exchange_n(&s_params_ready, (uint8_t)(s_params_staging | SAFETY_PARAMS_NEW),
+                                           __ATOMIC_ACQ_REL);
+    s_params_staging = previous & SAFETY_PARAMS_INDEX;
+    return HAL_OK;
+}
+
+// Đầu chu kỳ safety: nhận bộ tham số mới nếu có. Trả về 1 nếu bộ đang dùng đã đổi.
+static uint8_t Safety_Params_Acquire(void)
+{
+    if (!(__atomic_load_n(&s_params_ready, __ATOMIC_RELAXED) & SAFETY_PARAMS_NEW)) {
+        return 0;
+    }
+    uint8_t ready = __atomic_exchange_n(&s_params_ready, s_params_active, __ATOMIC_ACQ_REL);
+    s_params_active = ready & SAFETY_PARAMS_INDEX;
+    return 1;
+}
+
+// Bảng đổi khoảng cách đang công bố của một kênh
+static inline const Distance_Map_t *Safety_Distance_Map(uint8_t sensor_id)
+{
+    return &s_distance_maps[__atomic_load_n(&s_distance_map_index[sensor_id], __ATOMIC_ACQUIRE)];
+}
+
+// Công bố bảng dư (vừa tạo xong) cho kênh, bảng cũ thành bảng dư kế tiếp. Chỉ safety task gọi.
+static void Safety_Distance_Map_Publish(uint8_t sensor_id)
+{
+    s_distance_map_spare = __atomic_exchange_n(&s_distance_map_index[sensor_id], s_distance_map_spare,
+                                               __ATOMIC_ACQ_REL);
+}
 
 // Khởi tạo các giá trị mặc định cho các cảm biến
 HAL_StatusTypeDef Safety_Monitor_Init(void){
+    // Bộ đếm chu kỳ dùng để đóng dấu mẫu ADC và sườn DI
+    Profiler_Timebase_Init();
+    Safety_Params_Init();
+    g_safety_system.loop_overrun_count = 0;
+    s_reaction_armed_stamp = Profiler_Now();
+    s_reaction_latched = 0;
+    s_reaction_publish = 1;
+
     // Hiệu chuẩn ADC trước khi bắt đầu DMA để đảm bảo độ chính xác
     if (HAL_ADCEx_Calibration_Start(&hadc1) != HAL_OK) {
         return HAL_ERROR;
     }
-    // Bắt đầu chuyển đổi ADC ở chế độ quét 4 kênh với DMA vòng
-    if (HAL_ADC_Start_DMA(&hadc1, (uint32_t*)adc_buffer, 4) != HAL_OK) {
-        return HAL_ERROR;
-    }
-    // Khởi tạo trạng thái hoạt động cho cảm biến analog
-    g_analog_sensors[0].sensor_active = DEFAULT_ANALOG_1_ENABLE;
-    g_analog_sensors[1].sensor_active = DEFAULT_ANALOG_2_ENABLE;
-    g_analog_sensors[2].sensor_active = DEFAULT_ANALOG_3_ENABLE;
-    g_analog_sensors[3].sensor_active = DEFAULT_ANALOG_4_ENABLE;
+    // Bộ lọc phải sẵn sàng trước khi DMA gọi callback đầu tiên
+    Analog_Filter_Init();
 
-    // Khởi tạo các thông số cân chỉnh cho cảm biến analog
     for(uint8_t i = 0; i < ANALOG_SENSOR_COUNT; i++) {
-        g_analog_sensors[i].calibration_gain = DEFAULT_ANALOG_COEFFICIENT;
-        g_analog_sensors[i].calibration_offset = DEFAULT_ANALOG_CALIBRATION;
         g_analog_sensors[i].error_count = 0;
+        g_analog_sensors[i].critical_timestamp = 0;
     }
 
     // Khởi tạo giá trị mặc định cho cảm biến digital  
@@ -53,30 +268,126 @@ HAL_StatusTypeDef Safety_Monitor_Init(void){
     g_digital_sensors[2].sensor_value = DEFAULT_DI3_STATUS;
     g_digital_sensors[3].sensor_value = DEFAULT_DI4_STATUS;
 
-    // Khởi tạo trạng thái hoạt động cho cảm biến digital
-    g_digital_sensors[0].sensor_active = DEFAULT_DI1_ENABLE;
-    g_digital_sensors[1].sensor_active = DEFAULT_DI2_ENABLE;
-    g_digital_sensors[2].sensor_active = DEFAULT_DI3_ENABLE;
-    g_digital_sensors[3].sensor_active = DEFAULT_DI4_ENABLE;
-
     // Khởi tạo các thông số bổ sung cho cảm biến digital
+    // Trạng thái ban đầu lấy từ chân thực tế để không sinh sườn giả khi khởi động
+    uint8_t di_levels = DI_READ_ALL();
+    s_di_edge_pending = 0;
     for(uint8_t i = 0; i < DIGITAL_SENSOR_COUNT; i++) {
         g_digital_sensors[i].error_count = 0;
         g_digital_sensors[i].state_change_count = 0;
         g_digital_sensors[i].last_edge_time = 0;
-        g_digital_sensors[i].previous_state = 0;
-        g_digital_sensors[i].debounced_state = 0;
-        g_digital_sensors[i].debounce_time_ms = DEFAULT_SAFETY_RESPONSE_TIME;
+        g_digital_sensors[i].edge_timestamp = 0;
+        g_digital_sensors[i].previous_state = (di_levels >> i) & 1U;
+        g_digital_sensors[i].debounced_state = g_digital_sensors[i].previous_state;
+        g_digital_sensors[i].rising_edge_detected = 0;
+        g_digital_sensors[i].falling_edge_detected = 0;
+    }
+
+    // Enable, bảng tra/đường cong, bộ lọc và cấu hình DI lấy từ thanh ghi (đã nạp từ flash),
+    // không phải DEFAULT_* - ngắt ADC/EXTI đầu tiên đã dùng đúng cấu hình đã lưu
+    Safety_Register_Load();
+
+    // Bắt đầu chuyển đổi ADC ở chế độ quét 4 kênh với DMA vòng, kích bởi TIM2_CC2
+    if (HAL_ADC_Start_DMA(&hadc1, (uint32_t*)adc_dma_buffer, ADC_DMA_BUFFER_LENGTH) != HAL_OK) {
+        return HAL_ERROR;
+    }
+    if (HAL_TIM_PWM_Start(&htim2, TIM_CHANNEL_2) != HAL_OK) {
+        return HAL_ERROR;
     }
     
     return HAL_OK;
 }
 
+static void Safety_Reaction_Add(uint32_t ticks);
+
+// Bucket theo log2: [0,250us) [250,500us) [500us,1ms) ... bucket cuối gom phần còn lại
+static uint8_t Safety_Reaction_Bucket(uint32_t us)
+{
+    uint32_t limit = REACTION_HIST_BASE_US;
+    uint8_t bucket = 0;
+
+    while (us >= limit && bucket < REACTION_HIST_BUCKETS - 1U) {
+        limit <<= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+/**
+ * @brief Ghi thời gian phản ứng khi RELAY1 vừa được đóng do CRITICAL
+ * @param now: Profiler_Now() ngay sau khi ghi RELAY1
+ * @note Mốc bắt đầu là mẫu/sườn CRITICAL sớm nhất, nhưng không sớm hơn lúc relay được phép tác động lại
+ */
+static void Safety_Record_Reaction(uint32_t now)
+{
+    uint32_t age = now - s_reaction_armed_stamp;
+
+    for (uint8_t i = 0; i < ANALOG_SENSOR_COUNT; i++) {
+        if (g_analog_sensors[i].sensor_active &&
+            g_analog_sensors[i].sensor_status == SENSOR_STATUS_CRITICAL) {
+            uint32_t sensor_age = now - g_analog_sensors[i].critical_timestamp;
+            if (sensor_age < age) age = sensor_age;
+        }
+    }
+    for (uint8_t i = 0; i < DIGITAL_SENSOR_COUNT; i++) {
+        if (g_digital_sensors[i].sensor_active &&
+            g_digital_sensors[i].sensor_status == SENSOR_STATUS_CRITICAL) {
+            uint32_t sensor_age = now - g_digital_sensors[i].edge_timestamp;
+            if (sensor_age < age) age = sensor_age;
+        }
+    }
+
+    Safety_Reaction_Add(age);
+}
+
+#if SAFETY_FAST_TRIP_ENABLE
+/**
+ * @brief Đóng RELAY1/LED1 ngay trong ISR (ADC DMA hoặc EXTI)
+ * @param start: Mốc của mẫu/sườn gây cắt
+ * @note Không làm gì khi relay đã được chốt; task đọc s_fast_trip_latched để chốt REG_RESET_FLAG và ghi thống kê
+ */
+static void Safety_Fast_Trip(uint32_t start)
+{
+    if (s_fast_trip_latched || HOLDING_REG(REG_RESET_FLAG) != 0) {
+        return;
+    }
+    HAL_GPIO_WritePin(RELAY1_GPIO_Port, RELAY1_Pin, GPIO_PIN_SET);
+    s_fast_trip_end = Profiler_Now();
+    HAL_GPIO_WritePin(LED1_GPIO_Port, LED1_Pin, GPIO_PIN_SET);
+    s_fast_trip_start = start;
+    s_fast_trip_latched = 1;
+}
+#endif
+
+// Cộng một lần đo (đơn vị Profiler_Now()) vào thống kê thời gian phản ứng
+static void Safety_Reaction_Add(uint32_t ticks)
+{
+    uint32_t us = ticks / PROFILER_TICKS_PER_US;
+    g_reaction_stats.count++;
+    g_reaction_stats.last_us = us;
+    if (us > g_reaction_stats.worst_us) {
+        g_reaction_stats.worst_us = us;
+    }
+    g_reaction_stats.hist[Safety_Reaction_Bucket(us)]++;
+    if (us > g_reaction_stats.budget_us) {
+        g_reaction_stats.over_budget_count++;
+        HOLDING_REG(REG_SAFETY_ERROR_CODE) |= SAFETY_ERROR_REACTION_TIME;
+    }
+    s_reaction_latched = 1;
+    s_reaction_publish = 1;
+}
+
 // Xử lý dữ liệu từ các cảm biến
 Safety_Monitor_Status_t Safety_Monitor_Process(void){
     uint32_t current_time = HAL_GetTick();
     Safety_Monitor_Status_t system_status = SAFETY_MONITOR_OK;
 
+    // Master vừa xóa REG_RESET_FLAG: relay lại được phép tác động, bắt đầu tính thời gian phản ứng từ đây
+    if (s_reaction_latched && HOLDING_REG(REG_RESET_FLAG) == 0) {
+        s_reaction_latched = 0;
+        s_reaction_armed_stamp = Profiler_Now();
+    }
+
     // Xử lý tất cả các cảm biến
     Safety_Process_Analog_Sensors();
     Safety_Process_Digital_Sensors();
@@ -87,7 +398,7 @@ Safety_Monitor_Status_t Safety_Monitor_Process(void){
         if (g_analog_sensors[i].sensor_active)
         {
             // Kiểm tra theo thứ tự ưu tiên từ cao đến thấp
-            if (g_holdingRegisters[REG_RESET_FLAG] == 0)
+            if (HOLDING_REG(REG_RESET_FLAG) == 0)
             {
                 if (g_analog_sensors[i].sensor_status == SENSOR_STATUS_CRITICAL)
                 {
@@ -116,7 +427,7 @@ Safety_Monitor_Status_t Safety_Monitor_Process(void){
     {
         if (g_digital_sensors[i].sensor_active)
         {
-            if (g_holdingRegisters[REG_RESET_FLAG] == 0)
+            if (HOLDING_REG(REG_RESET_FLAG) == 0)
             {
                 if (g_digital_sensors[i].sensor_status == SENSOR_STATUS_CRITICAL)
                 {
@@ -155,132 +466,636 @@ Safety_Monitor_Status_t Safety_Monitor_Process(void){
     
     
     // Chỉ cập nhật trạng thái hệ thống nếu chưa có lỗi nghiêm trọng hoặc đã được reset
-    if(g_holdingRegisters[REG_RESET_FLAG] == 0) {
+    if(HOLDING_REG(REG_RESET_FLAG) == 0) {
+#if SAFETY_FAST_TRIP_ENABLE
+        // ISR cắt nhanh cùng mức ưu tiên 5: chặn trong lúc chốt để task không nhả relay ISR vừa đóng
+        taskENTER_CRITICAL();
+        if (s_fast_trip_latched) {
+            Safety_Reaction_Add(s_fast_trip_end - s_fast_trip_start);
+            s_reaction_latched = 1;
+            s_fast_trip_latched = 0;
+            system_status = SAFETY_MONITOR_CRITICAL;
+            HOLDING_REG(REG_RESET_FLAG) = 1;
+            g_safety_system.system_status = SAFETY_MONITOR_CRITICAL;
+        }
+        else
+#endif
         if(system_status == SAFETY_MONITOR_CRITICAL) {
             HAL_GPIO_WritePin(RELAY1_GPIO_Port, RELAY1_Pin, GPIO_PIN_SET);
+            Safety_Record_Reaction(Profiler_Now());
             HAL_GPIO_WritePin(LED1_GPIO_Port, LED1_Pin, GPIO_PIN_SET);
-            g_holdingRegisters[REG_RESET_FLAG] = 1;
+            HOLDING_REG(REG_RESET_FLAG) = 1;
             g_safety_system.system_status = SAFETY_MONITOR_CRITICAL;
-            return SAFETY_MONITOR_CRITICAL;
         }
         else if(system_status == SAFETY_MONITOR_ERROR) {
             HAL_GPIO_WritePin(RELAY1_GPIO_Port, RELAY1_Pin, GPIO_PIN_SET);
             HAL_GPIO_WritePin(LED1_GPIO_Port, LED1_Pin, GPIO_PIN_SET); 
-            g_holdingRegisters[REG_RESET_FLAG] = 1;
+            HOLDING_REG(REG_RESET_FLAG) = 1;
             g_safety_system.system_status = SAFETY_MONITOR_ERROR;
-            return SAFETY_MONITOR_ERROR;
         }
         else if(system_status == SAFETY_MONITOR_OK) {
             HAL_GPIO_WritePin(RELAY1_GPIO_Port, RELAY1_Pin, GPIO_PIN_RESET);
             HAL_GPIO_WritePin(LED1_GPIO_Port, LED1_Pin, GPIO_PIN_RESET);
             g_safety_system.system_status = SAFETY_MONITOR_OK;
-            return SAFETY_MONITOR_OK;
         }
+#if SAFETY_FAST_TRIP_ENABLE
+        taskEXIT_CRITICAL();
+#endif
     }
     return system_status;
 }
 
-// Đọc cấu hình từ Modbus registers
+// Cấu hình đổi khoảng cách của một kênh, chép từ thanh ghi
+typedef struct {
+    uint16_t model;
+    uint16_t gain;
+    uint16_t exponent;
+    int16_t offset;
+    uint16_t curve[REG_ANALOG_CURVE_STRIDE];
+} Analog_Model_Config_t;
+
+static Analog_Model_Config_t s_model_config;    // Chỉ safety task dùng (stack task nhỏ)
+
+/**
+ * @brief Chép mô hình, gain/số mũ/offset và đường cong của kênh thành một bản nhất quán
+ * @note modbusTask (ưu tiên cao hơn) có thể chen vào giữa lúc chép và ghi xong cả một lệnh
+ *       FC16/FC23; khi số lệnh ghi nhóm analog đổi thì chép lại - không bao giờ dùng khối
+ *       lẫn giá trị của hai lệnh ghi
+ */
+static void Safety_Read_Model_Config(uint8_t sensor_id, Analog_Model_Config_t *config)
+{
+    uint32_t writes;
+    do {
+        writes = getAnalogWriteCount();
+        config->model = HOLDING_REG(REG_ANALOG_1_MODEL + sensor_id);
+        // Gain/số mũ riêng = 0 thì dùng thanh ghi chung
+        config->gain = HOLDING_REG(REG_ANALOG_1_GAIN + sensor_id);
+        config->exponent = HOLDING_REG(REG_ANALOG_1_EXPONENT + sensor_id);
+        if (config->gain == 0) config->gain = HOLDING_REG(REG_ANALOG_COEFFICIENT);
+        if (config->exponent == 0) config->exponent = HOLDING_REG(REG_ANALOG_CALIBRATION);
+        config->offset = (int16_t)HOLDING_REG(REG_ANALOG_1_OFFSET + sensor_id);
+        const uint16_t *curve = &HOLDING_REG(REG_ANALOG_CURVE(sensor_id));
+        for (uint8_t r = 0; r < REG_ANALOG_CURVE_STRIDE; r++) {
+            config->curve[r] = curve[r];
+        }
+    } while (writes != getAnalogWriteCount());
+}
+
+// Đọc cấu hình từ Modbus registers - chỉ các nhóm đã được modbus ghi
 HAL_StatusTypeDef Safety_Register_Load(void){
-    // Đọc cấu hình cho cảm biến analog
-    for(uint8_t i = 0; i < ANALOG_SENSOR_COUNT; i++) {
-        g_analog_sensors[i].sensor_active = g_holdingRegisters[REG_ANALOG_1_ENABLE + i];
-        g_analog_sensors[i].calibration_gain = 
-            (float)g_holdingRegisters[REG_ANALOG_COEFFICIENT];
-        g_analog_sensors[i].calibration_offset = 
-            (float)g_holdingRegisters[REG_ANALOG_CALIBRATION];
+    uint32_t dirty = takeDirtyRegisters();
+
+    if (dirty & REG_GROUP_ANALOG_CONFIG) {
+        uint8_t calibration_error = 0;
+
+        // Đọc cấu hình cho cảm biến analog
+        for(uint8_t i = 0; i < ANALOG_SENSOR_COUNT; i++) {
+            Safety_Read_Model_Config(i, &s_model_config);
+            const Analog_Model_Config_t *config = &s_model_config;
+            if (config->model == ANALOG_MODEL_CURVE) {
+                if (Safety_Load_Sensor_Curve(i, config->curve) != HAL_OK) {
+                    calibration_error = 1;
+                }
+            } else if (config->model == ANALOG_MODEL_POWER_LAW) {
+                // Chỉ tạo lại bảng của kênh có tham số thay đổi
+                const Distance_Map_t *map = Safety_Distance_Map(i);
+                if (map->model != ANALOG_MODEL_POWER_LAW || config->gain != map->params.gain ||
+                    config->exponent != map->params.exponent || config->offset != map->params.offset) {
+                    Safety_Build_Distance_Table(i, config->gain, config->exponent, config->offset);
+                }
+            } else {
+                calibration_error = 1;
+            }
+
+            g_analog_sensors[i].sensor_active = HOLDING_REG(REG_ANALOG_1_ENABLE + i);
+            Analog_Filter_Configure(i, (uint8_t)HOLDING_REG(REG_ANALOG_1_FILTER_TYPE + i),
+                                    (uint8_t)HOLDING_REG(REG_ANALOG_1_FILTER_PARAM + i));
+        }
+
+        if (calibration_error) {
+            HOLDING_REG(REG_SAFETY_ERROR_CODE) |= SAFETY_ERROR_CALIBRATION;
+        } else {
+            HOLDING_REG(REG_SAFETY_ERROR_CODE) &= (uint16_t)~SAFETY_ERROR_CALIBRATION;
+        }
     }
     
-    // Đọc cấu hình cho cảm biến digital
-    for(uint8_t i = 0; i < DIGITAL_SENSOR_COUNT; i++) {
-        g_digital_sensors[i].sensor_active = g_holdingRegisters[REG_DI1_ENABLE + i];
-        g_digital_sensors[i].active_level = g_holdingRegisters[REG_DI1_ACTIVE_LEVEL + i];
-        g_digital_sensors[i].debounce_time_ms = DEFAULT_SAFETY_RESPONSE_TIME;
+    if (dirty & REG_GROUP_DIGITAL_CONFIG) {
+        // Đọc cấu hình cho cảm biến digital
+        for(uint8_t i = 0; i < DIGITAL_SENSOR_COUNT; i++) {
+            g_digital_sensors[i].sensor_active = HOLDING_REG(REG_DI1_ENABLE + i);
+            g_digital_sensors[i].active_level = HOLDING_REG(REG_DI1_ACTIVE_LEVEL + i);
+            g_digital_sensors[i].debounce_time_ms = HOLDING_REG(REG_DI_DEBOUNCE_TIME);
+        }
+    }
+
+    // Ngưỡng vùng, ngân sách phản ứng và chu kỳ đổi cùng lúc, không bao giờ lẫn bộ cũ và mới
+    uint8_t params_changed = Safety_Params_Acquire();
+    if (params_changed) {
+        Safety_Params_Apply(&s_params[s_params_active]);
+        HOLDING_REG(REG_SAFETY_ERROR_CODE) &= (uint16_t)~SAFETY_ERROR_PARAMETERS;
+    }
+
+    if (params_changed || (dirty & (REG_GROUP_ANALOG_CONFIG | REG_GROUP_DIGITAL_CONFIG))) {
+        Safety_Update_Code_Thresholds();
+    }
+
+    if ((dirty & REG_GROUP_SYSTEM_CONFIG) && HOLDING_REG(REG_RESET_ERROR_COMMAND) == 1) {
+        // Reset lỗi: xóa lỗi thời gian phản ứng và bắt đầu lại giá trị lớn nhất
+        HOLDING_REG(REG_RESET_ERROR_COMMAND) = 0;
+        HOLDING_REG(REG_SAFETY_ERROR_CODE) &= (uint16_t)~SAFETY_ERROR_REACTION_TIME;
+        g_reaction_stats.worst_us = 0;
+        s_reaction_publish = 1;
     }
     return HAL_OK;
 
 }
 
+// Ghi giá trị quá trình vào thanh ghi chỉ khi thay đổi
+static inline void Safety_Publish_Register(uint16_t address, uint16_t value) {
+    if (HOLDING_REG(address) != value) {
+        HOLDING_REG(address) = value;
+    }
+}
+
+/**
+ * @brief Chụp trạng thái của chu kỳ vừa đánh giá vào bộ đệm sau rồi đổi bộ đệm
+ * @note Chỉ safety task ghi s_snapshot và s_snapshot_front
+ */
+static void Safety_Publish_Snapshot(void)
+{
+    uint8_t back = s_snapshot_front ^ 1U;
+    uint16_t *regs = s_snapshot[back];
+    uint16_t di_state = 0;
+    uint16_t analog_status = 0;
+    uint16_t di_status = 0;
+
+    regs[REG_SNAPSHOT_SEQUENCE - REG_SNAPSHOT_BASE] = ++s_snapshot_sequence;
+    regs[REG_SNAPSHOT_SYSTEM_STATUS - REG_SNAPSHOT_BASE] = (uint16_t)g_safety_system.system_status;
+    regs[REG_SNAPSHOT_RESET_FLAG - REG_SNAPSHOT_BASE] = HOLDING_REG(REG_RESET_FLAG);
+    regs[REG_SNAPSHOT_ERROR_CODE - REG_SNAPSHOT_BASE] = HOLDING_REG(REG_SAFETY_ERROR_CODE);
+    for (uint8_t i = 0; i < ANALOG_SENSOR_COUNT; i++) {
+#if SAFETY_CLASSIFY_RAW_CODE
+        s_snapshot_code[back][i] = g_analog_sensors[i].sensor_active ? s_cycle_code[i] : SNAPSHOT_CODE_INACTIVE;
+#else
+        regs[REG_SNAPSHOT_ANALOG_1 - REG_SNAPSHOT_BASE + i] = g_analog_sensors[i].sensor_active ?
+            (uint16_t)SAFETY_VALUE_TO_INT(g_analog_sensors[i].filtered_value) : 0U;
+#endif
+        analog_status |= (uint16_t)((g_analog_sensors[i].sensor_status & 0x0FU) << (4U * i));
+    }
+    for (uint8_t i = 0; i < DIGITAL_SENSOR_COUNT; i++) {
+        di_state |= (uint16_t)((g_digital_sensors[i].sensor_state ? 1U : 0U) << i);
+        di_status |= (uint16_t)((g_digital_sensors[i].sensor_status & 0x0FU) << (4U * i));
+    }
+    regs[REG_SNAPSHOT_DI_STATE - REG_SNAPSHOT_BASE] = di_state;
+    regs[REG_SNAPSHOT_ANALOG_STATUS - REG_SNAPSHOT_BASE] = analog_status;
+    regs[REG_SNAPSHOT_DI_STATUS - REG_SNAPSHOT_BASE] = di_status;
+    regs[REG_SNAPSHOT_SYSTEM_ERROR - REG_SNAPSHOT_BASE] = HOLDING_REG(REG_SYSTEM_ERROR);
+    regs[REG_SNAPSHOT_LOOP_OVERRUN - REG_SNAPSHOT_BASE] = (uint16_t)(g_safety_system.loop_overrun_count >> 16);
+    regs[REG_SNAPSHOT_LOOP_OVERRUN - REG_SNAPSHOT_BASE + 1] = (uint16_t)g_safety_system.loop_overrun_count;
+
+    // Ghi xong bộ đệm rồi mới công bố
+    __atomic_store_n(&s_snapshot_front, back, __ATOMIC_RELEASE);
+}
+
 // Lưu dữ liệu vào Modbus registers
+// Chỉ ghi giá trị quá trình; thanh ghi cấu hình (enable, baudrate) không bị ghi đè
+// để không làm mất lệnh ghi của master giữa hai lần Load/Save
 HAL_StatusTypeDef Safety_Register_Save(void) {
 
-    // Lưu dữ liệu cảm biến analog
+#if !SAFETY_CLASSIFY_RAW_CODE
+    // Lưu giá trị khoảng cách đã xử lý của cảm biến analog
+    // (chế độ mã thô: Safety_Refresh_Analog_Registers tính khi master đọc)
     for(uint8_t i = 0; i < ANALOG_SENSOR_COUNT; i++) {
-        // Lưu giá trị điện áp đã được xử lý (mV)
-        g_holdingRegisters[REG_ANALOG_INPUT_1 + i] = 
-            (uint16_t)(g_analog_sensors[i].filtered_value);
-        
-        // Lưu trạng thái kích hoạt của cảm biến
-        g_holdingRegisters[REG_ANALOG_1_ENABLE + i] = 
-            g_analog_sensors[i].sensor_active;
+        Safety_Publish_Register(REG_ANALOG_INPUT_1 + i,
+            (uint16_t)SAFETY_VALUE_TO_INT(g_analog_sensors[i].filtered_value));
     }
+#endif
     
-    // Lưu dữ liệu cảm biến digital 
+    // Lưu trạng thái cảm biến digital 
     for(uint8_t i = 0; i < DIGITAL_SENSOR_COUNT; i++) {
-        // Lưu trạng thái và cấu hình của cảm biến digital
-        g_holdingRegisters[REG_DI1_STATUS + i] = 
-            g_digital_sensors[i].sensor_state;
-        g_holdingRegisters[REG_DI1_ENABLE + i] = 
-            g_digital_sensors[i].sensor_active;
-    }
-    // if(g_holdingRegisters[REG_RESET_FLAG] == 1) {
-    //     g_holdingRegisters[REG_SAFETY_SYSTEM_STATUS] = SAFETY_MONITOR_CRITICAL;
-    // }
-    // else {
-    //     g_holdingRegisters[REG_SAFETY_SYSTEM_STATUS] = g_safety_system.system_status;
-    // }
-    g_holdingRegisters[REG_SAFETY_SYSTEM_STATUS] = g_safety_system.system_status;
-    g_holdingRegisters[REG_CONFIG_BAUDRATE] = current_baudrate;
+        Safety_Publish_Register(REG_DI1_STATUS + i, g_digital_sensors[i].sensor_state);
+    }
+    Safety_Publish_Register(REG_SAFETY_SYSTEM_STATUS, g_safety_system.system_status);
+    g_inputRegisters[INPUT_REG_LOOP_OVERRUN] = (uint16_t)(g_safety_system.loop_overrun_count >> 16);
+    g_inputRegisters[INPUT_REG_LOOP_OVERRUN + 1] = (uint16_t)g_safety_system.loop_overrun_count;
+
+    // Thống kê thời gian phản ứng chỉ thay đổi khi có lần tác động mới hoặc reset
+    if (s_reaction_publish) {
+        s_reaction_publish = 0;
+        uint16_t *regs = &g_inputRegisters[INPUT_REG_REACTION_BASE];
+        regs[0] = (uint16_t)(g_reaction_stats.count >> 16);
+        regs[1] = (uint16_t)g_reaction_stats.count;
+        regs[2] = (uint16_t)(g_reaction_stats.last_us >> 16);
+        regs[3] = (uint16_t)g_reaction_stats.last_us;
+        regs[4] = (uint16_t)(g_reaction_stats.worst_us >> 16);
+        regs[5] = (uint16_t)g_reaction_stats.worst_us;
+        regs[6] = (uint16_t)(g_reaction_stats.over_budget_count >> 16);
+        regs[7] = (uint16_t)g_reaction_stats.over_budget_count;
+        for (uint8_t b = 0; b < REACTION_HIST_BUCKETS; b++) {
+            regs[8 + b] = (g_reaction_stats.hist[b] > 0xFFFFU) ? 0xFFFFU : (uint16_t)g_reaction_stats.hist[b];
+        }
+    }
+
+    Safety_Publish_Snapshot();
     return HAL_OK;
 }
 
 
 uint8_t Safety_Get_Digital_State(uint8_t sensor_id){
-    
-    switch (sensor_id)
-    {
-    case 0:
-        g_digital_sensors[0].sensor_value = HAL_GPIO_ReadPin(DI1_GPIO_Port, DI1_Pin);
-        return g_digital_sensors[0].sensor_value;
-        break;
-    case 1:
-        g_digital_sensors[1].sensor_value = HAL_GPIO_ReadPin(DI2_GPIO_Port, DI2_Pin);
-        return g_digital_sensors[1].sensor_value;
-        break;
-    case 2:
-        g_digital_sensors[2].sensor_value = HAL_GPIO_ReadPin(DI3_GPIO_Port, DI3_Pin);
-        return g_digital_sensors[2].sensor_value;
-        break;
-    case 3:
-        g_digital_sensors[3].sensor_value = HAL_GPIO_ReadPin(DI4_GPIO_Port, DI4_Pin);
-        return g_digital_sensors[3].sensor_value;
-        break;
-    default:
+    if (sensor_id >= DIGITAL_SENSOR_COUNT) {
         return 0;
     }
+    return g_digital_sensors[sensor_id].debounced_state;
 }
 
 Safety_Monitor_Status_t Safety_Get_System_Status(void){
     return g_safety_system.system_status;
 }
 
+uint8_t Safety_Outputs_Tripped(void)
+{
+    // Đọc thanh ghi ODR (mức đã ra lệnh) - RELAY1 chỉ được nhả bởi safety task sau khi master reset
+    return (RELAY1_GPIO_Port->ODR & RELAY1_Pin) != 0U;
+}
+
+/**
+ * @brief Decimate one half of the ADC DMA ring into adc_buffer
+ * @param samples: First sample of the half buffer (ADC_OVERSAMPLE_RATIO scans)
+ * @note Cộng ADC_OVERSAMPLE_RATIO mẫu rồi dịch phải ADC_OVERSAMPLE_BITS, sau đó qua bộ lọc của kênh.
+ *       Mốc lùi về lần quét đầu của nửa bộ đệm: mẫu vượt ngưỡng có thể đã nằm trong DMA từ lúc đó
+ */
+static void Safety_Decimate_ADC(const uint16_t *samples)
+{
+    uint32_t stamp = Profiler_Now() - ADC_HALF_BUFFER_US * PROFILER_TICKS_PER_US;
+    uint32_t sum[ANALOG_SENSOR_COUNT] = {0};
+
+    for (uint32_t n = 0; n < ADC_OVERSAMPLE_RATIO; n++) {
+        for (uint8_t ch = 0; ch < ANALOG_SENSOR_COUNT; ch++) {
+            sum[ch] += *samples++;
+        }
+    }
+    for (uint8_t ch = 0; ch < ANALOG_SENSOR_COUNT; ch++) {
+        uint16_t raw = (uint16_t)(sum[ch] >> ADC_OVERSAMPLE_BITS);
+        adc_buffer[ch] = Analog_Filter_Process(ch, raw);
+#if SAFETY_FAST_TRIP_ENABLE
+        // So trên mã chưa lọc: bộ lọc chậm (trung bình 16 mẫu) không được làm trễ đường cắt nhanh.
+        // Khoảng cách giảm khi mã tăng: mã >= ngưỡng nghĩa là đã vào vùng 1
+        if (raw >= s_fast_trip_code[ch]) {
+            Safety_Fast_Trip(stamp);
+        }
+#endif
+    }
+    s_adc_sample_stamp = stamp;
+    s_adc_sample_ready = 1;
+}
+
+uint8_t Safety_Monitor_Sample_Ready(void)
+{
+    return s_adc_sample_ready;
+}
+
+void HAL_ADC_ConvHalfCpltCallback(ADC_HandleTypeDef *hadc)
+{
+    if (hadc->Instance == ADC1) {
+        Safety_Decimate_ADC(&adc_dma_buffer[0]);
+    }
+}
+
+void HAL_ADC_ConvCpltCallback(ADC_HandleTypeDef *hadc)
+{
+    if (hadc->Instance == ADC1) {
+        Safety_Decimate_ADC(&adc_dma_buffer[ADC_DMA_BUFFER_LENGTH / 2U]);
+    }
+}
+
+/**
+ * @brief EXTI callback for DI1-DI4 (PB12-PB15, cả hai sườn)
+ * @note Chỉ ghi lại thời điểm sườn; chống dội chạy trong Safety_Process_Digital_Sensors
+ */
+void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin)
+{
+    uint32_t channel_bit = (uint32_t)GPIO_Pin >> DI_GPIO_SHIFT;
+
+    if (channel_bit == 0U || channel_bit > DI_GPIO_MASK) {
+        return;
+    }
+    uint8_t channel = (uint8_t)__builtin_ctz(channel_bit);
+    uint32_t stamp = Profiler_Now();
+#if SAFETY_FAST_TRIP_ENABLE
+    // Đầu vào kiểu dừng khẩn: cắt ngay ở sườn đầu tiên vào mức tích cực, không chờ chống dội
+    if ((s_fast_trip_di_mask & channel_bit) &&
+        ((DI_READ_ALL() ^ s_fast_trip_di_level) & channel_bit) == 0U) {
+        Safety_Fast_Trip(stamp);
+    }
+#endif
+    s_di_edge_stamp[channel] = stamp;
+    s_di_edge_time[channel] = HAL_GetTick();
+    __atomic_fetch_or(&s_di_edge_pending, (uint8_t)channel_bit, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Build the piecewise-linear ADC code -> distance table of one channel
+ * @param sensor_id: Sensor ID (0-3)
+ * @param gain: Gain x100
+ * @param exponent: Exponent x100
+ * @param offset: Distance offset x100 (signed)
+ * @return HAL_StatusTypeDef
+ * @note distance = gain/100 * V^(-exponent/100) + offset/100, sampled every
+ *       2^DISTANCE_LUT_SHIFT codes. The power term is clamped to DISTANCE_LUT_MAX
+ *       before the offset is added, so the table stays monotonic. The table is built in
+ *       the spare slot and published with an index swap.
+ */
+HAL_StatusTypeDef Safety_Build_Distance_Table(uint8_t sensor_id, uint16_t gain, uint16_t exponent, int16_t offset)
+{
+    if (sensor_id >= ANALOG_SENSOR_COUNT) return HAL_ERROR;
+
+    Distance_Map_t *map = &s_distance_maps[s_distance_map_spare];
+    Safety_Value_t *lut = map->lut;
+    float k = gain / 100.0f;
+    float p = exponent / -100.0f;
+    float shift = offset / 100.0f;
+
+    for (uint16_t i = 0; i < DISTANCE_LUT_SIZE; i++) {
+        float voltage = (float)(i << DISTANCE_LUT_SHIFT) * ADC_VREF / (float)ADC_CODE_MAX;
+        float entry = (voltage > 0.0f) ? k * powf(voltage, p) : DISTANCE_LUT_MAX;
+        if (entry > DISTANCE_LUT_MAX) entry = DISTANCE_LUT_MAX;
+        lut[i] = SAFETY_VALUE_FROM_FLOAT(entry + shift);
+    }
+
+    // Mã ADC nhỏ nhất có điện áp >= DISTANCE_MIN_VOLTAGE; bảng chỉ đơn điệu giảm khi số mũ > 0
+    map->min_code = (uint16_t)ceilf(DISTANCE_MIN_VOLTAGE * (float)ADC_CODE_MAX / ADC_VREF);
+    map->monotonic = (exponent > 0);
+    // Luật lũy thừa: dải đo của cảm biến giới hạn bằng khoảng cách
+    map->valid_code_min = 0;
+    map->valid_code_max = ADC_CODE_MAX;
+    map->valid_min = DISTANCE_VALID_MIN;
+    map->valid_max = DISTANCE_VALID_MAX;
+    map->model = ANALOG_MODEL_POWER_LAW;
+    map->params.gain = gain;
+    map->params.exponent = exponent;
+    map->params.offset = offset;
+    Safety_Distance_Map_Publish(sensor_id);
+
+    g_analog_sensors[sensor_id].calibration_gain = SAFETY_VALUE_FROM_FLOAT(k);
+    g_analog_sensors[sensor_id].calibration_exponent = SAFETY_VALUE_FROM_FLOAT(-p);
+    g_analog_sensors[sensor_id].calibration_offset = SAFETY_VALUE_FROM_FLOAT(shift);
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef Safety_Load_Sensor_Curve(uint8_t sensor_id, const uint16_t *regs)
+{
+    if (sensor_id >= ANALOG_SENSOR_COUNT) return HAL_ERROR;
+
+    uint16_t count = regs[0];
+    const uint16_t *points = &regs[1];
+    if (count < 2 || count > ANALOG_CURVE_MAX_POINTS) return HAL_ERROR;
+
+    // Mã phải tăng ngặt để mỗi đoạn có độ rộng > 0 và tìm nhị phân được
+    for (uint8_t k = 0; k < count; k++) {
+        if (points[2 * k] > ADC_CODE_MAX) return HAL_ERROR;
+        if (k > 0 && points[2 * k] <= points[2 * (k - 1)]) return HAL_ERROR;
+    }
+
+    Distance_Map_t *map = &s_distance_maps[s_distance_map_spare];
+    Sensor_Curve_t *curve = &map->curve;
+    uint8_t monotonic = 1;
+    for (uint8_t k = 0; k < count; k++) {
+        curve->code[k] = points[2 * k];
+        curve->value[k] = (int16_t)points[2 * k + 1];
+        if (k > 0 && curve->value[k] > curve->value[k - 1]) {
+            monotonic = 0;
+        }
+    }
+    curve->count = (uint8_t)count;
+
+    // Ngoài hai đầu đường cong giữ giá trị điểm đầu/cuối để hiển thị, nhưng dải đo là
+    // [mã điểm đầu, mã điểm cuối]: mã ngoài dải (hở mạch, ngắn mạch) là lỗi cảm biến.
+    // Mọi giá trị trên đường cong đều hợp lệ, không áp dụng DISTANCE_VALID_MIN/MAX.
+    map->min_code = 0;
+    map->monotonic = monotonic;
+    map->valid_code_min = curve->code[0];
+    map->valid_code_max = curve->code[count - 1U];
+    map->valid_min = INT16_MIN;
+    map->valid_max = INT16_MAX;
+    map->model = ANALOG_MODEL_CURVE;
+    Safety_Distance_Map_Publish(sensor_id);
+    return HAL_OK;
+}
+
+/**
+ * @brief Nội suy đường cong điểm gãy
+ * @note Tìm nhị phân đoạn chứa mã (<= 4 bước với 16 điểm) rồi nội suy bằng hai phép chia
+ *       32 bit (SDIV): phần nguyên và phần dư đổi sang phần lẻ Q16.16. |dy * dx| < 2^31.
+ */
+static Safety_Value_t Safety_Evaluate_Curve(const Sensor_Curve_t *curve, uint16_t code)
+{
+    uint8_t last = curve->count - 1U;
+
+    if (code <= curve->code[0]) return SAFETY_VALUE_FROM_INT(curve->value[0]);
+    if (code >= curve->code[last]) return SAFETY_VALUE_FROM_INT(curve->value[last]);
+
+    // code[lo] <= code < code[hi]
+    uint8_t lo = 0;
+    uint8_t hi = last;
+    while (hi - lo > 1U) {
+        uint8_t mid = (uint8_t)((lo + hi) >> 1);
+        if (curve->code[mid] <= code) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+
+    int32_t dx = (int32_t)curve->code[hi] - curve->code[lo];
+    int32_t dy = (int32_t)curve->value[hi] - curve->value[lo];
+    int32_t num = dy * (int32_t)(code - curve->code[lo]);
+#if SAFETY_USE_FIXED_POINT
+    int32_t whole = num / dx;
+    int32_t rem = num % dx;
+    return SAFETY_VALUE_FROM_INT(curve->value[lo] + whole) +
+           (Safety_Value_t)((rem * (1L << SAFETY_VALUE_FRAC_BITS)) / dx);
+#else
+    return (float)curve->value[lo] + (float)num / (float)dx;
+#endif
+}
+
+// Khoảng cách theo một bảng đổi cho một mã ADC (mã >= map->min_code)
+static Safety_Value_t Safety_Lookup_Distance(const Distance_Map_t *map, uint16_t code)
+{
+    if (map->model == ANALOG_MODEL_CURVE) {
+        return Safety_Evaluate_Curve(&map->curve, code);
+    }
+
+    const Safety_Value_t *lut = map->lut;
+    uint16_t index = code >> DISTANCE_LUT_SHIFT;
+    uint32_t frac = code & ((1U << DISTANCE_LUT_SHIFT) - 1U);
+    Safety_Value_t y0 = lut[index];
+    Safety_Value_t y1 = lut[index + 1];
+#if SAFETY_USE_FIXED_POINT
+    Safety_Value_t distance = y0 + (Safety_Value_t)(((int64_t)(y1 - y0) * frac) >> DISTANCE_LUT_SHIFT);
+#else
+    Safety_Value_t distance = y0 + (y1 - y0) * (float)frac * (1.0f / (1U << DISTANCE_LUT_SHIFT));
+#endif
+    return distance;
+}
+
 /**
- * @brief Read analog sensor value from ADC
- * @param sensor_id: Sensor ID (0-3) 
- * @return uint16_t Raw ADC value (0-4095)
- * @note Đọc giá trị cảm biến analog từ ADC với xử lý lỗi toàn diện
+ * @brief Mã ADC nhỏ nhất có khoảng cách (phần nguyên, như task so sánh) <= limit
+ * @return uint16_t ADC_CODE_MAX + 1 nếu không có mã nào
+ * @note Tìm nhị phân trên bảng tra đơn điệu giảm - chỉ chạy khi thanh ghi thay đổi
  */
+static uint16_t Safety_Distance_To_Code(const Distance_Map_t *map, int32_t limit)
+{
+    uint16_t lo = map->min_code;
+    uint16_t hi = ADC_CODE_MAX + 1U;
+
+    while (lo < hi) {
+        uint16_t mid = (uint16_t)((lo + hi) >> 1);
+        if (SAFETY_VALUE_TO_INT(Safety_Lookup_Distance(map, mid)) <= limit) {
+            hi = mid;
+        } else {
+            lo = mid + 1U;
+        }
+    }
+    return lo;
+}
 
-float Safety_Convert_To_Distance(uint8_t sensor_id){
-    float distance, voltage;
-    voltage = adc_buffer[sensor_id] * 3.3f / 4095.0f;
-    if(voltage < 0.1f) return 0;
+void Safety_Update_Code_Thresholds(void)
+{
+    const Safety_Params_t *params = &s_params[s_params_active];
+
+    for (uint8_t i = 0; i < ANALOG_SENSOR_COUNT; i++) {
+        const Distance_Map_t *map = Safety_Distance_Map(i);
+        // Chỉ đổi ngưỡng sang mã ADC khi khoảng cách đơn điệu giảm; nếu không kênh đó so sánh theo khoảng cách
+        s_code_thresholds_valid[i] = map->monotonic;
+
+#if SAFETY_CLASSIFY_RAW_CODE
+        if (s_code_thresholds_valid[i]) {
+            for (uint8_t z = 0; z < 4; z++) {
+                s_zone_code[i][z] = Safety_Distance_To_Code(map, SAFETY_PARAM(params, REG_SAFETY_ZONE1_THRESHOLD + z));
+            }
+            uint16_t far = Safety_Distance_To_Code(map, map->valid_max);
+            uint16_t near = Safety_Distance_To_Code(map, (int32_t)map->valid_min - 1);
+            s_code_valid_far[i] = (far > map->valid_code_min) ? far : map->valid_code_min;
+            s_code_valid_near[i] = (near <= map->valid_code_max) ? near : (uint16_t)(map->valid_code_max + 1U);
+        }
+#endif
+
+#if SAFETY_FAST_TRIP_ENABLE
+        uint16_t trip_code = FAST_TRIP_CODE_DISABLED;
+        if (s_code_thresholds_valid[i] && g_analog_sensors[i].sensor_active) {
+            uint16_t code = Safety_Distance_To_Code(map, SAFETY_PARAM(params, REG_SAFETY_ZONE1_THRESHOLD));
+            if (code <= ADC_CODE_MAX) {
+                trip_code = code;
+            }
+        }
+        s_fast_trip_code[i] = trip_code;
+#endif
+    }
 
-    distance = g_analog_sensors[sensor_id].calibration_gain/100.0f * powf(voltage, (g_analog_sensors[sensor_id].calibration_offset)/(-100.0f));
+#if SAFETY_FAST_TRIP_ENABLE
+    uint8_t di_mask = 0;
+    uint8_t di_level = 0;
+    for (uint8_t i = 0; i < DIGITAL_SENSOR_COUNT; i++) {
+        if (g_digital_sensors[i].sensor_active) {
+            di_mask |= (uint8_t)(1U << i);
+        }
+        if (g_digital_sensors[i].active_level) {
+            di_level |= (uint8_t)(1U << i);
+        }
+    }
+    s_fast_trip_di_level = di_level;
+    s_fast_trip_di_mask = di_mask;
+#endif
+}
+
+/**
+ * @brief Convert the current ADC sample of a sensor to distance
+ * @param sensor_id: Sensor ID (0-3)
+ * @return Safety_Value_t Distance; power-law model returns 0 below DISTANCE_MIN_VOLTAGE
+ * @note Bảng tra (luật lũy thừa) hoặc đường cong điểm gãy + nội suy tuyến tính, không gọi
+ *       powf. Ở chế độ Q16.16 toàn bộ phép tính là số nguyên.
+ */
+Safety_Value_t Safety_Convert_To_Distance(uint8_t sensor_id){
+    const Distance_Map_t *map = Safety_Distance_Map(sensor_id);
+    uint16_t code = adc_buffer[sensor_id];
+    if(code < map->min_code) return 0;
+
+    Safety_Value_t distance = Safety_Lookup_Distance(map, code);
     g_analog_sensors[sensor_id].filtered_value = distance;
     return distance;
 }
 
+// Phân loại theo khoảng cách (đã đổi sang số nguyên) trong miền hợp lệ của mô hình kênh
+static Analog_Zone_t Safety_Classify_Distance(uint8_t sensor_id, uint16_t code)
+{
+    const Distance_Map_t *map = Safety_Distance_Map(sensor_id);
+    if (code < map->valid_code_min || code > map->valid_code_max) return ANALOG_ZONE_ERROR;
+
+    Safety_Value_t value = (code < map->min_code) ? 0 : Safety_Lookup_Distance(map, code);
+    g_analog_sensors[sensor_id].filtered_value = value;
+    int32_t distance = SAFETY_VALUE_TO_INT(value);
+    if (distance < map->valid_min || distance > map->valid_max) return ANALOG_ZONE_ERROR;
+
+    const Safety_Params_t *params = &s_params[s_params_active];
+    if (distance <= SAFETY_PARAM(params, REG_SAFETY_ZONE1_THRESHOLD)) return ANALOG_ZONE_1;
+    if (distance <= SAFETY_PARAM(params, REG_SAFETY_ZONE2_THRESHOLD)) return ANALOG_ZONE_2;
+    if (distance <= SAFETY_PARAM(params, REG_SAFETY_ZONE3_THRESHOLD)) return ANALOG_ZONE_3;
+    if (distance <= SAFETY_PARAM(params, REG_SAFETY_ZONE4_THRESHOLD)) return ANALOG_ZONE_4;
+    return ANALOG_ZONE_SAFE;
+}
+
+#if SAFETY_CLASSIFY_RAW_CODE
+// Cùng kết quả với Safety_Classify_Distance nhưng chỉ so sánh số nguyên trên mã ADC
+static Analog_Zone_t Safety_Classify_Code(uint8_t sensor_id, uint16_t code)
+{
+    const uint16_t *zone_code = s_zone_code[sensor_id];
+
+    if (code < s_code_valid_far[sensor_id] || code >= s_code_valid_near[sensor_id]) return ANALOG_ZONE_ERROR;
+    if (code >= zone_code[0]) return ANALOG_ZONE_1;
+    if (code >= zone_code[1]) return ANALOG_ZONE_2;
+    if (code >= zone_code[2]) return ANALOG_ZONE_3;
+    if (code >= zone_code[3]) return ANALOG_ZONE_4;
+    return ANALOG_ZONE_SAFE;
+}
+#endif
+
+void Safety_Refresh_Analog_Registers(void)
+{
+#if SAFETY_CLASSIFY_RAW_CODE
+    for (uint8_t i = 0; i < ANALOG_SENSOR_COUNT; i++) {
+        if (g_analog_sensors[i].sensor_active) {
+            const Distance_Map_t *map = Safety_Distance_Map(i);
+            uint16_t code = adc_buffer[i];
+            int32_t distance = (code < map->min_code) ? 0 : SAFETY_VALUE_TO_INT(Safety_Lookup_Distance(map, code));
+            HOLDING_REG(REG_ANALOG_INPUT_1 + i) = (uint16_t)distance;
+        }
+    }
+#endif
+}
+
+void Safety_Refresh_Snapshot_Registers(void)
+{
+    uint8_t front = __atomic_load_n(&s_snapshot_front, __ATOMIC_ACQUIRE);
+    uint16_t *regs = &HOLDING_REG(REG_SNAPSHOT_BASE);
+
+    for (uint8_t i = 0; i < REG_SNAPSHOT_COUNT; i++) {
+        regs[i] = s_snapshot[front][i];
+    }
+#if SAFETY_CLASSIFY_RAW_CODE
+    // Cùng mã ADC mà chu kỳ đó đã phân vùng, nên khoảng cách khớp với trạng thái trong snapshot
+    for (uint8_t i = 0; i < ANALOG_SENSOR_COUNT; i++) {
+        const Distance_Map_t *map = Safety_Distance_Map(i);
+        uint16_t code = s_snapshot_code[front][i];
+        int32_t distance = 0;
+        if (code != SNAPSHOT_CODE_INACTIVE && code >= map->min_code) {
+            distance = SAFETY_VALUE_TO_INT(Safety_Lookup_Distance(map, code));
+        }
+        regs[REG_SNAPSHOT_ANALOG_1 - REG_SNAPSHOT_BASE + i] = (uint16_t)distance;
+    }
+#endif
+}
+
 /**
  * @brief Process all analog sensors with comprehensive error handling
  * @param None
@@ -290,45 +1105,61 @@ HAL_StatusTypeDef Safety_Process_Analog_Sensors(void)
 {
     HAL_StatusTypeDef overall_status = HAL_OK;
     uint32_t current_time = HAL_GetTick();
-    uint16_t distance;
+    Analog_Zone_t zone;
     uint8_t i;
     
+    // Lấy mốc trước khi đọc mã ADC: nếu ISR cập nhật giữa chừng thì thời gian phản ứng chỉ bị tính dư
+    uint32_t sample_stamp = s_adc_sample_stamp;
+
     // Process each analog sensor
     for (i = 0; i < ANALOG_SENSOR_COUNT; i++) {
         if (g_analog_sensors[i].sensor_active) {
-            // Read sensor value
-            distance = Safety_Convert_To_Distance(i);
+            uint16_t code = adc_buffer[i];
+#if SAFETY_CLASSIFY_RAW_CODE
+            s_cycle_code[i] = code;
+            if (s_code_thresholds_valid[i]) {
+                zone = Safety_Classify_Code(i, code);
+            } else
+#endif
+            {
+                // Read sensor value - so sánh ngưỡng bằng phần nguyên, không cần soft-float
+                zone = Safety_Classify_Distance(i, code);
+            }
             
-            // Kiểm tra các ngưỡng khoảng cách cho từng cảm biến
-            if(distance < 10 || distance > 95) {
+            switch (zone) {
+            case ANALOG_ZONE_ERROR:
                 // Cảm biến không hoạt động hoặc lỗi
                 g_analog_sensors[i].sensor_status = SENSOR_STATUS_ERROR;
                 g_analog_sensors[i].alarm_flags = 0x01;
-            }
-            else if(distance <= g_holdingRegisters[REG_SAFETY_ZONE1_THRESHOLD]) {
+                break;
+            case ANALOG_ZONE_1:
                 // Vùng nguy hiểm 1 - Nguy hiểm cao nhất
+                if (g_analog_sensors[i].sensor_status != SENSOR_STATUS_CRITICAL) {
+                    g_analog_sensors[i].critical_timestamp = sample_stamp;
+                }
                 g_analog_sensors[i].sensor_status = SENSOR_STATUS_CRITICAL;
                 g_analog_sensors[i].alarm_flags = 0x08;
-            }
-            else if(distance <= g_holdingRegisters[REG_SAFETY_ZONE2_THRESHOLD]) {
+                break;
+            case ANALOG_ZONE_2:
                 // Vùng nguy hiểm 2 - Cảnh báo cao
                 g_analog_sensors[i].sensor_status = SENSOR_STATUS_WARNING;
                 g_analog_sensors[i].alarm_flags = 0x04;
-            }
-            else if(distance <= g_holdingRegisters[REG_SAFETY_ZONE3_THRESHOLD]) {
+                break;
+            case ANALOG_ZONE_3:
                 // Vùng nguy hiểm 3 - Cảnh báo trung bình
                 g_analog_sensors[i].sensor_status = SENSOR_STATUS_WARNING;
                 g_analog_sensors[i].alarm_flags = 0x02;
-            }
-            else if(distance <= g_holdingRegisters[REG_SAFETY_ZONE4_THRESHOLD]) {
+                break;
+            case ANALOG_ZONE_4:
                 // Vùng nguy hiểm 4 - Cảnh báo thấp
                 g_analog_sensors[i].sensor_status = SENSOR_STATUS_OK;
                 g_analog_sensors[i].alarm_flags = 0x01;
-            }
-            else {
+                break;
+            default:
                 // Khoảng cách an toàn
                 g_analog_sensors[i].sensor_status = SENSOR_STATUS_OK;
                 g_analog_sensors[i].alarm_flags = 0;
+                break;
             }
         }
     }
@@ -338,13 +1169,43 @@ HAL_StatusTypeDef Safety_Process_Analog_Sensors(void)
 
 HAL_StatusTypeDef Safety_Process_Digital_Sensors(void){
     HAL_StatusTypeDef overall_status = HAL_OK;
-    uint32_t current_time = HAL_GetTick();
     uint8_t i;
     
+    // Đọc cả 4 chân một lần, lấy các sườn EXTI đã ghi nhận từ chu kỳ trước
+    uint8_t levels = DI_READ_ALL();
+    uint8_t edges = __atomic_exchange_n(&s_di_edge_pending, 0, __ATOMIC_RELAXED);
+    // Lấy tick SAU khi nhận sườn: mọi s_di_edge_time đã nhận đều <= current_time,
+    // nên hiệu không dấu bên dưới không thể tràn vòng và bỏ qua chống dội
+    uint32_t current_time = HAL_GetTick();
+
+    for (i = 0; i < DIGITAL_SENSOR_COUNT; i++) {
+        Digital_Sensor_t *di = &g_digital_sensors[i];
+        uint8_t raw = (levels >> i) & 1U;
+
+        // Mỗi sườn (EXTI hoặc mức thay đổi giữa hai lần đọc) khởi động lại cửa sổ chống dội
+        if (edges & (1U << i)) {
+            di->last_edge_time = s_di_edge_time[i];
+            di->edge_timestamp = s_di_edge_stamp[i];
+        } else if (raw != di->previous_state) {
+            di->last_edge_time = current_time;
+            di->edge_timestamp = Profiler_Now();
+        }
+        di->previous_state = raw;
+
+        di->rising_edge_detected = 0;
+        di->falling_edge_detected = 0;
+        if (raw != di->debounced_state &&
+            (current_time - di->last_edge_time) >= di->debounce_time_ms) {
+            di->debounced_state = raw;
+            di->rising_edge_detected = raw;
+            di->falling_edge_detected = !raw;
+            di->state_change_count++;
+        }
+    }
+
     for (i = 0; i < DIGITAL_SENSOR_COUNT; i++) {
         if (g_digital_sensors[i].sensor_active) {
-            // Read sensor value
-            g_digital_sensors[i].sensor_value = Safety_Get_Digital_State(i);
+            g_digital_sensors[i].sensor_value = g_digital_sensors[i].debounced_state;
             if(g_digital_sensors[i].sensor_value == g_digital_sensors[i].active_level) {
                 g_digital_sensors[i].sensor_status = SENSOR_STATUS_CRITICAL;
                 g_digital_sensors[i].sensor_state = 1;
@@ -1,31 +1,65 @@
 #include "UartModbus.h"
-#include "stm32f1xx_hal.h"
-#include "stm32f1xx_it.h"
 #include "main.h"
 #include "ModbusMap.h"
+#include "Profiler.h"
+#include "Safety_Monitor.h"
+#include "Config_Store.h"
+#include "Analog_Filter.h"
 
 
 
 // Global register arrays definition
-uint16_t g_holdingRegisters[HOLDING_REG_COUNT];
+uint16_t g_holdingRegisters[HOLDING_REG_STORAGE];
 uint16_t g_inputRegisters[INPUT_REG_COUNT];
-uint8_t g_coils[COIL_COUNT];
-uint8_t g_discreteInputs[DISCRETE_COUNT];
+volatile uint32_t g_registerDirtyMask = 0;
+static volatile uint32_t s_analogWriteCount;
 
 // Task counters
 uint32_t g_taskCounter = 0;
 uint32_t g_modbusCounter = 0;
 
 // UART buffer variables
-uint8_t rxBuffer[RX_BUFFER_SIZE];
-uint8_t rxIndex = 0;
-uint8_t frameReceived = 0;
-uint32_t g_lastUARTActivity = 0;
+volatile uint32_t g_lastUARTActivity = 0;
 
 // Diagnostic variables
 uint32_t g_totalReceived = 0;
 uint32_t g_corruptionCount = 0;
 uint8_t g_receivedIndex = 0;
+uint32_t g_rxDroppedFrames = 0;
+uint32_t g_rxQueueOverflows = 0;
+uint8_t g_rxQueuePeak = 0;
+uint32_t g_txFrames = 0;
+uint32_t g_txDroppedFrames = 0;
+
+// Vòng DMA nhận (circular) và vị trí đã đọc đến
+static uint8_t s_rxDmaBuffer[RX_DMA_BUFFER_SIZE];
+static uint16_t s_rxDmaPos = 0;
+static uint8_t s_rxDiscard = 0;   // Bỏ phần còn lại của khung đang nhận (quá dài hoặc hàng đợi đầy)
+static uint16_t s_rxIndex = 0;    // Số byte của khung đang nhận, chỉ ISR dùng
+static uint16_t s_rxCRC = MODBUS_CRC_INIT;  // CRC tính dần khi chép byte từ vòng DMA
+
+/* Hàng đợi khung nhận một producer (ISR UART) - một consumer (modbusTask), không khóa.
+ * s_rxHead chỉ ISR ghi, s_rxTail chỉ task ghi; hai chỉ số chạy tự do, ô = chỉ số % độ sâu,
+ * head - tail = số khung đang chờ. ISR nhận thẳng vào ô s_rxHead và chỉ tăng s_rxHead (release)
+ * khi đã có đủ khung; task trả ô bằng cách tăng s_rxTail sau khi xử lý xong. */
+_Static_assert((MODBUS_RX_QUEUE_DEPTH & (MODBUS_RX_QUEUE_DEPTH - 1)) == 0 && MODBUS_RX_QUEUE_DEPTH <= 128,
+               "MODBUS_RX_QUEUE_DEPTH must be a power of two, at most 128");
+static Modbus_Rx_Frame_t s_rxQueue[MODBUS_RX_QUEUE_DEPTH];
+static uint8_t s_rxHead = 0;
+static uint8_t s_rxTail = 0;
+#define RX_QUEUE_SLOT(index)    (&s_rxQueue[(index) & (MODBUS_RX_QUEUE_DEPTH - 1)])
+
+// Bộ đệm phát tĩnh cho DMA; s_txBusy = 1 từ lúc bắt đầu phát đến HAL_UART_TxCpltCallback
+static uint8_t s_txBuffer[TX_BUFFER_SIZE];
+static volatile uint8_t s_txBusy = 0;
+
+#ifdef MODBUS_RS485_DE_Pin
+#define RS485_DRIVER_ENABLE()   HAL_GPIO_WritePin(MODBUS_RS485_DE_GPIO_Port, MODBUS_RS485_DE_Pin, GPIO_PIN_SET)
+#define RS485_DRIVER_DISABLE()  HAL_GPIO_WritePin(MODBUS_RS485_DE_GPIO_Port, MODBUS_RS485_DE_Pin, GPIO_PIN_RESET)
+#else
+#define RS485_DRIVER_ENABLE()   ((void)0)
+#define RS485_DRIVER_DISABLE()  ((void)0)
+#endif
 
 
 
@@ -33,40 +67,53 @@ void initializeModbusRegisters(void) {
     // Initialize all registers to default values
     
     // System Registers (0x00F0-0x00F6)
-    g_holdingRegisters[REG_DEVICE_ID] = DEFAULT_DEVICE_ID;  
-    g_holdingRegisters[REG_CONFIG_BAUDRATE] = DEFAULT_CONFIG_BAUDRATE;
-    g_holdingRegisters[REG_CONFIG_PARITY] = DEFAULT_CONFIG_PARITY;
-    g_holdingRegisters[REG_CONFIG_STOP_BIT] = DEFAULT_CONFIG_STOP_BIT;
-    g_holdingRegisters[REG_MODULE_TYPE] = DEFAULT_MODULE_TYPE;
-    g_holdingRegisters[REG_FIRMWARE_VERSION] = DEFAULT_FIRMWARE_VERSION;
-    g_holdingRegisters[REG_HARDWARE_VERSION] = DEFAULT_HARDWARE_VERSION;
-    g_holdingRegisters[REG_SYSTEM_STATUS] = DEFAULT_SYSTEM_STATUS;
-    g_holdingRegisters[REG_SYSTEM_ERROR] = DEFAULT_SYSTEM_ERROR;
-    g_holdingRegisters[REG_RESET_ERROR_COMMAND] = DEFAULT_RESET_ERROR_COMMAND;
+    HOLDING_REG(REG_DEVICE_ID) = DEFAULT_DEVICE_ID;  
+    HOLDING_REG(REG_CONFIG_BAUDRATE) = DEFAULT_CONFIG_BAUDRATE;
+    HOLDING_REG(REG_CONFIG_PARITY) = DEFAULT_CONFIG_PARITY;
+    HOLDING_REG(REG_CONFIG_STOP_BIT) = DEFAULT_CONFIG_STOP_BIT;
+    HOLDING_REG(REG_MODULE_TYPE) = DEFAULT_MODULE_TYPE;
+    HOLDING_REG(REG_FIRMWARE_VERSION) = DEFAULT_FIRMWARE_VERSION;
+    HOLDING_REG(REG_HARDWARE_VERSION) = DEFAULT_HARDWARE_VERSION;
+    HOLDING_REG(REG_SYSTEM_STATUS) = DEFAULT_SYSTEM_STATUS;
+    HOLDING_REG(REG_SYSTEM_ERROR) = DEFAULT_SYSTEM_ERROR;
+    HOLDING_REG(REG_RESET_ERROR_COMMAND) = DEFAULT_RESET_ERROR_COMMAND;
     
     // Safety Module Registers (0x0000-0x000C)
-    g_holdingRegisters[REG_ANALOG_1_ENABLE] = DEFAULT_ANALOG_1_ENABLE;
-    g_holdingRegisters[REG_ANALOG_2_ENABLE] = DEFAULT_ANALOG_2_ENABLE;
-    g_holdingRegisters[REG_ANALOG_3_ENABLE] = DEFAULT_ANALOG_3_ENABLE;
-    g_holdingRegisters[REG_ANALOG_4_ENABLE] = DEFAULT_ANALOG_4_ENABLE;
-    g_holdingRegisters[REG_ANALOG_COEFFICIENT] = DEFAULT_ANALOG_COEFFICIENT;
-    g_holdingRegisters[REG_ANALOG_CALIBRATION] = DEFAULT_ANALOG_CALIBRATION;
-    g_holdingRegisters[REG_DI1_ENABLE] = DEFAULT_DI1_ENABLE;
-    g_holdingRegisters[REG_DI2_ENABLE] = DEFAULT_DI2_ENABLE;
-    g_holdingRegisters[REG_DI3_ENABLE] = DEFAULT_DI3_ENABLE;
-    g_holdingRegisters[REG_DI4_ENABLE] = DEFAULT_DI4_ENABLE;
-    g_holdingRegisters[REG_RELAY1_CONTROL] = DEFAULT_RELAY1_CONTROL;
-    g_holdingRegisters[REG_RELAY2_CONTROL] = DEFAULT_RELAY2_CONTROL;
-    g_holdingRegisters[REG_RELAY3_CONTROL] = DEFAULT_RELAY3_CONTROL;
-    g_holdingRegisters[REG_RELAY4_CONTROL] = DEFAULT_RELAY4_CONTROL;
-    g_holdingRegisters[REG_SAFETY_ZONE1_THRESHOLD] = DEFAULT_SAFETY_ZONE1_THRESHOLD;
-    g_holdingRegisters[REG_SAFETY_ZONE2_THRESHOLD] = DEFAULT_SAFETY_ZONE2_THRESHOLD;
-    g_holdingRegisters[REG_SAFETY_ZONE3_THRESHOLD] = DEFAULT_SAFETY_ZONE3_THRESHOLD;
-    g_holdingRegisters[REG_SAFETY_ZONE4_THRESHOLD] = DEFAULT_SAFETY_ZONE4_THRESHOLD;
-    g_holdingRegisters[REG_PROXIMITY_THRESHOLD] = DEFAULT_PROXIMITY_THRESHOLD;
-    g_holdingRegisters[REG_SAFETY_RESPONSE_TIME] = DEFAULT_SAFETY_RESPONSE_TIME;
-    g_holdingRegisters[REG_AUTO_RESET_ENABLE] = DEFAULT_AUTO_RESET_ENABLE;
-    g_holdingRegisters[REG_SAFETY_MODE] = DEFAULT_SAFETY_MODE;
+    HOLDING_REG(REG_ANALOG_1_ENABLE) = DEFAULT_ANALOG_1_ENABLE;
+    HOLDING_REG(REG_ANALOG_2_ENABLE) = DEFAULT_ANALOG_2_ENABLE;
+    HOLDING_REG(REG_ANALOG_3_ENABLE) = DEFAULT_ANALOG_3_ENABLE;
+    HOLDING_REG(REG_ANALOG_4_ENABLE) = DEFAULT_ANALOG_4_ENABLE;
+    HOLDING_REG(REG_ANALOG_COEFFICIENT) = DEFAULT_ANALOG_COEFFICIENT;
+    HOLDING_REG(REG_ANALOG_CALIBRATION) = DEFAULT_ANALOG_CALIBRATION;
+    for (uint8_t i = 0; i < 4; i++) {
+        HOLDING_REG(REG_ANALOG_1_FILTER_TYPE + i) = DEFAULT_ANALOG_FILTER_TYPE;
+        HOLDING_REG(REG_ANALOG_1_FILTER_PARAM + i) = DEFAULT_ANALOG_FILTER_PARAM;
+        HOLDING_REG(REG_ANALOG_1_OFFSET + i) = DEFAULT_ANALOG_OFFSET;
+        HOLDING_REG(REG_ANALOG_1_GAIN + i) = DEFAULT_ANALOG_GAIN;
+        HOLDING_REG(REG_ANALOG_1_EXPONENT + i) = DEFAULT_ANALOG_EXPONENT;
+        HOLDING_REG(REG_ANALOG_1_MODEL + i) = DEFAULT_ANALOG_MODEL;
+        for (uint8_t k = 0; k < REG_ANALOG_CURVE_STRIDE; k++) {
+            HOLDING_REG(REG_ANALOG_CURVE(i) + k) = 0;
+        }
+    }
+    HOLDING_REG(REG_DI1_ENABLE) = DEFAULT_DI1_ENABLE;
+    HOLDING_REG(REG_DI2_ENABLE) = DEFAULT_DI2_ENABLE;
+    HOLDING_REG(REG_DI3_ENABLE) = DEFAULT_DI3_ENABLE;
+    HOLDING_REG(REG_DI4_ENABLE) = DEFAULT_DI4_ENABLE;
+    HOLDING_REG(REG_DI_DEBOUNCE_TIME) = DEFAULT_DI_DEBOUNCE_TIME;
+    HOLDING_REG(REG_RELAY1_CONTROL) = DEFAULT_RELAY1_CONTROL;
+    HOLDING_REG(REG_RELAY2_CONTROL) = DEFAULT_RELAY2_CONTROL;
+    HOLDING_REG(REG_RELAY3_CONTROL) = DEFAULT_RELAY3_CONTROL;
+    HOLDING_REG(REG_RELAY4_CONTROL) = DEFAULT_RELAY4_CONTROL;
+    HOLDING_REG(REG_SAFETY_ZONE1_THRESHOLD) = DEFAULT_SAFETY_ZONE1_THRESHOLD;
+    HOLDING_REG(REG_SAFETY_ZONE2_THRESHOLD) = DEFAULT_SAFETY_ZONE2_THRESHOLD;
+    HOLDING_REG(REG_SAFETY_ZONE3_THRESHOLD) = DEFAULT_SAFETY_ZONE3_THRESHOLD;
+    HOLDING_REG(REG_SAFETY_ZONE4_THRESHOLD) = DEFAULT_SAFETY_ZONE4_THRESHOLD;
+    HOLDING_REG(REG_PROXIMITY_THRESHOLD) = DEFAULT_PROXIMITY_THRESHOLD;
+    HOLDING_REG(REG_SAFETY_RESPONSE_TIME) = DEFAULT_SAFETY_RESPONSE_TIME;
+    HOLDING_REG(REG_AUTO_RESET_ENABLE) = DEFAULT_AUTO_RESET_ENABLE;
+    HOLDING_REG(REG_SAFETY_MODE) = DEFAULT_SAFETY_MODE;
+    HOLDING_REG(REG_SAFETY_LOOP_PERIOD) = DEFAULT_SAFETY_LOOP_PERIOD;
     
 
     // Initialize other arrays
@@ -74,189 +121,674 @@ void initializeModbusRegisters(void) {
         g_inputRegisters[i] = 0;
     }
     
-    for (int i = 0; i < COIL_COUNT; i++) {
-        g_coils[i] = 0;
+
+    // Lần Safety_Register_Load đầu tiên áp dụng toàn bộ cấu hình
+    g_registerDirtyMask = REG_GROUP_ALL;
+}
+
+// Thanh ghi lệnh: xử lý ngay trong modbusTask khi master ghi
+static void onResetErrorCommand(uint16_t addr, uint16_t value) {
+    (void)addr;
+    if (value == 1) {
+        HOLDING_REG(REG_SYSTEM_ERROR) = 0;
     }
-    
-    for (int i = 0; i < DISCRETE_COUNT; i++) {
-        g_discreteInputs[i] = 0;
+}
+
+static void onProfilerResetCommand(uint16_t addr, uint16_t value) {
+    if (value == 1) {
+        PROFILE_RESET();
+        HOLDING_REG(addr) = 0;
     }
 }
 
+// Giữ 1 đến khi Config_Store_Service xóa xong bank dự phòng
+static void onConfigEraseCommand(uint16_t addr, uint16_t value) {
+    (void)addr;
+    if (value == 1) {
+        Config_Store_Request_Erase();
+    }
+}
 
-uint16_t calcCRC(uint8_t *buf, int len) {
-    uint16_t crc = 0xFFFF;
-    for (int pos = 0; pos < len; pos++) {
-        crc ^= (uint16_t)buf[pos];
-        for (int i = 8; i != 0; i--) {
-            if ((crc & 0x0001) != 0) {
-                crc >>= 1;
-                crc ^= 0xA001;
-            } else {
-                crc >>= 1;
-            }
+/* Bảng mô tả holding register, sắp xếp theo địa chỉ, không chồng nhau. Địa chỉ không có trong
+ * bảng trả exception 2, giá trị ngoài [min, max] trả exception 3. Một dòng phải nằm trong một
+ * khối lưu trữ của HOLDING_REG_INDEX. */
+#define REG_ACCESS_READ     0x01U
+#define REG_ACCESS_WRITE    0x02U
+#define REG_ACCESS_SIGNED   0x04U   // Giá trị, min và max là int16
+#define REG_RO              REG_ACCESS_READ
+#define REG_RW              (REG_ACCESS_READ | REG_ACCESS_WRITE)
+
+typedef struct {
+    uint16_t first;
+    uint16_t last;
+    uint16_t index;         // HOLDING_REG_INDEX(first)
+    uint8_t access;
+    uint8_t group;          // REG_GROUP_x safety task áp dụng lại khi dòng này được ghi
+    uint16_t min;
+    uint16_t max;
+    void (*onWrite)(uint16_t addr, uint16_t value);
+} Register_Descriptor_t;
+
+#define REG_RANGE(first, last)  (first), (last), HOLDING_REG_INDEX(first)
+#define REG_SIGNED_LIMIT(x)     ((uint16_t)(int16_t)(x))
+
+static const Register_Descriptor_t s_registerMap[] = {
+    { REG_RANGE(REG_SAFETY_SYSTEM_STATUS,   REG_PROXIMITY_ALERT_STATUS), REG_RO, 0, 0, 0xFFFF, NULL },
+    { REG_RANGE(REG_RESET_FLAG,             REG_RESET_FLAG),             REG_RW, 0, 0, 1, NULL },
+    { REG_RANGE(REG_SAFETY_ERROR_CODE,      REG_SAFETY_ERROR_CODE),      REG_RO, 0, 0, 0xFFFF, NULL },
+    { REG_RANGE(REG_ANALOG_INPUT_1,         REG_ANALOG_INPUT_4),         REG_RO, 0, 0, 0xFFFF, NULL },
+    { REG_RANGE(REG_ANALOG_COEFFICIENT,     REG_ANALOG_CALIBRATION),     REG_RW, REG_GROUP_ANALOG_CONFIG, 0, 0xFFFF, NULL },
+    { REG_RANGE(REG_ANALOG_CALIBRATION + 1, REG_ANALOG_1_ENABLE - 1),    REG_RO, 0, 0, 0xFFFF, NULL },   // Mã ADC thô (dự phòng)
+    { REG_RANGE(REG_ANALOG_1_ENABLE,        REG_ANALOG_4_ENABLE),        REG_RW, REG_GROUP_ANALOG_CONFIG, 0, 1, NULL },
+    { REG_RANGE(REG_ANALOG_1_OFFSET,        REG_ANALOG_4_OFFSET),        REG_RW | REG_ACCESS_SIGNED, REG_GROUP_ANALOG_CONFIG,
+      REG_SIGNED_LIMIT(INT16_MIN), REG_SIGNED_LIMIT(INT16_MAX), NULL },
+    { REG_RANGE(REG_DI1_STATUS,             REG_DI4_STATUS),             REG_RO, 0, 0, 0xFFFF, NULL },
+    { REG_RANGE(REG_DI1_ENABLE,             REG_DI4_ACTIVE_LEVEL),       REG_RW, REG_GROUP_DIGITAL_CONFIG, 0, 1, NULL },
+    { REG_RANGE(REG_DI_DEBOUNCE_TIME,       REG_DI_DEBOUNCE_TIME),       REG_RW, REG_GROUP_DIGITAL_CONFIG, 0, LIMIT_DI_DEBOUNCE_MAX, NULL },
+    { REG_RANGE(REG_ANALOG_1_FILTER_TYPE,   REG_ANALOG_4_FILTER_TYPE),   REG_RW, REG_GROUP_ANALOG_CONFIG, 0, ANALOG_FILTER_MEDIAN, NULL },
+    { REG_RANGE(REG_ANALOG_1_FILTER_PARAM,  REG_ANALOG_4_FILTER_PARAM),  REG_RW, REG_GROUP_ANALOG_CONFIG, 0, ANALOG_FILTER_MAX_WINDOW, NULL },
+    // Relay và tham số an toàn: không nhóm nào, xem REG_GROUP_x
+    { REG_RANGE(REG_RELAY1_CONTROL,         REG_RELAY4_CONTROL),         REG_RW, 0, 0, 1, NULL },
+    { REG_RANGE(REG_SAFETY_ZONE1_THRESHOLD, REG_PROXIMITY_THRESHOLD),    REG_RW, 0, 0, LIMIT_SAFETY_THRESHOLD_MAX, NULL },
+    { REG_RANGE(REG_SAFETY_RESPONSE_TIME,   REG_SAFETY_RESPONSE_TIME),   REG_RW, 0, 1, LIMIT_SAFETY_RESPONSE_TIME_MAX, NULL },
+    { REG_RANGE(REG_AUTO_RESET_ENABLE,      REG_AUTO_RESET_ENABLE),      REG_RW, 0, 0, 1, NULL },
+    { REG_RANGE(REG_SAFETY_MODE,            REG_SAFETY_MODE),            REG_RW, 0, 1, 4, NULL },
+    { REG_RANGE(REG_SAFETY_LOOP_PERIOD,     REG_SAFETY_LOOP_PERIOD),     REG_RW, 0,
+      SAFETY_LOOP_PERIOD_MIN_MS, SAFETY_LOOP_PERIOD_MAX_MS, NULL },
+    // Gain/số mũ/đường cong được kiểm tra cả bộ khi nạp (Safety_Register_Load, bit SAFETY_ERROR_CALIBRATION)
+    { REG_RANGE(REG_ANALOG_1_GAIN,          REG_ANALOG_4_EXPONENT),      REG_RW, REG_GROUP_ANALOG_CONFIG, 0, 0xFFFF, NULL },
+    { REG_RANGE(REG_ANALOG_1_MODEL,         REG_ANALOG_4_MODEL),         REG_RW, REG_GROUP_ANALOG_CONFIG, 0, ANALOG_MODEL_CURVE, NULL },
+    { REG_RANGE(REG_ANALOG_CURVE_BASE,      REG_ANALOG_CURVE_LAST),      REG_RW, REG_GROUP_ANALOG_CONFIG, 0, 0xFFFF, NULL },
+    { REG_RANGE(REG_DEVICE_ID,              REG_DEVICE_ID),              REG_RW, REG_GROUP_SYSTEM_CONFIG, 1, 247, NULL },
+    { REG_RANGE(REG_CONFIG_BAUDRATE,        REG_CONFIG_BAUDRATE),        REG_RW, REG_GROUP_SYSTEM_CONFIG, 1, 5, NULL },
+    { REG_RANGE(REG_CONFIG_PARITY,          REG_CONFIG_PARITY),          REG_RW, REG_GROUP_SYSTEM_CONFIG, 0, 2, NULL },
+    { REG_RANGE(REG_CONFIG_STOP_BIT,        REG_CONFIG_STOP_BIT),        REG_RW, REG_GROUP_SYSTEM_CONFIG, 1, 2, NULL },
+    { REG_RANGE(REG_MODULE_TYPE,            REG_SYSTEM_ERROR),           REG_RO, 0, 0, 0xFFFF, NULL },
+    { REG_RANGE(REG_RESET_ERROR_COMMAND,    REG_RESET_ERROR_COMMAND),    REG_RW, REG_GROUP_SYSTEM_CONFIG, 0, 1, onResetErrorCommand },
+    { REG_RANGE(REG_PROFILER_RESET_COMMAND, REG_PROFILER_RESET_COMMAND), REG_RW, 0, 0, 1, onProfilerResetCommand },
+    { REG_RANGE(REG_CONFIG_ERASE_COMMAND,   REG_CONFIG_ERASE_COMMAND),   REG_RW, 0, 0, 1, onConfigEraseCommand },
+    { REG_RANGE(REG_SNAPSHOT_BASE,          REG_SNAPSHOT_LAST),          REG_RO, 0, 0, 0xFFFF, NULL },
+};
+
+#define REGISTER_MAP_COUNT  (sizeof(s_registerMap) / sizeof(s_registerMap[0]))
+
+// Dòng mô tả chứa addr (tìm nhị phân), NULL nếu địa chỉ không được định nghĩa
+static const Register_Descriptor_t *findRegister(uint16_t addr) {
+    uint8_t lo = 0;
+    uint8_t hi = REGISTER_MAP_COUNT;
+    while (lo < hi) {
+        uint8_t mid = (uint8_t)((lo + hi) / 2);
+        if (addr > s_registerMap[mid].last) {
+            lo = mid + 1;
+        } else if (addr < s_registerMap[mid].first) {
+            hi = mid;
+        } else {
+            return &s_registerMap[mid];
+        }
+    }
+    return NULL;
+}
+
+// Dòng kế tiếp nếu nó bắt đầu ngay sau reg (khối địa chỉ liền nhau), ngược lại NULL
+static const Register_Descriptor_t *nextRegister(const Register_Descriptor_t *reg) {
+    if (reg + 1 < &s_registerMap[REGISTER_MAP_COUNT] && reg[1].first == reg->last + 1) {
+        return reg + 1;
+    }
+    return NULL;
+}
+
+// Đánh dấu các nhóm cấu hình giao với [addr, addr + qty)
+void markRegistersDirty(uint16_t addr, uint16_t qty) {
+    uint32_t last = (uint32_t)addr + qty - 1;
+    uint32_t groups = 0;
+    for (uint8_t i = 0; i < REGISTER_MAP_COUNT; i++) {
+        if (addr <= s_registerMap[i].last && last >= s_registerMap[i].first) {
+            groups |= s_registerMap[i].group;
         }
     }
+    if (groups) {
+        __atomic_fetch_or(&g_registerDirtyMask, groups, __ATOMIC_RELEASE);
+    }
+    if (groups & REG_GROUP_ANALOG_CONFIG) {
+        __atomic_fetch_add(&s_analogWriteCount, 1, __ATOMIC_RELEASE);
+    }
+    Config_Store_Mark_Dirty(addr, qty);
+}
+
+uint32_t getAnalogWriteCount(void) {
+    return __atomic_load_n(&s_analogWriteCount, __ATOMIC_ACQUIRE);
+}
+
+// Lấy và xóa mặt nạ nhóm đã thay đổi (LDREX/STREX, không khóa)
+uint32_t takeDirtyRegisters(void) {
+    return __atomic_exchange_n(&g_registerDirtyMask, 0, __ATOMIC_ACQUIRE);
+}
+
+
+#if MODBUS_CRC_FULL_TABLE
+// Bảng CRC-16/MODBUS (đa thức đảo 0xA001), một lần tra cho mỗi byte
+static const uint16_t s_crcTable[256] = {
+    0x0000, 0xC0C1, 0xC181, 0x0140, 0xC301, 0x03C0, 0x0280, 0xC241,
+    0xC601, 0x06C0, 0x0780, 0xC741, 0x0500, 0xC5C1, 0xC481, 0x0440,
+    0xCC01, 0x0CC0, 0x0D80, 0xCD41, 0x0F00, 0xCFC1, 0xCE81, 0x0E40,
+    0x0A00, 0xCAC1, 0xCB81, 0x0B40, 0xC901, 0x09C0, 0x0880, 0xC841,
+    0xD801, 0x18C0, 0x1980, 0xD941, 0x1B00, 0xDBC1, 0xDA81, 0x1A40,
+    0x1E00, 0xDEC1, 0xDF81, 0x1F40, 0xDD01, 0x1DC0, 0x1C80, 0xDC41,
+    0x1400, 0xD4C1, 0xD581, 0x1540, 0xD701, 0x17C0, 0x1680, 0xD641,
+    0xD201, 0x12C0, 0x1380, 0xD341, 0x1100, 0xD1C1, 0xD081, 0x1040,
+    0xF001, 0x30C0, 0x3180, 0xF141, 0x3300, 0xF3C1, 0xF281, 0x3240,
+    0x3600, 0xF6C1, 0xF781, 0x3740, 0xF501, 0x35C0, 0x3480, 0xF441,
+    0x3C00, 0xFCC1, 0xFD81, 0x3D40, 0xFF01, 0x3FC0, 0x3E80, 0xFE41,
+    0xFA01, 0x3AC0, 0x3B80, 0xFB41, 0x3900, 0xF9C1, 0xF881, 0x3840,
+    0x2800, 0xE8C1, 0xE981, 0x2940, 0xEB01, 0x2BC0, 0x2A80, 0xEA41,
+    0xEE01, 0x2EC0, 0x2F80, 0xEF41, 0x2D00, 0xEDC1, 0xEC81, 0x2C40,
+    0xE401, 0x24C0, 0x2580, 0xE541, 0x2700, 0xE7C1, 0xE681, 0x2640,
+    0x2200, 0xE2C1, 0xE381, 0x2340, 0xE101, 0x21C0, 0x2080, 0xE041,
+    0xA001, 0x60C0, 0x6180, 0xA141, 0x6300, 0xA3C1, 0xA281, 0x6240,
+    0x6600, 0xA6C1, 0xA781, 0x6740, 0xA501, 0x65C0, 0x6480, 0xA441,
+    0x6C00, 0xACC1, 0xAD81, 0x6D40, 0xAF01, 0x6FC0, 0x6E80, 0xAE41,
+    0xAA01, 0x6AC0, 0x6B80, 0xAB41, 0x6900, 0xA9C1, 0xA881, 0x6840,
+    0x7800, 0xB8C1, 0xB981, 0x7940, 0xBB01, 0x7BC0, 0x7A80, 0xBA41,
+    0xBE01, 0x7EC0, 0x7F80, 0xBF41, 0x7D00, 0xBDC1, 0xBC81, 0x7C40,
+    0xB401, 0x74C0, 0x7580, 0xB541, 0x7700, 0xB7C1, 0xB681, 0x7640,
+    0x7200, 0xB2C1, 0xB381, 0x7340, 0xB101, 0x71C0, 0x7080, 0xB041,
+    0x5000, 0x90C1, 0x9181, 0x5140, 0x9301, 0x53C0, 0x5280, 0x9241,
+    0x9601, 0x56C0, 0x5780, 0x9741, 0x5500, 0x95C1, 0x9481, 0x5440,
+    0x9C01, 0x5CC0, 0x5D80, 0x9D41, 0x5F00, 0x9FC1, 0x9E81, 0x5E40,
+    0x5A00, 0x9AC1, 0x9B81, 0x5B40, 0x9901, 0x59C0, 0x5880, 0x9841,
+    0x8801, 0x48C0, 0x4980, 0x8941, 0x4B00, 0x8BC1, 0x8A81, 0x4A40,
+    0x4E00, 0x8EC1, 0x8F81, 0x4F40, 0x8D01, 0x4DC0, 0x4C80, 0x8C41,
+    0x4400, 0x84C1, 0x8581, 0x4540, 0x8701, 0x47C0, 0x4680, 0x8641,
+    0x8201, 0x42C0, 0x4380, 0x8341, 0x4100, 0x81C1, 0x8081, 0x4040
+};
+
+static inline uint16_t crcUpdateByte(uint16_t crc, uint8_t data) {
+    return (crc >> 8) ^ s_crcTable[(crc ^ data) & 0xFF];
+}
+#else
+// Bảng nibble: hai lần tra cho mỗi byte, tiết kiệm flash
+static const uint16_t s_crcNibbleTable[16] = {
+    0x0000, 0xCC01, 0xD801, 0x1400, 0xF001, 0x3C00, 0x2800, 0xE401,
+    0xA001, 0x6C00, 0x7800, 0xB401, 0x5000, 0x9C01, 0x8801, 0x4400
+};
+
+static inline uint16_t crcUpdateByte(uint16_t crc, uint8_t data) {
+    crc = (crc >> 4) ^ s_crcNibbleTable[(crc ^ data) & 0x0F];
+    crc = (crc >> 4) ^ s_crcNibbleTable[(crc ^ (data >> 4)) & 0x0F];
+    return crc;
+}
+#endif
+
+// Cập nhật CRC tăng dần, bắt đầu từ MODBUS_CRC_INIT
+uint16_t updateCRC(uint16_t crc, const uint8_t *buf, int len) {
+    for (int pos = 0; pos < len; pos++) {
+        crc = crcUpdateByte(crc, buf[pos]);
+    }
     return crc;
 }
 
-void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart) {
+uint16_t calcCRC(uint8_t *buf, int len) {
+    return updateCRC(MODBUS_CRC_INIT, buf, len);
+}
+
+void startUARTReception(void) {
+    // Khung đang nhận dở bị bỏ; các khung đã vào hàng đợi vẫn được xử lý
+    s_rxDmaPos = 0;
+    s_rxDiscard = 0;
+    s_rxIndex = 0;
+    if (HAL_UARTEx_ReceiveToIdle_DMA(&huart2, s_rxDmaBuffer, RX_DMA_BUFFER_SIZE) == HAL_OK) {
+        // Chỉ cần ngắt IDLE và TC (quay vòng), không cần ngắt nửa bộ đệm
+        __HAL_DMA_DISABLE_IT(huart2.hdmarx, DMA_IT_HT);
+    }
+}
+
+// Đưa khung đã nhận đủ vào hàng đợi cho modbusTask (gọi trong ngắt)
+static void completeRxFrame(void) {
+    if (!s_rxDiscard && s_rxIndex > 0) {
+        Modbus_Rx_Frame_t *frame = RX_QUEUE_SLOT(s_rxHead);
+        frame->length = s_rxIndex;
+        frame->crc = s_rxCRC;
+        uint8_t head = s_rxHead + 1;
+        __atomic_store_n(&s_rxHead, head, __ATOMIC_RELEASE);
+        uint8_t used = head - __atomic_load_n(&s_rxTail, __ATOMIC_ACQUIRE);
+        if (used > g_rxQueuePeak) {
+            g_rxQueuePeak = used;
+        }
+        osThreadFlagsSet(modbusTaskHandle, MODBUS_FLAG_FRAME_READY);
+    } else if (s_rxDiscard) {
+        g_rxDroppedFrames++;
+    }
+    s_rxDiscard = 0;
+    s_rxIndex = 0;
+}
+
+void HAL_UARTEx_RxEventCallback(UART_HandleTypeDef *huart, uint16_t Size) {
     if (huart->Instance == USART2) {
         g_lastUARTActivity = HAL_GetTick();
-        
-        if (rxIndex < RX_BUFFER_SIZE - 1) {
-            rxBuffer[rxIndex++] = huart->Instance->DR;
-            frameReceived = 1;
-            
-            if (rxIndex >= 6) {
-                uint8_t expectedLength = 0;
-                if (rxBuffer[1] == 3 || rxBuffer[1] == 6) {
-                    expectedLength = 8;
-                } else if (rxBuffer[1] == 4) {
-                    expectedLength = 8;
-                } else if (rxBuffer[1] == 16) {
-                    if (rxIndex >= 7) {
-                        expectedLength = 9 + rxBuffer[6];
-                    }
-                }
-                
-                if (rxIndex >= expectedLength) {
-                    processModbusFrame();
+
+        // Chép các byte mới từ vòng DMA thẳng vào ô hàng đợi đang nhận
+        while (s_rxDmaPos != Size) {
+            uint8_t data = s_rxDmaBuffer[s_rxDmaPos++];
+            g_totalReceived++;
+            if (s_rxDiscard) {
+                continue;
+            }
+            if (s_rxIndex == 0) {
+                // Byte đầu khung: cần một ô trống, task trả ô bằng s_rxTail
+                if ((uint8_t)(s_rxHead - __atomic_load_n(&s_rxTail, __ATOMIC_ACQUIRE)) >= MODBUS_RX_QUEUE_DEPTH) {
+                    g_rxQueueOverflows++;
+                    s_rxDiscard = 1;
+                    continue;
                 }
+                s_rxCRC = MODBUS_CRC_INIT;
+            } else if (s_rxIndex >= RX_BUFFER_SIZE) {
+                s_rxDiscard = 1;
+                continue;
             }
-        } else {
-            rxIndex = 0;
-            frameReceived = 0;
+            s_rxCRC = crcUpdateByte(s_rxCRC, data);
+            RX_QUEUE_SLOT(s_rxHead)->data[s_rxIndex++] = data;
+        }
+        if (s_rxDmaPos >= RX_DMA_BUFFER_SIZE) {
+            s_rxDmaPos = 0;
+        }
+
+        // IDLE line: master đã ngừng gửi -> hết khung
+        if (HAL_UARTEx_GetRxEventType(huart) == HAL_UART_RXEVENT_IDLE) {
+            completeRxFrame();
+        }
+    }
+}
+
+/**
+ * @brief Gọi đầu USART2_IRQHandler, trước HAL_UART_IRQHandler
+ * @note HAL không báo sự kiện IDLE khi khung kết thúc đúng điểm quay vòng
+ *       của DMA (bộ đếm DMA đã nạp lại đầy), nên xử lý trường hợp đó ở đây.
+ */
+void checkUARTIdleAtWrap(void) {
+    if (__HAL_UART_GET_FLAG(&huart2, UART_FLAG_IDLE) &&
+        huart2.ReceptionType == HAL_UART_RECEPTION_TOIDLE &&
+        __HAL_DMA_GET_COUNTER(huart2.hdmarx) == RX_DMA_BUFFER_SIZE &&
+        s_rxDmaPos == 0) {
+        completeRxFrame();
+    }
+}
+
+uint8_t isModbusTxBusy(void) {
+    return s_txBusy;
+}
+
+// Bắt đầu phát s_txBuffer bằng DMA, không chờ
+static void startModbusTransmit(uint16_t length) {
+    s_txBusy = 1;
+    RS485_DRIVER_ENABLE();
+    if (HAL_UART_Transmit_DMA(&huart2, s_txBuffer, length) != HAL_OK) {
+        RS485_DRIVER_DISABLE();
+        s_txBusy = 0;
+        g_txDroppedFrames++;
+    }
+}
+
+// Gọi sau cờ TC (bit stop cuối đã ra khỏi thanh ghi dịch) nên có thể nhả DE ngay
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart) {
+    if (huart->Instance == USART2) {
+        RS485_DRIVER_DISABLE();
+        g_txFrames++;
+        s_txBusy = 0;
+        // Khung đến trong lúc đang phát còn chờ phản hồi
+        if (s_rxHead != s_rxTail) {
+            osThreadFlagsSet(modbusTaskHandle, MODBUS_FLAG_TX_DONE);
         }
-        HAL_UART_Receive_IT(&huart2, &rxBuffer[rxIndex], 1);
     }
 }
 
 void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart) {
     if (huart->Instance == USART2) {
-        rxIndex = 0;
-        frameReceived = 0;
-        HAL_UART_Abort(&huart2);
-        HAL_UART_Receive_IT(&huart2, &rxBuffer[rxIndex], 1);
+        // Lỗi nhận (ORE/FE/NE): chỉ khởi động lại phía nhận, không cắt khung đang phát
+        HAL_UART_AbortReceive(&huart2);
+        // Khung dở bị bỏ khi khởi động lại: byte đã chép vào ô, còn trong vòng DMA, hoặc đang bị bỏ
+        // (tràn hàng đợi / quá dài - completeRxFrame sẽ không còn thấy để đếm)
+        uint16_t dmaPos = (uint16_t)(RX_DMA_BUFFER_SIZE - __HAL_DMA_GET_COUNTER(huart2.hdmarx));
+        if (s_rxIndex > 0 || s_rxDiscard || dmaPos != s_rxDmaPos) {
+            g_rxDroppedFrames++;
+        }
+        startUARTReception();
+    }
+}
+
+/**
+ * @brief Software timer chu kỳ MODBUS_WATCHDOG_PERIOD_MS (chạy trong timer task)
+ * @note Chỉ báo cho modbusTask; việc reset UART do modbusTask thực hiện để không
+ *       chen ngang lúc đang xử lý khung.
+ */
+void modbusWatchdogCallback(void *argument) {
+    HAL_GPIO_TogglePin(LED2_GPIO_Port, LED2_Pin);
+    if (HAL_GetTick() - g_lastUARTActivity > MODBUS_UART_TIMEOUT_MS) {
+        osThreadFlagsSet(modbusTaskHandle, MODBUS_FLAG_UART_TIMEOUT);
     }
 }
 
 void resetUARTCommunication(void) {
     HAL_UART_Abort(&huart2);
-    rxIndex = 0;
-    frameReceived = 0;
-    HAL_UART_Receive_IT(&huart2, &rxBuffer[0], 1);
+    RS485_DRIVER_DISABLE();
+    s_txBusy = 0;
+    startUARTReception();
+}
+
+uint8_t isModbusFramePending(void) {
+    return __atomic_load_n(&s_rxHead, __ATOMIC_ACQUIRE) != s_rxTail;
 }
 
-void processModbusFrame(void) {
-    if (rxIndex < 6) return;
-    if (rxBuffer[0] != MODBUS_SLAVE_ADDRESS) return;
+// Trả ô đầu hàng đợi lại cho ISR
+static void releaseRxFrame(void) {
+    __atomic_store_n(&s_rxTail, (uint8_t)(s_rxTail + 1), __ATOMIC_RELEASE);
+}
 
-    uint16_t crc = calcCRC(rxBuffer, rxIndex - 2);
-    if (rxBuffer[rxIndex - 2] != (crc & 0xFF) || rxBuffer[rxIndex - 1] != (crc >> 8)) {
-        return;
+// Chép thống kê hàng đợi nhận ra input register (chỉ khi master đọc tới)
+static void exportRxQueueStats(void) {
+    g_inputRegisters[INPUT_REG_RX_DROPPED] = (uint16_t)(g_rxDroppedFrames >> 16);
+    g_inputRegisters[INPUT_REG_RX_DROPPED + 1] = (uint16_t)g_rxDroppedFrames;
+    g_inputRegisters[INPUT_REG_RX_OVERFLOW] = (uint16_t)(g_rxQueueOverflows >> 16);
+    g_inputRegisters[INPUT_REG_RX_OVERFLOW + 1] = (uint16_t)g_rxQueueOverflows;
+    g_inputRegisters[INPUT_REG_RX_QUEUE_PEAK] = g_rxQueuePeak;
+}
+
+// Phản hồi lỗi: bật bit 0x80 của mã hàm, trả về độ dài khung (chưa gồm CRC)
+static uint16_t modbusException(uint8_t *txBuffer, uint8_t code) {
+    txBuffer[1] |= 0x80;
+    txBuffer[2] = code;
+    return 3;
+}
+
+// Phản hồi FC5/6/15/16: lặp lại địa chỉ và giá trị/số lượng của yêu cầu
+static uint16_t echoRequest(uint8_t *txBuffer, const uint8_t *rxBuffer) {
+    txBuffer[2] = rxBuffer[2];
+    txBuffer[3] = rxBuffer[3];
+    txBuffer[4] = rxBuffer[4];
+    txBuffer[5] = rxBuffer[5];
+    return 6;
+}
+
+// Chép qty thanh ghi (big-endian) vào phản hồi sau byte count
+static uint16_t readRegisters(uint8_t *txBuffer, const uint16_t *regs, uint16_t qty) {
+    uint16_t txIndex = 3;
+    txBuffer[2] = qty * 2;
+    for (uint16_t i = 0; i < qty; i++) {
+        txBuffer[txIndex++] = regs[i] >> 8;
+        txBuffer[txIndex++] = regs[i] & 0xFF;
+    }
+    return txIndex;
+}
+
+// Mọi địa chỉ trong [addr, addr + qty) đều được định nghĩa
+static uint8_t isReadableRange(uint16_t addr, uint16_t qty) {
+    const Register_Descriptor_t *reg = findRegister(addr);
+    uint32_t last = (uint32_t)addr + qty - 1;
+    while (reg != NULL && reg->last < last) {
+        reg = nextRegister(reg);
+    }
+    return reg != NULL && qty >= 1;
+}
+
+static uint16_t readHoldingRegisters(uint8_t *txBuffer, uint16_t addr, uint16_t qty) {
+    // Khoảng cách analog chỉ được tính khi master đọc tới
+    if (addr <= REG_ANALOG_INPUT_4 && addr + qty > REG_ANALOG_INPUT_1) {
+        Safety_Refresh_Analog_Registers();
+    }
+    if (addr <= REG_SNAPSHOT_LAST && addr + qty > REG_SNAPSHOT_BASE) {
+        Safety_Refresh_Snapshot_Registers();
+    }
+
+    // Chép theo từng dòng mô tả: các dòng liền địa chỉ có thể nằm ở các khối lưu trữ khác nhau
+    const Register_Descriptor_t *reg = findRegister(addr);
+    uint16_t txIndex = 3;
+    txBuffer[2] = qty * 2;
+    for (uint16_t i = 0; i < qty; i++, addr++) {
+        if (addr > reg->last) {
+            reg = reg + 1;
+        }
+        uint16_t value = g_holdingRegisters[reg->index + (addr - reg->first)];
+        txBuffer[txIndex++] = value >> 8;
+        txBuffer[txIndex++] = value & 0xFF;
+    }
+    return txIndex;
+}
+
+// FC1/FC2: mỗi thanh ghi khác 0 là một bit 1, bit thấp của byte đầu là phần tử đầu tiên
+static uint16_t readBits(uint8_t *txBuffer, uint16_t reg, uint16_t qty) {
+    uint8_t byteCount = (qty + 7) / 8;
+    txBuffer[2] = byteCount;
+    for (uint8_t i = 0; i < byteCount; i++) {
+        txBuffer[3 + i] = 0;
+    }
+    for (uint16_t i = 0; i < qty; i++) {
+        if (HOLDING_REG(reg + i)) {
+            txBuffer[3 + i / 8] |= (uint8_t)(1U << (i % 8));
+        }
+    }
+    return 3 + byteCount;
+}
+
+/**
+ * @brief Kiểm tra lệnh ghi qty thanh ghi (big-endian trong data) trước khi ghi bất kỳ thanh ghi nào
+ * @return 0 nếu hợp lệ, 0x02 nếu có địa chỉ không định nghĩa/chỉ đọc, 0x03 nếu có giá trị ngoài [min, max]
+ */
+static uint8_t checkHoldingWrite(uint16_t addr, uint16_t qty, const uint8_t *data) {
+    const Register_Descriptor_t *reg = findRegister(addr);
+    uint8_t result = 0;
+    for (uint16_t i = 0; i < qty; i++, addr++) {
+        if (reg != NULL && addr > reg->last) {
+            reg = nextRegister(reg);
+        }
+        if (reg == NULL || !(reg->access & REG_ACCESS_WRITE)) {
+            return 0x02;
+        }
+        uint16_t value = (uint16_t)((data[2 * i] << 8) | data[2 * i + 1]);
+        uint8_t inRange = (reg->access & REG_ACCESS_SIGNED) ?
+            ((int16_t)value >= (int16_t)reg->min && (int16_t)value <= (int16_t)reg->max) :
+            (value >= reg->min && value <= reg->max);
+        if (!inRange) {
+            result = 0x03;
+        }
+    }
+    return result;
+}
+
+// Ghi một holding register đã kiểm tra và gọi hook của dòng mô tả - dùng chung cho mọi mã hàm ghi
+static void writeHoldingRegister(uint16_t addr, uint16_t value) {
+    const Register_Descriptor_t *reg = findRegister(addr);
+    g_holdingRegisters[reg->index + (addr - reg->first)] = value;
+    if (reg->onWrite != NULL) {
+        reg->onWrite(addr, value);
+    }
+}
+
+/**
+ * @brief Kiểm tra rồi ghi qty thanh ghi - dùng cho FC6/FC16/FC23
+ * @return 0 nếu đã ghi, ngược lại mã exception (không thanh ghi nào bị ghi)
+ * @note Lệnh ghi trùng khối tham số an toàn đi qua bản nháp của safety task: bộ không nhất quán
+ *       bị từ chối (exception 3), bộ hợp lệ được công bố nguyên vẹn trước khi ghi thanh ghi
+ */
+static uint8_t commitHoldingWrite(uint16_t addr, uint16_t qty, const uint8_t *data) {
+    uint8_t error = checkHoldingWrite(addr, qty, data);
+    if (error == 0 && Safety_Params_Stage(addr, qty, data) != HAL_OK) {
+        error = 0x03;
+    }
+    if (error != 0) {
+        return error;
+    }
+    for (uint16_t i = 0; i < qty; i++) {
+        writeHoldingRegister(addr + i, (uint16_t)((data[2 * i] << 8) | data[2 * i + 1]));
+    }
+    markRegistersDirty(addr, qty);
+    return 0;
+}
+
+/**
+ * @brief Xử lý khung đầu hàng đợi nhận
+ * @return 1 nếu đã xử lý và trả ô cho ISR, 0 nếu hàng đợi rỗng hoặc phản hồi trước còn đang phát
+ *         (khung được giữ lại, HAL_UART_TxCpltCallback báo MODBUS_FLAG_TX_DONE khi phát xong)
+ */
+uint8_t processModbusFrame(void) {
+    if (!isModbusFramePending()) {
+        return 0;
+    }
+    const Modbus_Rx_Frame_t *frame = RX_QUEUE_SLOT(s_rxTail);
+    const uint8_t *rxBuffer = frame->data;
+
+    if (frame->length < 6 || rxBuffer[0] != MODBUS_SLAVE_ADDRESS) {
+        releaseRxFrame();
+        return 1;
+    }
+
+    // CRC đã được tính trong ISR khi nhận; CRC qua cả 2 byte CRC cuối bằng 0 nếu khớp
+    uint16_t crc;
+    if (frame->crc != 0) {
+        g_corruptionCount++;
+        releaseRxFrame();
+        return 1;
+    }
+
+    // Master gửi dồn khung khi phản hồi trước chưa phát xong - giữ khung trong hàng đợi
+    if (s_txBusy) {
+        return 0;
     }
 
     uint8_t funcCode = rxBuffer[1];
-    uint8_t txBuffer[256];
-    uint8_t txIndex = 0;
+    uint8_t *txBuffer = s_txBuffer;
+    uint16_t txIndex = 0;
     txBuffer[0] = MODBUS_SLAVE_ADDRESS;
     txBuffer[1] = funcCode;
 
-    if (funcCode == 3) {
+    if (funcCode >= 1 && funcCode <= 6 && frame->length != MODBUS_FIXED_FRAME_LENGTH) {
+        // Khung 6-7 byte qua được CRC nhưng trường thứ hai sẽ đọc vào chính byte CRC
+        txIndex = modbusException(txBuffer, 0x03);
+    } else if (funcCode == 1 || funcCode == 2) {
+        // Coil n = REG_RELAYn_CONTROL, discrete input n = REG_DIn_STATUS
         uint16_t addr = (rxBuffer[2] << 8) | rxBuffer[3];
         uint16_t qty = (rxBuffer[4] << 8) | rxBuffer[5];
-        if (addr + qty <= HOLDING_REG_COUNT) {
-            txBuffer[2] = qty * 2;
-            txIndex = 3;
-            for (int i = 0; i < qty; i++) {
-                txBuffer[txIndex++] = g_holdingRegisters[addr + i] >> 8;
-                txBuffer[txIndex++] = g_holdingRegisters[addr + i] & 0xFF;
-            }
+        uint16_t count = (funcCode == 1) ? COIL_COUNT : DISCRETE_COUNT;
+        uint16_t base = (funcCode == 1) ? REG_RELAY1_CONTROL : REG_DI1_STATUS;
+        if (qty < 1 || qty > MODBUS_MAX_READ_BITS) {
+            txIndex = modbusException(txBuffer, 0x03);
+        } else if (addr + qty <= count) {
+            txIndex = readBits(txBuffer, base + addr, qty);
         } else {
-            txBuffer[1] |= 0x80;
-            txBuffer[2] = 0x02;
-            txIndex = 3;
+            txIndex = modbusException(txBuffer, 0x02);
+        }
+    } else if (funcCode == 3) {
+        uint16_t addr = (rxBuffer[2] << 8) | rxBuffer[3];
+        uint16_t qty = (rxBuffer[4] << 8) | rxBuffer[5];
+        if (qty < 1 || qty > MODBUS_MAX_READ_REGS) {
+            txIndex = modbusException(txBuffer, 0x03);
+        } else if (isReadableRange(addr, qty)) {
+            txIndex = readHoldingRegisters(txBuffer, addr, qty);
+        } else {
+            txIndex = modbusException(txBuffer, 0x02);
         }
     } else if (funcCode == 4) {
         uint16_t addr = (rxBuffer[2] << 8) | rxBuffer[3];
         uint16_t qty = (rxBuffer[4] << 8) | rxBuffer[5];
-        if (addr + qty <= INPUT_REG_COUNT) {
-            txBuffer[2] = qty * 2;
-            txIndex = 3;
-            for (int i = 0; i < qty; i++) {
-                txBuffer[txIndex++] = g_inputRegisters[addr + i] >> 8;
-                txBuffer[txIndex++] = g_inputRegisters[addr + i] & 0xFF;
+        if (qty < 1 || qty > MODBUS_MAX_READ_REGS) {
+            txIndex = modbusException(txBuffer, 0x03);
+        } else if (addr + qty <= INPUT_REG_COUNT) {
+            // Thống kê profiler chỉ được chép ra khi master đọc tới khối đó
+            if (addr < INPUT_REG_PROFILER_BASE + INPUT_REG_PROFILER_COUNT &&
+                addr + qty > INPUT_REG_PROFILER_BASE) {
+                PROFILE_EXPORT(&g_inputRegisters[INPUT_REG_PROFILER_BASE]);
+            }
+            if (addr + qty > INPUT_REG_RX_DROPPED) {
+                exportRxQueueStats();
             }
+            txIndex = readRegisters(txBuffer, &g_inputRegisters[addr], qty);
         } else {
-            txBuffer[1] |= 0x80;
-            txBuffer[2] = 0x02;
-            txIndex = 3;
+            txIndex = modbusException(txBuffer, 0x02);
         }
-    } else if (funcCode == 6) {
+    } else if (funcCode == 5) {
         uint16_t addr = (rxBuffer[2] << 8) | rxBuffer[3];
         uint16_t value = (rxBuffer[4] << 8) | rxBuffer[5];
-        if (addr < HOLDING_REG_COUNT) {
-            g_holdingRegisters[addr] = value;
-            
-            // Handle special register writes
-            if (addr == REG_RESET_ERROR_COMMAND && value == 1) {
-                g_holdingRegisters[REG_SYSTEM_ERROR] = 0;
+        if (addr >= COIL_COUNT) {
+            txIndex = modbusException(txBuffer, 0x02);
+        } else if (value != 0xFF00 && value != 0x0000) {
+            txIndex = modbusException(txBuffer, 0x03);
+        } else {
+            writeHoldingRegister(REG_RELAY1_CONTROL + addr, value ? 1 : 0);
+            markRegistersDirty(REG_RELAY1_CONTROL + addr, 1);
+            txIndex = echoRequest(txBuffer, rxBuffer);
+        }
+    } else if (funcCode == 6) {
+        uint16_t addr = (rxBuffer[2] << 8) | rxBuffer[3];
+        uint8_t error = commitHoldingWrite(addr, 1, &rxBuffer[4]);
+        if (error == 0) {
+            txIndex = echoRequest(txBuffer, rxBuffer);
+        } else {
+            txIndex = modbusException(txBuffer, error);
+        }
+    } else if (funcCode == 15) {
+        uint16_t addr = (rxBuffer[2] << 8) | rxBuffer[3];
+        uint16_t qty = (rxBuffer[4] << 8) | rxBuffer[5];
+        uint8_t byteCount = rxBuffer[6];
+        if (qty < 1 || qty > MODBUS_MAX_WRITE_BITS || byteCount != (qty + 7) / 8 ||
+            frame->length < 9 + byteCount) {
+            txIndex = modbusException(txBuffer, 0x03);
+        } else if (addr + qty <= COIL_COUNT) {
+            for (uint16_t i = 0; i < qty; i++) {
+                writeHoldingRegister(REG_RELAY1_CONTROL + addr + i, (rxBuffer[7 + i / 8] >> (i % 8)) & 1);
             }
-            
-            txBuffer[2] = rxBuffer[2];
-            txBuffer[3] = rxBuffer[3];
-            txBuffer[4] = rxBuffer[4];
-            txBuffer[5] = rxBuffer[5];
-            txIndex = 6;
+            markRegistersDirty(REG_RELAY1_CONTROL + addr, qty);
+            txIndex = echoRequest(txBuffer, rxBuffer);
         } else {
-            txBuffer[1] |= 0x80;
-            txBuffer[2] = 0x02;
-            txIndex = 3;
+            txIndex = modbusException(txBuffer, 0x02);
         }
     } else if (funcCode == 16) {
         uint16_t addr = (rxBuffer[2] << 8) | rxBuffer[3];
         uint16_t qty = (rxBuffer[4] << 8) | rxBuffer[5];
         uint8_t byteCount = rxBuffer[6];
-        if (addr + qty <= HOLDING_REG_COUNT && byteCount == qty * 2) {
-            for (int i = 0; i < qty; i++) {
-                g_holdingRegisters[addr + i] = (rxBuffer[7 + i*2] << 8) | rxBuffer[8 + i*2];
-            }
-            txBuffer[2] = rxBuffer[2];
-            txBuffer[3] = rxBuffer[3];
-            txBuffer[4] = rxBuffer[4];
-            txBuffer[5] = rxBuffer[5];
-            txIndex = 6;
+        uint8_t error = 0x03;
+        if (qty >= 1 && qty <= MODBUS_MAX_WRITE_REGS && byteCount == qty * 2 && frame->length >= 9 + byteCount) {
+            error = commitHoldingWrite(addr, qty, &rxBuffer[7]);
+        }
+        if (error == 0) {
+            txIndex = echoRequest(txBuffer, rxBuffer);
+        } else {
+            txIndex = modbusException(txBuffer, error);
+        }
+    } else if (funcCode == 23) {
+        // Ghi trước rồi đọc (theo chuẩn) - một giao dịch thay cho FC16 + FC3
+        uint16_t readAddr = (rxBuffer[2] << 8) | rxBuffer[3];
+        uint16_t readQty = (rxBuffer[4] << 8) | rxBuffer[5];
+        uint16_t writeAddr = (rxBuffer[6] << 8) | rxBuffer[7];
+        uint16_t writeQty = (rxBuffer[8] << 8) | rxBuffer[9];
+        uint8_t byteCount = rxBuffer[10];
+        uint8_t error = 0x03;
+        if (readQty >= 1 && readQty <= MODBUS_MAX_READ_REGS &&
+            writeQty >= 1 && writeQty <= MODBUS_MAX_RW_WRITE_REGS &&
+            byteCount == writeQty * 2 && frame->length >= 13 + byteCount) {
+            error = isReadableRange(readAddr, readQty) ? commitHoldingWrite(writeAddr, writeQty, &rxBuffer[11]) : 0x02;
+        }
+        if (error == 0) {
+            txIndex = readHoldingRegisters(txBuffer, readAddr, readQty);
         } else {
-            txBuffer[1] |= 0x80;
-            txBuffer[2] = 0x02;
-            txIndex = 3;
+            txIndex = modbusException(txBuffer, error);
         }
     } else {
-        txBuffer[1] |= 0x80;
-        txBuffer[2] = 0x01;
-        txIndex = 3;
+        txIndex = modbusException(txBuffer, 0x01);
     }
 
     crc = calcCRC(txBuffer, txIndex);
     txBuffer[txIndex++] = crc & 0xFF;
     txBuffer[txIndex++] = crc >> 8;
     
-    if (HAL_UART_Transmit(&huart2, txBuffer, txIndex, 100) != HAL_OK) {
-        HAL_UART_Abort(&huart2);
-
-    } else {
-    }
-    
-    rxIndex = 0;
-    frameReceived = 0;
+    releaseRxFrame();
+    startModbusTransmit(txIndex);
+    return 1;
 }
 
 void updateBaudrate(void) {
-    if(current_baudrate == g_holdingRegisters[REG_CONFIG_BAUDRATE])
+    // Chờ phản hồi (thường là phản hồi của chính lệnh ghi baudrate) phát xong
+    if(current_baudrate == HOLDING_REG(REG_CONFIG_BAUDRATE) || s_txBusy)
         return;
     else {
-        switch(g_holdingRegisters[REG_CONFIG_BAUDRATE]) {
+        switch(HOLDING_REG(REG_CONFIG_BAUDRATE)) {
             case 1:
                 current_baudrate = 1;
                 huart2.Init.BaudRate = 9600;
@@ -292,7 +824,11 @@ void updateBaudrate(void) {
                 huart2.Init.BaudRate = 115200;
                 HAL_UART_DeInit(&huart2);
                 HAL_UART_Init(&huart2);
+                // Giá trị không hợp lệ: trả thanh ghi về baudrate đang dùng
+                HOLDING_REG(REG_CONFIG_BAUDRATE) = current_baudrate;
                 break;
         }
+        // DeInit đã dừng DMA nhận, khởi động lại
+        startUARTReception();
     }
 }
@@ -25,7 +25,9 @@
 
 /* Private includes ----------------------------------------------------------*/
 /* USER CODE BEGIN Includes */
-
+#include "Profiler.h"
+#include "Config_Store.h"
+#include "Boot_Timing.h"
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -68,7 +70,20 @@ const osThreadAttr_t modbusTask_attributes = {
   .priority = (osPriority_t) osPriorityHigh,
 };
 /* USER CODE BEGIN PV */
-
+/* USART2 DMA (không có trong .ioc): RX vòng tròn DMA1_Channel6, TX DMA1_Channel7 */
+DMA_HandleTypeDef hdma_usart2_rx;
+DMA_HandleTypeDef hdma_usart2_tx;
+
+/* Definitions for modbusWatchdog */
+osTimerId_t modbusWatchdogHandle;
+const osTimerAttr_t modbusWatchdog_attributes = {
+  .name = "modbusWatchdog"
+};
+/* Definitions for configStore */
+osTimerId_t configStoreHandle;
+const osTimerAttr_t configStore_attributes = {
+  .name = "configStore"
+};
 /* USER CODE END PV */
 
 /* Private function prototypes -----------------------------------------------*/
@@ -107,14 +122,24 @@ int main(void)
   HAL_Init();
 
   /* USER CODE BEGIN Init */
-
+  // Relay về trạng thái an toàn trước mọi khởi tạo khác (kể cả chờ HSE/PLL)
+  Boot_Timing_Start();
+  Safety_Boot_Safe_Outputs();
+  Boot_Timing_Mark(BOOT_PHASE_SAFE_OUTPUTS);
   /* USER CODE END Init */
 
   /* Configure the system clock */
   SystemClock_Config();
 
   /* USER CODE BEGIN SysInit */
+  Boot_Timing_Mark(BOOT_PHASE_CLOCK);
 
+  // Cấu hình lần cuối từ flash có trước khi safety monitor khởi tạo
+  initializeModbusRegisters();
+  if (Config_Store_Restore() == HAL_OK) {
+    Boot_Timing_Set_Status(BOOT_STATUS_CONFIG_RESTORED);
+  }
+  Boot_Timing_Mark(BOOT_PHASE_CONFIG);
   /* USER CODE END SysInit */
 
   /* Initialize all configured peripherals */
@@ -124,8 +149,11 @@ int main(void)
   MX_USART2_UART_Init();
   MX_ADC1_Init();
   /* USER CODE BEGIN 2 */
-  initializeModbusRegisters();
+  PROFILE_INIT();
   Safety_Monitor_Init();
+  Output_Control_Init();
+  Boot_Timing_Mark(BOOT_PHASE_PERIPHERALS);
+  // UART bắt đầu nhận trong modbusTask, sau vòng safety đầu tiên
   /* USER CODE END 2 */
 
   /* Init scheduler */
@@ -141,6 +169,10 @@ int main(void)
 
   /* USER CODE BEGIN RTOS_TIMERS */
   /* start timers, add new ones, ... */
+  modbusWatchdogHandle = osTimerNew(modbusWatchdogCallback, osTimerPeriodic, NULL, &modbusWatchdog_attributes);
+  osTimerStart(modbusWatchdogHandle, MODBUS_WATCHDOG_PERIOD_MS);
+  configStoreHandle = osTimerNew(Config_Store_Service, osTimerPeriodic, NULL, &configStore_attributes);
+  osTimerStart(configStoreHandle, CONFIG_STORE_SERVICE_MS);
   /* USER CODE END RTOS_TIMERS */
 
   /* USER CODE BEGIN RTOS_QUEUES */
@@ -276,7 +308,23 @@ static void MX_ADC1_Init(void)
   sConfig.Rank = ADC_REGULAR_RANK_4;
   HAL_ADC_ConfigChannel(&hadc1, &sConfig);
  /* USER CODE BEGIN ADC1_Init 2 */
+  /* Ghi đè cấu hình CubeMX: mỗi sườn TIM2 CC2 quét một lượt 4 kênh thay vì chạy liên tục */
+  hadc1.Init.ContinuousConvMode = DISABLE;
+  hadc1.Init.ExternalTrigConv = ADC_EXTERNALTRIGCONV_T2_CC2;
+  if (HAL_ADC_Init(&hadc1) != HAL_OK)
+  {
+    Error_Handler();
+  }
 
+  /* 71.5 + 12.5 cycles @ 8 MHz = 10.5 us/channel, 42 us per 4-channel scan */
+  static const uint32_t adc_channels[] = { ADC_CHANNEL_0, ADC_CHANNEL_1, ADC_CHANNEL_4, ADC_CHANNEL_8 };
+  sConfig.SamplingTime = ADC_SAMPLETIME_71CYCLES_5;
+  for (uint32_t i = 0; i < sizeof(adc_channels) / sizeof(adc_channels[0]); i++)
+  {
+    sConfig.Channel = adc_channels[i];
+    sConfig.Rank = ADC_REGULAR_RANK_1 + i;
+    HAL_ADC_ConfigChannel(&hadc1, &sConfig);
+  }
  /* USER CODE END ADC1_Init 2 */
 
 }
@@ -321,7 +369,25 @@ static void MX_TIM2_Init(void)
     Error_Handler();
   }
   /* USER CODE BEGIN TIM2_Init 2 */
+  /* Chu kỳ tính lúc chạy nên không đặt trong CubeMX được.
+     TIM2 clock = 2 x PCLK1 (APB1 prescaler /2); one CC2 event per ADC scan */
+  uint32_t tim2_period = (2U * HAL_RCC_GetPCLK1Freq()) / ADC_SCAN_RATE_HZ - 1U;
+  htim2.Init.Period = tim2_period;
+  if (HAL_TIM_PWM_Init(&htim2) != HAL_OK)
+  {
+    Error_Handler();
+  }
 
+  /* CC2 only triggers ADC1; PA1 stays in analog mode so nothing is driven on the pin */
+  TIM_OC_InitTypeDef sConfigOC = {0};
+  sConfigOC.OCMode = TIM_OCMODE_PWM1;
+  sConfigOC.Pulse = tim2_period / 2U;
+  sConfigOC.OCPolarity = TIM_OCPOLARITY_HIGH;
+  sConfigOC.OCFastMode = TIM_OCFAST_DISABLE;
+  if (HAL_TIM_PWM_ConfigChannel(&htim2, &sConfigOC, TIM_CHANNEL_2) != HAL_OK)
+  {
+    Error_Handler();
+  }
   /* USER CODE END TIM2_Init 2 */
 
 }
@@ -393,7 +459,10 @@ static void MX_GPIO_Init(void)
   __HAL_RCC_GPIOB_CLK_ENABLE();
 
   /*Configure GPIO pin Output Level */
-  HAL_GPIO_WritePin(GPIOB, LED1_Pin|LED2_Pin|RELAY2_Pin|RELAY1_Pin, GPIO_PIN_RESET);
+  HAL_GPIO_WritePin(GPIOB, LED2_Pin|RELAY2_Pin, GPIO_PIN_RESET);
+
+  /*Configure GPIO pin Output Level */
+  HAL_GPIO_WritePin(GPIOB, LED1_Pin|RELAY1_Pin, GPIO_PIN_SET);
 
   /*Configure GPIO pins : LED1_Pin LED2_Pin RELAY2_Pin RELAY1_Pin */
   GPIO_InitStruct.Pin = LED1_Pin|LED2_Pin|RELAY2_Pin|RELAY1_Pin;
@@ -409,7 +478,15 @@ static void MX_GPIO_Init(void)
   HAL_GPIO_Init(GPIOB, &GPIO_InitStruct);
 
   /* USER CODE BEGIN MX_GPIO_Init_2 */
+  /* DI1-DI4: ngắt EXTI cả hai sườn (không có trong .ioc) để ghi thời điểm sườn và cắt nhanh */
+  GPIO_InitStruct.Pin = DI1_Pin|DI2_Pin|DI3_Pin|DI4_Pin;
+  GPIO_InitStruct.Mode = GPIO_MODE_IT_RISING_FALLING;
+  GPIO_InitStruct.Pull = GPIO_NOPULL;
+  HAL_GPIO_Init(GPIOB, &GPIO_InitStruct);
 
+  /* EXTI interrupt init*/
+  HAL_NVIC_SetPriority(EXTI15_10_IRQn, 5, 0);
+  HAL_NVIC_EnableIRQ(EXTI15_10_IRQn);
   /* USER CODE END MX_GPIO_Init_2 */
 }
 
@@ -427,14 +504,58 @@ static void MX_GPIO_Init(void)
 void StartDefaultTask(void *argument)
 {
   /* USER CODE BEGIN 5 */
+  Boot_Timing_Mark(BOOT_PHASE_SCHEDULER);
+
+  // Chờ nửa bộ đệm ADC đầu tiên (~1 ms) để vòng đầu không đánh giá trên adc_buffer rỗng
+  while (!Safety_Monitor_Sample_Ready()) {
+    osDelay(1);
+  }
+  uint8_t first_evaluation = 1;
+
+  // Mốc đánh thức kế tiếp: chu kỳ tính từ mốc, không trôi theo thời gian xử lý
+  uint32_t next_wake = osKernelGetTickCount();
+
   /* Infinite loop */
   for(;;)
   { 
+    PROFILE_MARK(PROFILE_LOOP_PERIOD);
+
+    PROFILE_BEGIN(PROFILE_REGISTER_LOAD);
     Safety_Register_Load();
+    PROFILE_END(PROFILE_REGISTER_LOAD);
+
     updateBaudrate();
+
+    PROFILE_BEGIN(PROFILE_SAFETY_PROCESS);
     Safety_Monitor_Process();
+    PROFILE_END(PROFILE_SAFETY_PROCESS);
+
+    // Relay 2-4 theo lệnh master (coil/REG_RELAYx_CONTROL); RELAY1 chỉ do safety logic điều khiển
+    Output_Control_Process();
+
+    PROFILE_BEGIN(PROFILE_REGISTER_SAVE);
     Safety_Register_Save();
-    osDelay(1);
+    PROFILE_END(PROFILE_REGISTER_SAVE);
+
+    if (first_evaluation) {
+      first_evaluation = 0;
+      Boot_Timing_Mark(BOOT_PHASE_FIRST_EVALUATION);
+      osThreadFlagsSet(modbusTaskHandle, MODBUS_FLAG_SAFETY_READY);
+    }
+
+    next_wake += (uint32_t)g_safety_system.loop_period_ms * osKernelGetTickFreq() / 1000U;
+    // osDelayUntil trả osErrorParameter cả khi mốc đúng bằng tick hiện tại, nên tự so sánh có dấu
+    int32_t remaining = (int32_t)(next_wake - osKernelGetTickCount());
+    if (remaining > 0) {
+      // Tick có thể vừa chạm mốc trước khi gọi: khi đó lỗi trả về chỉ có nghĩa là đã đến giờ
+      (void)osDelayUntil(next_wake);
+    }
+    else if (remaining < 0) {
+      // Đã quá hạn: đếm trễ hạn, nhường CPU một tick rồi lập lại lịch từ thời điểm hiện tại
+      g_safety_system.loop_overrun_count++;
+      osDelay(1);
+      next_wake = osKernelGetTickCount();
+    }
   }
   /* USER CODE END 5 */
 }
@@ -449,24 +570,40 @@ void StartDefaultTask(void *argument)
 void StartModbusTask(void *argument)
 {
   /* USER CODE BEGIN StartModbusTask */
+  // Ưu tiên cao hơn safety task nhưng chỉ mở Modbus sau vòng safety đầu tiên
+  osThreadFlagsWait(MODBUS_FLAG_SAFETY_READY, osFlagsWaitAny, osWaitForever);
+  g_lastUARTActivity = HAL_GetTick();
+  startUARTReception();
+  Boot_Timing_Mark(BOOT_PHASE_MODBUS_READY);
+
   /* Infinite loop */
   for(;;)
   {
+    // Chờ ISR nhận báo có khung, ISR phát báo có thể trả lời khung đang chờ, hoặc watchdog báo UART im lặng
+    uint32_t flags = osThreadFlagsWait(MODBUS_FLAG_FRAME_READY | MODBUS_FLAG_TX_DONE | MODBUS_FLAG_UART_TIMEOUT,
+                                       osFlagsWaitAny, osWaitForever);
+    if (flags & osFlagsError) {
+      continue;
+    }
+
     // Update Modbus counter
     g_modbusCounter++;
     
     // Check for UART timeout (10 seconds)
-    if (HAL_GetTick() - g_lastUARTActivity > 10000) {
+    if (flags & MODBUS_FLAG_UART_TIMEOUT) {
       resetUARTCommunication();
       g_lastUARTActivity = HAL_GetTick();
     }
     
-    // Process Modbus frame if received
-    if (frameReceived) {
-      processModbusFrame();
+    // Xử lý lần lượt các khung trong hàng đợi; dừng khi phản hồi trước còn đang phát
+    while (isModbusFramePending()) {
+      PROFILE_BEGIN(PROFILE_MODBUS_FRAME);
+      uint8_t handled = processModbusFrame();
+      PROFILE_END(PROFILE_MODBUS_FRAME);
+      if (!handled) {
+        break;
+      }
     }
-    HAL_GPIO_TogglePin(LED2_GPIO_Port, LED2_Pin);
-    osDelay(100); // 100ms delay
   }
   /* USER CODE END StartModbusTask */
 }
@@ -5,7 +5,11 @@
 
 # Add inputs and outputs from these tool invocations to the build variables 
 C_SRCS += \
+../Core/Src/Analog_Filter.c \
+../Core/Src/Boot_Timing.c \
+../Core/Src/Config_Store.c \
 ../Core/Src/Output_Control.c \
+../Core/Src/Profiler.c \
 ../Core/Src/Safety_Monitor.c \
 ../Core/Src/UartModbus.c \
 ../Core/Src/freertos.c \
@@ -17,7 +21,11 @@ C_SRCS += \
 ../Core/Src/system_stm32f1xx.c 
 
 OBJS += \
+./Core/Src/Analog_Filter.o \
+./Core/Src/Boot_Timing.o \
+./Core/Src/Config_Store.o \
 ./Core/Src/Output_Control.o \
+./Core/Src/Profiler.o \
 ./Core/Src/Safety_Monitor.o \
 ./Core/Src/UartModbus.o \
 ./Core/Src/freertos.o \
@@ -29,7 +37,11 @@ OBJS += \
 ./Core/Src/system_stm32f1xx.o 
 
 C_DEPS += \
+./Core/Src/Analog_Filter.d \
+./Core/Src/Boot_Timing.d \
+./Core/Src/Config_Store.d \
 ./Core/Src/Output_Control.d \
+./Core/Src/Profiler.d \
 ./Core/Src/Safety_Monitor.d \
 ./Core/Src/UartModbus.d \
 ./Core/Src/freertos.d \
@@ -48,7 +60,7 @@ Core/Src/%.o Core/Src/%.su Core/Src/%.cyclo: ../Core/Src/%.c Core/Src/subdir.mk
 clean: clean-Core-2f-Src
 
 clean-Core-2f-Src:
-	-$(RM) ./Core/Src/Output_Control.cyclo ./Core/Src/Output_Control.d ./Core/Src/Output_Control.o ./Core/Src/Output_Control.su ./Core/Src/Safety_Monitor.cyclo ./Core/Src/Safety_Monitor.d ./Core/Src/Safety_Monitor.o ./Core/Src/Safety_Monitor.su ./Core/Src/UartModbus.cyclo ./Core/Src/UartModbus.d ./Core/Src/UartModbus.o ./Core/Src/UartModbus.su ./Core/Src/freertos.cyclo ./Core/Src/freertos.d ./Core/Src/freertos.o ./Core/Src/freertos.su ./Core/Src/main.cyclo ./Core/Src/main.d ./Core/Src/main.o ./Core/Src/main.su ./Core/Src/stm32f1xx_hal_msp.cyclo ./Core/Src/stm32f1xx_hal_msp.d ./Core/Src/stm32f1xx_hal_msp.o ./Core/Src/stm32f1xx_hal_msp.su ./Core/Src/stm32f1xx_it.cyclo ./Core/Src/stm32f1xx_it.d ./Core/Src/stm32f1xx_it.o ./Core/Src/stm32f1xx_it.su ./Core/Src/syscalls.cyclo ./Core/Src/syscalls.d ./Core/Src/syscalls.o ./Core/Src/syscalls.su ./Core/Src/sysmem.cyclo ./Core/Src/sysmem.d ./Core/Src/sysmem.o ./Core/Src/sysmem.su ./Core/Src/system_stm32f1xx.cyclo ./Core/Src/system_stm32f1xx.d ./Core/Src/system_stm32f1xx.o ./Core/Src/system_stm32f1xx.su
+	-$(RM) ./Core/Src/Analog_Filter.cyclo ./Core/Src/Analog_Filter.d ./Core/Src/Analog_Filter.o ./Core/Src/Analog_Filter.su ./Core/Src/Boot_Timing.cyclo ./Core/Src/Boot_Timing.d ./Core/Src/Boot_Timing.o ./Core/Src/Boot_Timing.su ./Core/Src/Config_Store.cyclo ./Core/Src/Config_Store.d ./Core/Src/Config_Store.o ./Core/Src/Config_Store.su ./Core/Src/Output_Control.cyclo ./Core/Src/Output_Control.d ./Core/Src/Output_Control.o ./Core/Src/Output_Control.su ./Core/Src/Profiler.cyclo ./Core/Src/Profiler.d ./Core/Src/Profiler.o ./Core/Src/Profiler.su ./Core/Src/Safety_Monitor.cyclo ./Core/Src/Safety_Monitor.d ./Core/Src/Safety_Monitor.o ./Core/Src/Safety_Monitor.su ./Core/Src/UartModbus.cyclo ./Core/Src/UartModbus.d ./Core/Src/UartModbus.o ./Core/Src/UartModbus.su ./Core/Src/freertos.cyclo ./Core/Src/freertos.d ./Core/Src/freertos.o ./Core/Src/freertos.su ./Core/Src/main.cyclo ./Core/Src/main.d ./Core/Src/main.o ./Core/Src/main.su ./Core/Src/stm32f1xx_hal_msp.cyclo ./Core/Src/stm32f1xx_hal_msp.d ./Core/Src/stm32f1xx_hal_msp.o ./Core/Src/stm32f1xx_hal_msp.su ./Core/Src/stm32f1xx_it.cyclo ./Core/Src/stm32f1xx_it.d ./Core/Src/stm32f1xx_it.o ./Core/Src/stm32f1xx_it.su ./Core/Src/syscalls.cyclo ./Core/Src/syscalls.d ./Core/Src/syscalls.o ./Core/Src/syscalls.su ./Core/Src/sysmem.cyclo ./Core/Src/sysmem.d ./Core/Src/sysmem.o ./Core/Src/sysmem.su ./Core/Src/system_stm32f1xx.cyclo ./Core/Src/system_stm32f1xx.d ./Core/Src/system_stm32f1xx.o ./Core/Src/system_stm32f1xx.su
 
 .PHONY: clean-Core-2f-Src
 
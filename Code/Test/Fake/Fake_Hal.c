@@ -0,0 +1,787 @@
+/**
+ * @file Fake_Hal.c
+ * @brief Các hàm HAL mà firmware gọi, chạy trên thanh ghi giả ở đúng địa chỉ STM32
+ * @note Chỉ mô phỏng phần firmware thực sự dùng: GPIO/EXTI, ADC1 + DMA1_Channel1 vòng,
+ *       USART2 nhận ReceiveToIdle qua DMA vòng và phát DMA, flash trang 1 KB, SysTick.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "main.h"
+#include "stm32f1xx_it.h"
+#include "Config_Store.h"
+#include "Fake_Hal.h"
+#include "Fake_Rtos.h"
+
+#define FAKE_PERIPH_SIZE        0x24000UL   // APB1, APB2, AHB đến hết FLASH_R/CRC
+#define FAKE_FLASH_SIZE         (CONFIG_STORE_BANK_COUNT * CONFIG_STORE_BANK_SIZE)
+#define FAKE_PCLK1_HZ           8000000U
+#define FAKE_TIM2_CLOCK_HZ      (2U * FAKE_PCLK1_HZ)
+#define FAKE_IRQ_COUNT          64U
+
+uint32_t SystemCoreClock = 16000000U;
+
+static uint64_t s_now_ns;
+static uint64_t s_max_stall_ns;
+static void (*s_stall_hook)(void);
+static volatile uint32_t s_tick;
+
+static uint8_t s_irq_enabled[FAKE_IRQ_COUNT];
+
+static ADC_HandleTypeDef *s_adc;
+static uint16_t *s_adc_buffer;
+static uint32_t s_adc_length;
+static TIM_HandleTypeDef *s_tim;
+static uint8_t s_tim_running;
+
+static UART_HandleTypeDef *s_uart;
+static void (*s_uart_tx_hook)(const uint8_t *data, uint16_t length);
+
+static GPIO_TypeDef *s_exti_port[16];
+
+static uint8_t s_flash_locked = 1;
+static Fake_Flash_Stats_t s_flash_stats;
+static uint32_t s_flash_operations;
+static uint32_t s_flash_cut_at;
+static void (*s_flash_cut)(void);
+
+/* Ánh xạ thanh ghi ngoại vi và vùng flash cấu hình trước main() của test. Flash dùng
+ * MAP_SHARED để tiến trình con (một lần chạy firmware) để lại dữ liệu cho lần khởi động sau. */
+__attribute__((constructor)) static void Fake_Hal_Map(void)
+{
+    void *periph = mmap((void *)PERIPH_BASE, FAKE_PERIPH_SIZE, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+    void *flash = mmap((void *)CONFIG_STORE_BASE, FAKE_FLASH_SIZE, PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+    if (periph != (void *)PERIPH_BASE || flash != (void *)CONFIG_STORE_BASE) {
+        fprintf(stderr, "sim: cannot map STM32 address space (build with -no-pie)\n");
+        abort();
+    }
+    memset(flash, 0xFF, FAKE_FLASH_SIZE);
+}
+
+static void Fake_Raise(void (*handler)(void))
+{
+    Fake_Rtos_Enter_Isr();
+    handler();
+    Fake_Rtos_Exit_Isr();
+}
+
+void Fake_Disable_Irq(void)
+{
+    fprintf(stderr, "sim: Error_Handler() reached\n");
+    abort();
+}
+
+/* ---- Thời gian ---- */
+
+uint32_t Fake_Cycle_Counter(void)
+{
+    return (uint32_t)s_now_ns;
+}
+
+uint64_t Fake_Now_Ns(void)
+{
+    return s_now_ns;
+}
+
+void Fake_Set_Now_Ns(uint64_t now_ns)
+{
+    s_now_ns = now_ns;
+}
+
+void Fake_Stall_Ns(uint64_t duration_ns)
+{
+    s_now_ns += duration_ns;
+    if (duration_ns > s_max_stall_ns) {
+        s_max_stall_ns = duration_ns;
+    }
+    if (s_stall_hook != NULL) {
+        s_stall_hook();
+    }
+}
+
+uint64_t Fake_Max_Stall_Ns(void)
+{
+    return s_max_stall_ns;
+}
+
+void Fake_Reset_Max_Stall(void)
+{
+    s_max_stall_ns = 0;
+}
+
+void Fake_Set_Stall_Hook(void (*hook)(void))
+{
+    s_stall_hook = hook;
+}
+
+HAL_StatusTypeDef HAL_Init(void)
+{
+    HAL_MspInit();
+    return HAL_OK;
+}
+
+void HAL_IncTick(void)
+{
+    s_tick++;
+}
+
+uint32_t HAL_GetTick(void)
+{
+    return s_tick;
+}
+
+void Fake_Systick(void)
+{
+    Fake_Raise(SysTick_Handler);
+}
+
+/* ---- RCC / NVIC ---- */
+
+HAL_StatusTypeDef HAL_RCC_OscConfig(RCC_OscInitTypeDef *RCC_OscInitStruct)
+{
+    (void)RCC_OscInitStruct;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_RCC_ClockConfig(RCC_ClkInitTypeDef *RCC_ClkInitStruct, uint32_t FLatency)
+{
+    (void)RCC_ClkInitStruct;
+    (void)FLatency;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_RCCEx_PeriphCLKConfig(RCC_PeriphCLKInitTypeDef *PeriphClkInit)
+{
+    (void)PeriphClkInit;
+    return HAL_OK;
+}
+
+uint32_t HAL_RCC_GetPCLK1Freq(void)
+{
+    return FAKE_PCLK1_HZ;
+}
+
+void HAL_NVIC_SetPriority(IRQn_Type IRQn, uint32_t PreemptPriority, uint32_t SubPriority)
+{
+    (void)IRQn;
+    (void)PreemptPriority;
+    (void)SubPriority;
+}
+
+void HAL_NVIC_EnableIRQ(IRQn_Type IRQn)
+{
+    if (IRQn >= 0 && (uint32_t)IRQn < FAKE_IRQ_COUNT) {
+        s_irq_enabled[IRQn] = 1;
+    }
+}
+
+void HAL_NVIC_DisableIRQ(IRQn_Type IRQn)
+{
+    if (IRQn >= 0 && (uint32_t)IRQn < FAKE_IRQ_COUNT) {
+        s_irq_enabled[IRQn] = 0;
+    }
+}
+
+/* ---- DMA ---- */
+
+static uint32_t Fake_Dma_Shift(const DMA_HandleTypeDef *hdma)
+{
+    uint32_t stride = (uint32_t)((uintptr_t)DMA1_Channel2 - (uintptr_t)DMA1_Channel1);
+    return 4U * (uint32_t)(((uintptr_t)hdma->Instance - (uintptr_t)DMA1_Channel1) / stride);
+}
+
+static void Fake_Dma_Start(DMA_HandleTypeDef *hdma, uint32_t length)
+{
+    hdma->Instance->CNDTR = length;
+    hdma->Instance->CCR |= DMA_CCR_HTIE | DMA_CCR_TCIE | DMA_CCR_TEIE | DMA_CCR_EN;
+    hdma->State = HAL_DMA_STATE_BUSY;
+}
+
+static void Fake_Dma_Stop(DMA_HandleTypeDef *hdma)
+{
+    if (hdma != NULL) {
+        hdma->Instance->CCR &= ~(DMA_CCR_HTIE | DMA_CCR_TCIE | DMA_CCR_TEIE | DMA_CCR_EN);
+        hdma->State = HAL_DMA_STATE_READY;
+    }
+}
+
+HAL_StatusTypeDef HAL_DMA_Init(DMA_HandleTypeDef *hdma)
+{
+    hdma->Instance->CCR = (hdma->Init.Mode == DMA_CIRCULAR) ? DMA_CCR_CIRC : 0U;
+    hdma->State = HAL_DMA_STATE_READY;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_DMA_DeInit(DMA_HandleTypeDef *hdma)
+{
+    hdma->Instance->CCR = 0U;
+    hdma->Instance->CNDTR = 0U;
+    hdma->State = HAL_DMA_STATE_RESET;
+    return HAL_OK;
+}
+
+// Như HAL: nửa bộ đệm, rồi hết bộ đệm; chỉ gọi callback khi ngắt tương ứng được bật
+void HAL_DMA_IRQHandler(DMA_HandleTypeDef *hdma)
+{
+    uint32_t shift = Fake_Dma_Shift(hdma);
+    uint32_t flags = DMA1->ISR >> shift;
+    uint32_t ccr = hdma->Instance->CCR;
+
+    if ((flags & DMA_ISR_HTIF1) && (ccr & DMA_CCR_HTIE)) {
+        DMA1->ISR &= ~((DMA_ISR_HTIF1 | DMA_ISR_GIF1) << shift);
+        if (hdma->XferHalfCpltCallback != NULL) {
+            hdma->XferHalfCpltCallback(hdma);
+        }
+    } else if ((flags & DMA_ISR_TCIF1) && (ccr & DMA_CCR_TCIE)) {
+        DMA1->ISR &= ~((DMA_ISR_TCIF1 | DMA_ISR_GIF1) << shift);
+        if ((ccr & DMA_CCR_CIRC) == 0U) {
+            Fake_Dma_Stop(hdma);
+        }
+        if (hdma->XferCpltCallback != NULL) {
+            hdma->XferCpltCallback(hdma);
+        }
+    }
+}
+
+static void Fake_Dma_Raise(DMA_HandleTypeDef *hdma, uint32_t flag, void (*handler)(void))
+{
+    DMA1->ISR |= (flag | DMA_ISR_GIF1) << Fake_Dma_Shift(hdma);
+    Fake_Raise(handler);
+}
+
+/* ---- ADC1 + TIM2 ---- */
+
+static void Fake_Adc_Dma_Half(DMA_HandleTypeDef *hdma)
+{
+    HAL_ADC_ConvHalfCpltCallback((ADC_HandleTypeDef *)hdma->Parent);
+}
+
+static void Fake_Adc_Dma_Cplt(DMA_HandleTypeDef *hdma)
+{
+    HAL_ADC_ConvCpltCallback((ADC_HandleTypeDef *)hdma->Parent);
+}
+
+HAL_StatusTypeDef HAL_ADC_Init(ADC_HandleTypeDef *hadc)
+{
+    if (hadc->State == HAL_ADC_STATE_RESET) {
+        HAL_ADC_MspInit(hadc);
+    }
+    hadc->State = HAL_ADC_STATE_READY;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_ADC_ConfigChannel(ADC_HandleTypeDef *hadc, ADC_ChannelConfTypeDef *sConfig)
+{
+    (void)hadc;
+    (void)sConfig;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_ADCEx_Calibration_Start(ADC_HandleTypeDef *hadc)
+{
+    (void)hadc;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_ADC_Start_DMA(ADC_HandleTypeDef *hadc, uint32_t *pData, uint32_t Length)
+{
+    s_adc = hadc;
+    s_adc_buffer = (uint16_t *)pData;
+    s_adc_length = Length;
+    hadc->DMA_Handle->XferHalfCpltCallback = Fake_Adc_Dma_Half;
+    hadc->DMA_Handle->XferCpltCallback = Fake_Adc_Dma_Cplt;
+    Fake_Dma_Start(hadc->DMA_Handle, Length);
+    return HAL_OK;
+}
+
+__weak void HAL_ADC_ConvHalfCpltCallback(ADC_HandleTypeDef *hadc)
+{
+    (void)hadc;
+}
+
+__weak void HAL_ADC_ConvCpltCallback(ADC_HandleTypeDef *hadc)
+{
+    (void)hadc;
+}
+
+uint16_t *Fake_Adc_Buffer(uint32_t *length)
+{
+    if (s_adc == NULL || !s_tim_running || (s_adc->DMA_Handle->Instance->CCR & DMA_CCR_EN) == 0U) {
+        return NULL;
+    }
+    *length = s_adc_length;
+    return s_adc_buffer;
+}
+
+uint64_t Fake_Adc_Scan_Period_Ns(void)
+{
+    uint64_t counts = (uint64_t)(s_tim->Init.Prescaler + 1U) * (s_tim->Init.Period + 1U);
+    return counts * 1000000000ULL / FAKE_TIM2_CLOCK_HZ;
+}
+
+void Fake_Adc_Transfer_Event(uint8_t half)
+{
+    if (s_irq_enabled[DMA1_Channel1_IRQn]) {
+        Fake_Dma_Raise(s_adc->DMA_Handle, half ? DMA_ISR_HTIF1 : DMA_ISR_TCIF1, DMA1_Channel1_IRQHandler);
+    }
+}
+
+HAL_StatusTypeDef HAL_TIM_Base_Init(TIM_HandleTypeDef *htim)
+{
+    if (htim->State == HAL_TIM_STATE_RESET) {
+        HAL_TIM_Base_MspInit(htim);
+    }
+    htim->State = HAL_TIM_STATE_READY;
+    s_tim = htim;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_ConfigClockSource(TIM_HandleTypeDef *htim, const TIM_ClockConfigTypeDef *sClockSourceConfig)
+{
+    (void)htim;
+    (void)sClockSourceConfig;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_PWM_Init(TIM_HandleTypeDef *htim)
+{
+    (void)htim;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIMEx_MasterConfigSynchronization(TIM_HandleTypeDef *htim,
+                                                        const TIM_MasterConfigTypeDef *sMasterConfig)
+{
+    (void)htim;
+    (void)sMasterConfig;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_PWM_ConfigChannel(TIM_HandleTypeDef *htim, const TIM_OC_InitTypeDef *sConfig, uint32_t Channel)
+{
+    (void)htim;
+    (void)sConfig;
+    (void)Channel;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_PWM_Start(TIM_HandleTypeDef *htim, uint32_t Channel)
+{
+    (void)Channel;
+    s_tim = htim;
+    s_tim_running = 1;
+    return HAL_OK;
+}
+
+void HAL_TIM_IRQHandler(TIM_HandleTypeDef *htim)
+{
+    (void)htim;
+}
+
+/* ---- GPIO / EXTI ---- */
+
+void HAL_GPIO_Init(GPIO_TypeDef *GPIOx, GPIO_InitTypeDef *GPIO_Init)
+{
+    for (uint32_t line = 0; line < 16U; line++) {
+        uint32_t pin = 1UL << line;
+        if ((GPIO_Init->Pin & pin) == 0U) continue;
+
+        EXTI->IMR &= ~pin;
+        EXTI->RTSR &= ~pin;
+        EXTI->FTSR &= ~pin;
+        if (GPIO_Init->Mode == GPIO_MODE_IT_RISING || GPIO_Init->Mode == GPIO_MODE_IT_RISING_FALLING) {
+            EXTI->RTSR |= pin;
+        }
+        if (GPIO_Init->Mode == GPIO_MODE_IT_FALLING || GPIO_Init->Mode == GPIO_MODE_IT_RISING_FALLING) {
+            EXTI->FTSR |= pin;
+        }
+        if (EXTI->RTSR & pin || EXTI->FTSR & pin) {
+            EXTI->IMR |= pin;
+            s_exti_port[line] = GPIOx;
+        }
+    }
+}
+
+void HAL_GPIO_DeInit(GPIO_TypeDef *GPIOx, uint32_t GPIO_Pin)
+{
+    for (uint32_t line = 0; line < 16U; line++) {
+        uint32_t pin = 1UL << line;
+        if ((GPIO_Pin & pin) && s_exti_port[line] == GPIOx) {
+            EXTI->IMR &= ~pin;
+            s_exti_port[line] = NULL;
+        }
+    }
+}
+
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin)
+{
+    return (GPIOx->IDR & GPIO_Pin) ? GPIO_PIN_SET : GPIO_PIN_RESET;
+}
+
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState)
+{
+    if (PinState != GPIO_PIN_RESET) {
+        GPIOx->ODR |= GPIO_Pin;
+    } else {
+        GPIOx->ODR &= ~(uint32_t)GPIO_Pin;
+    }
+}
+
+void HAL_GPIO_TogglePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin)
+{
+    GPIOx->ODR ^= GPIO_Pin;
+}
+
+void HAL_GPIO_EXTI_IRQHandler(uint16_t GPIO_Pin)
+{
+    if (EXTI->PR & GPIO_Pin) {
+        EXTI->PR &= ~(uint32_t)GPIO_Pin;
+        HAL_GPIO_EXTI_Callback(GPIO_Pin);
+    }
+}
+
+__weak void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin)
+{
+    (void)GPIO_Pin;
+}
+
+void Fake_Gpio_Set_Input(GPIO_TypeDef *port, uint16_t pin, uint8_t level)
+{
+    uint8_t previous = (port->IDR & pin) != 0U;
+    if (level) {
+        port->IDR |= pin;
+    } else {
+        port->IDR &= ~(uint32_t)pin;
+    }
+    if (previous == (level != 0U)) {
+        return;
+    }
+
+    uint32_t line = (uint32_t)__builtin_ctz(pin);
+    uint32_t edge = level ? EXTI->RTSR : EXTI->FTSR;
+    if ((EXTI->IMR & pin) && (edge & pin) && s_exti_port[line] == port) {
+        EXTI->PR |= pin;
+        if (line < 10U) {
+            fprintf(stderr, "sim: EXTI line %u has no handler in stm32f1xx_it.c\n", (unsigned)line);
+            abort();
+        }
+        if (s_irq_enabled[EXTI15_10_IRQn]) {
+            Fake_Raise(EXTI15_10_IRQHandler);
+        }
+    }
+}
+
+uint8_t Fake_Gpio_Output(GPIO_TypeDef *port, uint16_t pin)
+{
+    return (port->ODR & pin) != 0U;
+}
+
+/* ---- USART2 ---- */
+
+static void Fake_Uart_Dma_Rx_Half(DMA_HandleTypeDef *hdma)
+{
+    UART_HandleTypeDef *huart = (UART_HandleTypeDef *)hdma->Parent;
+    huart->RxEventType = HAL_UART_RXEVENT_HT;
+    if (huart->ReceptionType == HAL_UART_RECEPTION_TOIDLE) {
+        HAL_UARTEx_RxEventCallback(huart, huart->RxXferSize / 2U);
+    }
+}
+
+static void Fake_Uart_Dma_Rx_Cplt(DMA_HandleTypeDef *hdma)
+{
+    UART_HandleTypeDef *huart = (UART_HandleTypeDef *)hdma->Parent;
+    huart->RxEventType = HAL_UART_RXEVENT_TC;
+    if (huart->ReceptionType == HAL_UART_RECEPTION_TOIDLE) {
+        HAL_UARTEx_RxEventCallback(huart, huart->RxXferSize);
+    }
+}
+
+HAL_StatusTypeDef HAL_UART_Init(UART_HandleTypeDef *huart)
+{
+    if (huart->gState == HAL_UART_STATE_RESET) {
+        huart->Lock = HAL_UNLOCKED;
+        HAL_UART_MspInit(huart);
+    }
+    huart->Instance->CR1 = USART_CR1_UE | USART_CR1_TE | USART_CR1_RE;
+    huart->Instance->SR = USART_SR_TC | USART_SR_TXE;
+    huart->ErrorCode = HAL_UART_ERROR_NONE;
+    huart->gState = HAL_UART_STATE_READY;
+    huart->RxState = HAL_UART_STATE_READY;
+    huart->ReceptionType = HAL_UART_RECEPTION_STANDARD;
+    s_uart = huart;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_DeInit(UART_HandleTypeDef *huart)
+{
+    if (huart->gState == HAL_UART_STATE_BUSY_TX && s_uart_tx_hook != NULL) {
+        s_uart_tx_hook(NULL, 0);
+    }
+    huart->gState = HAL_UART_STATE_BUSY;
+    huart->Instance->CR1 = 0U;
+    HAL_UART_MspDeInit(huart);
+    huart->gState = HAL_UART_STATE_RESET;
+    huart->RxState = HAL_UART_STATE_RESET;
+    huart->ReceptionType = HAL_UART_RECEPTION_STANDARD;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UARTEx_ReceiveToIdle_DMA(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size)
+{
+    if (huart->RxState != HAL_UART_STATE_READY || pData == NULL || Size == 0U) {
+        return HAL_BUSY;
+    }
+    huart->ReceptionType = HAL_UART_RECEPTION_TOIDLE;
+    huart->RxEventType = HAL_UART_RXEVENT_TC;
+    huart->pRxBuffPtr = pData;
+    huart->RxXferSize = Size;
+    huart->RxState = HAL_UART_STATE_BUSY_RX;
+    huart->hdmarx->XferHalfCpltCallback = Fake_Uart_Dma_Rx_Half;
+    huart->hdmarx->XferCpltCallback = Fake_Uart_Dma_Rx_Cplt;
+    Fake_Dma_Start(huart->hdmarx, Size);
+    huart->Instance->SR &= ~USART_SR_IDLE;
+    huart->Instance->CR1 |= USART_CR1_IDLEIE;
+    huart->Instance->CR3 |= USART_CR3_DMAR;
+    return HAL_OK;
+}
+
+HAL_UART_RxEventTypeTypeDef HAL_UARTEx_GetRxEventType(UART_HandleTypeDef *huart)
+{
+    return huart->RxEventType;
+}
+
+HAL_StatusTypeDef HAL_UART_Transmit_DMA(UART_HandleTypeDef *huart, const uint8_t *pData, uint16_t Size)
+{
+    if (huart->gState != HAL_UART_STATE_READY) {
+        return HAL_BUSY;
+    }
+    if (pData == NULL || Size == 0U) {
+        return HAL_ERROR;
+    }
+    huart->gState = HAL_UART_STATE_BUSY_TX;
+    huart->Instance->SR &= ~USART_SR_TC;
+    if (s_uart_tx_hook != NULL) {
+        s_uart_tx_hook(pData, Size);
+    }
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_AbortReceive(UART_HandleTypeDef *huart)
+{
+    Fake_Dma_Stop(huart->hdmarx);
+    huart->Instance->CR1 &= ~USART_CR1_IDLEIE;
+    huart->Instance->CR3 &= ~USART_CR3_DMAR;
+    huart->RxState = HAL_UART_STATE_READY;
+    huart->ReceptionType = HAL_UART_RECEPTION_STANDARD;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_Abort(UART_HandleTypeDef *huart)
+{
+    if (huart->gState == HAL_UART_STATE_BUSY_TX && s_uart_tx_hook != NULL) {
+        s_uart_tx_hook(NULL, 0);
+    }
+    Fake_Dma_Stop(huart->hdmatx);
+    huart->gState = HAL_UART_STATE_READY;
+    return HAL_UART_AbortReceive(huart);
+}
+
+// Phần lỗi nhận, IDLE (ReceiveToIdle + DMA) và TC (hết phát) của HAL_UART_IRQHandler
+void HAL_UART_IRQHandler(UART_HandleTypeDef *huart)
+{
+    uint32_t sr = huart->Instance->SR;
+
+    // Như HAL khi nhận bằng DMA: lỗi nào cũng dừng nhận (DMA dừng, CNDTR giữ nguyên) rồi báo callback
+    if ((sr & USART_SR_FE) && (huart->Instance->CR3 & USART_CR3_DMAR)) {
+        huart->Instance->SR &= ~USART_SR_FE;
+        huart->ErrorCode |= HAL_UART_ERROR_FE;
+        HAL_UART_AbortReceive(huart);
+        HAL_UART_ErrorCallback(huart);
+        huart->ErrorCode = HAL_UART_ERROR_NONE;
+        return;
+    }
+
+    if (huart->ReceptionType == HAL_UART_RECEPTION_TOIDLE && (sr & USART_SR_IDLE) &&
+        (huart->Instance->CR1 & USART_CR1_IDLEIE)) {
+        huart->Instance->SR &= ~USART_SR_IDLE;
+        if (huart->Instance->CR3 & USART_CR3_DMAR) {
+            uint16_t remaining = (uint16_t)__HAL_DMA_GET_COUNTER(huart->hdmarx);
+            if (remaining > 0U && remaining < huart->RxXferSize) {
+                huart->RxXferCount = remaining;
+                huart->RxEventType = HAL_UART_RXEVENT_IDLE;
+                HAL_UARTEx_RxEventCallback(huart, (uint16_t)(huart->RxXferSize - huart->RxXferCount));
+            }
+        }
+        return;
+    }
+    // IDLE khi không nhận ToIdle: phần cứng vẫn bật cờ, HAL không xử lý
+    huart->Instance->SR &= ~USART_SR_IDLE;
+
+    if ((sr & USART_SR_TC) && huart->gState == HAL_UART_STATE_BUSY_TX) {
+        huart->gState = HAL_UART_STATE_READY;
+        HAL_UART_TxCpltCallback(huart);
+    }
+}
+
+__weak void HAL_UARTEx_RxEventCallback(UART_HandleTypeDef *huart, uint16_t Size)
+{
+    (void)huart;
+    (void)Size;
+}
+
+__weak void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart)
+{
+    (void)huart;
+}
+
+__weak void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart)
+{
+    (void)huart;
+}
+
+uint8_t Fake_Uart_Rx_Byte(uint8_t data)
+{
+    UART_HandleTypeDef *huart = s_uart;
+    if (huart == NULL || huart->RxState != HAL_UART_STATE_BUSY_RX ||
+        (huart->hdmarx->Instance->CCR & DMA_CCR_EN) == 0U) {
+        return 0;
+    }
+    DMA_Channel_TypeDef *channel = huart->hdmarx->Instance;
+    huart->pRxBuffPtr[huart->RxXferSize - channel->CNDTR] = data;
+    channel->CNDTR--;
+    if (channel->CNDTR == huart->RxXferSize / 2U) {
+        Fake_Dma_Raise(huart->hdmarx, DMA_ISR_HTIF1, DMA1_Channel6_IRQHandler);
+    } else if (channel->CNDTR == 0U) {
+        // Chế độ vòng: bộ đếm nạp lại trước khi ngắt TC được phục vụ
+        channel->CNDTR = huart->RxXferSize;
+        Fake_Dma_Raise(huart->hdmarx, DMA_ISR_TCIF1, DMA1_Channel6_IRQHandler);
+    }
+    return 1;
+}
+
+void Fake_Uart_Rx_Idle(void)
+{
+    if (s_uart != NULL && s_irq_enabled[USART2_IRQn]) {
+        s_uart->Instance->SR |= USART_SR_IDLE;
+        Fake_Raise(USART2_IRQHandler);
+    }
+}
+
+void Fake_Uart_Rx_Frame_Error(void)
+{
+    if (s_uart != NULL && s_irq_enabled[USART2_IRQn]) {
+        s_uart->Instance->SR |= USART_SR_FE;
+        Fake_Raise(USART2_IRQHandler);
+    }
+}
+
+void Fake_Uart_Tx_Complete(void)
+{
+    if (s_uart != NULL && s_irq_enabled[USART2_IRQn]) {
+        s_uart->Instance->SR |= USART_SR_TC;
+        Fake_Raise(USART2_IRQHandler);
+    }
+}
+
+uint32_t Fake_Uart_Baudrate(void)
+{
+    return (s_uart != NULL) ? s_uart->Init.BaudRate : 0U;
+}
+
+void Fake_Set_Uart_Tx_Hook(void (*hook)(const uint8_t *data, uint16_t length))
+{
+    s_uart_tx_hook = hook;
+}
+
+/* ---- Flash ---- */
+
+static uint8_t Fake_Flash_In_Range(uint32_t address, uint32_t length)
+{
+    return address >= CONFIG_STORE_BASE && address + length <= CONFIG_STORE_BASE + FAKE_FLASH_SIZE;
+}
+
+static void Fake_Flash_Operation(void)
+{
+    if (s_flash_cut != NULL && s_flash_operations == s_flash_cut_at) {
+        s_flash_cut();
+    }
+    s_flash_operations++;
+}
+
+HAL_StatusTypeDef HAL_FLASH_Unlock(void)
+{
+    s_flash_locked = 0;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASH_Lock(void)
+{
+    s_flash_locked = 1;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASH_Program(uint32_t TypeProgram, uint32_t Address, uint64_t Data)
+{
+    uint32_t halfwords = (TypeProgram == FLASH_TYPEPROGRAM_HALFWORD) ? 1U :
+                         (TypeProgram == FLASH_TYPEPROGRAM_WORD) ? 2U : 4U;
+    if (s_flash_locked || !Fake_Flash_In_Range(Address, halfwords * 2U)) {
+        s_flash_stats.failures++;
+        return HAL_ERROR;
+    }
+    for (uint32_t i = 0; i < halfwords; i++) {
+        Fake_Flash_Operation();
+        volatile uint16_t *cell = (volatile uint16_t *)(uintptr_t)(Address + 2U * i);
+        uint16_t value = (uint16_t)(Data >> (16U * i));
+        // F1 chỉ cho ghi ô đã xóa (hoặc ghi 0x0000); ngược lại PGERR, ô giữ nguyên
+        if (*cell != 0xFFFFU && value != 0U) {
+            s_flash_stats.failures++;
+            return HAL_ERROR;
+        }
+        *cell = value;
+        s_flash_stats.programs++;
+        Fake_Stall_Ns(FAKE_FLASH_PROGRAM_NS);
+    }
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASHEx_Erase(FLASH_EraseInitTypeDef *pEraseInit, uint32_t *PageError)
+{
+    *PageError = 0xFFFFFFFFU;
+    if (s_flash_locked || pEraseInit->TypeErase != FLASH_TYPEERASE_PAGES ||
+        !Fake_Flash_In_Range(pEraseInit->PageAddress, pEraseInit->NbPages * FLASH_PAGE_SIZE)) {
+        s_flash_stats.failures++;
+        return HAL_ERROR;
+    }
+    for (uint32_t page = 0; page < pEraseInit->NbPages; page++) {
+        uint32_t address = pEraseInit->PageAddress + page * FLASH_PAGE_SIZE;
+        // Mất điện giữa lúc xóa: nửa đầu trang đã về 0xFF, nửa sau còn dữ liệu cũ
+        if (s_flash_cut != NULL && s_flash_operations == s_flash_cut_at) {
+            memset((void *)(uintptr_t)address, 0xFF, FLASH_PAGE_SIZE / 2U);
+        }
+        Fake_Flash_Operation();
+        memset((void *)(uintptr_t)address, 0xFF, FLASH_PAGE_SIZE);
+        s_flash_stats.erases++;
+        Fake_Stall_Ns(FAKE_FLASH_ERASE_NS);
+    }
+    return HAL_OK;
+}
+
+void Fake_Flash_Erase_All(void)
+{
+    memset((void *)CONFIG_STORE_BASE, 0xFF, FAKE_FLASH_SIZE);
+}
+
+void Fake_Flash_Stats(Fake_Flash_Stats_t *stats)
+{
+    *stats = s_flash_stats;
+}
+
+void Fake_Flash_Set_Power_Cut(uint32_t operation, void (*cut)(void))
+{
+    s_flash_cut_at = s_flash_operations + operation;
+    s_flash_cut = cut;
+}
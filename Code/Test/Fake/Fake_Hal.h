@@ -0,0 +1,60 @@
+#ifndef FAKE_HAL_H
+#define FAKE_HAL_H
+
+#include <stdint.h>
+#include "main.h"
+
+/* Phần cứng giả cho bản build host: thay các hàm HAL firmware dùng. Thanh ghi ngoại vi
+ * (0x40000000...) và vùng flash cấu hình được ánh xạ đúng địa chỉ STM32 nên macro CMSIS
+ * (GPIOB->IDR, DMA CNDTR, USART SR...) trong firmware chạy nguyên bản. */
+
+/* Bộ đếm chu kỳ cho Profiler.h bản host: ns theo thời gian mô phỏng */
+uint32_t Fake_Cycle_Counter(void);
+
+/* Thời gian mô phỏng (ns). Chỉ Sim tăng thời gian, trừ Fake_Stall_Ns (CPU bị treo). */
+uint64_t Fake_Now_Ns(void);
+void Fake_Set_Now_Ns(uint64_t now_ns);
+void Fake_Stall_Ns(uint64_t duration_ns);
+uint64_t Fake_Max_Stall_Ns(void);
+void Fake_Reset_Max_Stall(void);
+
+/* Gọi sau mỗi lần CPU bị treo vì flash: Sim xử lý các ngắt đã đến hạn và cho thread
+ * ưu tiên cao hơn timer task chạy, như khi Config_Store_Service bị chiếm CPU giữa hai thao tác */
+void Fake_Set_Stall_Hook(void (*hook)(void));
+
+/* Ngắt SysTick 1 ms (HAL tick + tick FreeRTOS) */
+void Fake_Systick(void);
+
+/* ADC: bộ đệm DMA vòng do HAL_ADC_Start_DMA đăng ký; NULL khi ADC/TIM2 chưa chạy */
+uint16_t *Fake_Adc_Buffer(uint32_t *length);
+uint64_t Fake_Adc_Scan_Period_Ns(void);
+void Fake_Adc_Transfer_Event(uint8_t half);
+
+/* GPIO: đổi mức chân vào, phát EXTI nếu đã cấu hình cạnh tương ứng */
+void Fake_Gpio_Set_Input(GPIO_TypeDef *port, uint16_t pin, uint8_t level);
+uint8_t Fake_Gpio_Output(GPIO_TypeDef *port, uint16_t pin);
+
+/* UART2 (Modbus) */
+uint8_t Fake_Uart_Rx_Byte(uint8_t data);
+void Fake_Uart_Rx_Idle(void);
+void Fake_Uart_Rx_Frame_Error(void);    // Byte đến với lỗi khung (FE): HAL dừng nhận DMA, gọi ErrorCallback
+void Fake_Uart_Tx_Complete(void);
+uint32_t Fake_Uart_Baudrate(void);
+void Fake_Set_Uart_Tx_Hook(void (*hook)(const uint8_t *data, uint16_t length));
+
+/* Flash: thời gian ghi/xóa lấy theo giá trị lớn nhất trong datasheet STM32F103 */
+#define FAKE_FLASH_PROGRAM_NS       70000ULL        // t_prog max 70 us / halfword
+#define FAKE_FLASH_ERASE_NS         40000000ULL     // t_ERASE max 40 ms / trang
+
+typedef struct {
+    uint32_t programs;
+    uint32_t erases;
+    uint32_t failures;
+} Fake_Flash_Stats_t;
+
+void Fake_Flash_Erase_All(void);
+void Fake_Flash_Stats(Fake_Flash_Stats_t *stats);
+// Gọi cut() ngay trước thao tác flash thứ n (đếm từ 0) - mô phỏng mất điện
+void Fake_Flash_Set_Power_Cut(uint32_t operation, void (*cut)(void));
+
+#endif /* FAKE_HAL_H */
@@ -0,0 +1,387 @@
+/**
+ * @file Fake_Rtos.c
+ * @brief CMSIS-RTOS2 (phần firmware dùng) chạy trên pthread, lập lịch tất định
+ * @note Ngữ nghĩa theo cmsis_os2.c + FreeRTOS: ưu tiên cố định, osDelayUntil trả
+ *       osErrorParameter khi mốc đã tới hoặc đã qua, timer chạy ở mức ưu tiên
+ *       configTIMER_TASK_PRIORITY (thấp hơn mọi thread của firmware).
+ */
+#include <pthread.h>
+#include <setjmp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "cmsis_os2.h"
+#include "Fake_Rtos.h"
+#include "Fake_Hal.h"
+
+#define FAKE_THREAD_MAX     4U
+#define FAKE_TIMER_MAX      4U
+
+typedef enum {
+    FAKE_THREAD_READY = 0,
+    FAKE_THREAD_DELAYED,
+    FAKE_THREAD_WAIT_FLAGS,
+} Fake_Thread_State_t;
+
+typedef struct {
+    pthread_t thread;
+    pthread_cond_t cond;
+    osThreadFunc_t func;
+    void *argument;
+    const char *name;
+    osPriority_t priority;
+    Fake_Thread_State_t state;
+    uint32_t wake_tick;         // DELAYED, hoặc WAIT_FLAGS có timeout
+    uint8_t has_timeout;
+    uint8_t timed_out;
+    uint32_t flags;
+    uint32_t wait_flags;
+    uint32_t wait_options;
+} Fake_Thread_t;
+
+typedef struct {
+    osTimerFunc_t func;
+    void *argument;
+    osTimerType_t type;
+    uint32_t period;
+    uint32_t expiry;
+    uint8_t running;
+    uint32_t pending;           // Số lần hết hạn chưa chạy callback
+} Fake_Timer_t;
+
+static pthread_mutex_t s_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t s_sim_cond = PTHREAD_COND_INITIALIZER;
+
+static Fake_Thread_t s_threads[FAKE_THREAD_MAX];
+static uint8_t s_thread_count;
+static Fake_Timer_t s_timers[FAKE_TIMER_MAX];
+static uint8_t s_timer_count;
+
+// Ngữ cảnh đang chạy: NULL = mô phỏng (ISR, timer, test)
+static Fake_Thread_t *s_running;
+static __thread Fake_Thread_t *s_self;
+static uint32_t s_isr_depth;
+static uint8_t s_timer_active;
+
+static volatile uint32_t s_tick;
+static uint8_t s_started;
+static jmp_buf s_boot_jmp;
+
+// Thread hiện tại nhường quyền cho ngữ cảnh mô phỏng và chờ đến lượt chạy lại
+static void Fake_Thread_Block(Fake_Thread_t *self)
+{
+    pthread_mutex_lock(&s_lock);
+    s_running = NULL;
+    pthread_cond_signal(&s_sim_cond);
+    while (s_running != self) {
+        pthread_cond_wait(&self->cond, &s_lock);
+    }
+    pthread_mutex_unlock(&s_lock);
+}
+
+// Ngữ cảnh mô phỏng chạy một thread đến khi nó block hoặc nhường
+static void Fake_Thread_Switch(Fake_Thread_t *thread)
+{
+    pthread_mutex_lock(&s_lock);
+    s_running = thread;
+    pthread_cond_signal(&thread->cond);
+    while (s_running != NULL) {
+        pthread_cond_wait(&s_sim_cond, &s_lock);
+    }
+    pthread_mutex_unlock(&s_lock);
+}
+
+static void *Fake_Thread_Entry(void *arg)
+{
+    Fake_Thread_t *self = (Fake_Thread_t *)arg;
+    s_self = self;
+
+    pthread_mutex_lock(&s_lock);
+    while (s_running != self) {
+        pthread_cond_wait(&self->cond, &s_lock);
+    }
+    pthread_mutex_unlock(&s_lock);
+
+    self->func(self->argument);
+    fprintf(stderr, "sim: thread %s returned\n", self->name);
+    abort();
+}
+
+static Fake_Thread_t *Fake_Highest_Ready(void)
+{
+    Fake_Thread_t *best = NULL;
+    for (uint8_t i = 0; i < s_thread_count; i++) {
+        Fake_Thread_t *t = &s_threads[i];
+        if (t->state == FAKE_THREAD_READY && (best == NULL || t->priority > best->priority)) {
+            best = t;
+        }
+    }
+    return best;
+}
+
+static uint8_t Fake_Flags_Satisfied(const Fake_Thread_t *t)
+{
+    if (t->wait_options & osFlagsWaitAll) {
+        return (t->flags & t->wait_flags) == t->wait_flags;
+    }
+    return (t->flags & t->wait_flags) != 0U;
+}
+
+void Fake_Rtos_Boot(int (*entry)(void))
+{
+    if (setjmp(s_boot_jmp) == 0) {
+        entry();
+        fprintf(stderr, "sim: firmware main returned before osKernelStart\n");
+        abort();
+    }
+}
+
+void Fake_Rtos_Run(void)
+{
+    if (!s_started) {
+        return;
+    }
+    for (;;) {
+        Fake_Thread_t *thread = Fake_Highest_Ready();
+        if (thread != NULL) {
+            Fake_Thread_Switch(thread);
+            continue;
+        }
+        // Timer task: chỉ chạy khi mọi thread ưu tiên cao hơn đã block. Gọi lồng từ trong
+        // callback timer (CPU được nhả giữa hai thao tác flash) thì chỉ chạy thread.
+        uint8_t ran = 0;
+        for (uint8_t i = 0; i < s_timer_count && !s_timer_active; i++) {
+            Fake_Timer_t *timer = &s_timers[i];
+            if (timer->pending) {
+                timer->pending--;
+                s_timer_active = 1;
+                timer->func(timer->argument);
+                s_timer_active = 0;
+                ran = 1;
+                break;
+            }
+        }
+        if (!ran) {
+            break;
+        }
+    }
+}
+
+void Fake_Rtos_Enter_Isr(void)
+{
+    s_isr_depth++;
+}
+
+void Fake_Rtos_Exit_Isr(void)
+{
+    s_isr_depth--;
+}
+
+uint8_t Fake_Rtos_Started(void)
+{
+    return s_started;
+}
+
+/* ---- Port FreeRTOS: phần được gọi trực tiếp từ firmware ---- */
+
+void vPortEnterCritical(void)
+{
+    // Các ngữ cảnh không bao giờ chạy song song nên không cần khóa thật
+}
+
+void vPortExitCritical(void)
+{
+}
+
+BaseType_t xTaskGetSchedulerState(void)
+{
+    return s_started ? taskSCHEDULER_RUNNING : taskSCHEDULER_NOT_STARTED;
+}
+
+void xPortSysTickHandler(void)
+{
+    uint32_t tick = ++s_tick;
+
+    for (uint8_t i = 0; i < s_thread_count; i++) {
+        Fake_Thread_t *t = &s_threads[i];
+        if ((t->state == FAKE_THREAD_DELAYED || (t->state == FAKE_THREAD_WAIT_FLAGS && t->has_timeout)) &&
+            (int32_t)(tick - t->wake_tick) >= 0) {
+            t->timed_out = (t->state == FAKE_THREAD_WAIT_FLAGS);
+            t->state = FAKE_THREAD_READY;
+        }
+    }
+    for (uint8_t i = 0; i < s_timer_count; i++) {
+        Fake_Timer_t *timer = &s_timers[i];
+        if (timer->running && tick == timer->expiry) {
+            timer->pending++;
+            if (timer->type == osTimerPeriodic) {
+                timer->expiry += timer->period;
+            } else {
+                timer->running = 0;
+            }
+        }
+    }
+}
+
+/* ---- CMSIS-RTOS2 ---- */
+
+osStatus_t osKernelInitialize(void)
+{
+    return osOK;
+}
+
+osStatus_t osKernelStart(void)
+{
+    // Scheduler tiếp quản: quay về Fake_Rtos_Boot, Sim điều khiển từ đây
+    s_started = 1;
+    longjmp(s_boot_jmp, 1);
+}
+
+uint32_t osKernelGetTickCount(void)
+{
+    return s_tick;
+}
+
+uint32_t osKernelGetTickFreq(void)
+{
+    return configTICK_RATE_HZ;
+}
+
+osThreadId_t osThreadNew(osThreadFunc_t func, void *argument, const osThreadAttr_t *attr)
+{
+    if (s_thread_count >= FAKE_THREAD_MAX) {
+        return NULL;
+    }
+    Fake_Thread_t *t = &s_threads[s_thread_count++];
+    memset(t, 0, sizeof(*t));
+    t->func = func;
+    t->argument = argument;
+    t->name = (attr != NULL && attr->name != NULL) ? attr->name : "thread";
+    t->priority = (attr != NULL && attr->priority != osPriorityNone) ? attr->priority : osPriorityNormal;
+    t->state = FAKE_THREAD_READY;
+    pthread_cond_init(&t->cond, NULL);
+    pthread_create(&t->thread, NULL, Fake_Thread_Entry, t);
+    return (osThreadId_t)t;
+}
+
+osThreadId_t osThreadGetId(void)
+{
+    return (osThreadId_t)s_self;
+}
+
+uint32_t osThreadFlagsSet(osThreadId_t thread_id, uint32_t flags)
+{
+    Fake_Thread_t *t = (Fake_Thread_t *)thread_id;
+    if (t == NULL) {
+        return (uint32_t)osErrorParameter;
+    }
+    t->flags |= flags;
+    uint32_t result = t->flags;
+    if (t->state == FAKE_THREAD_WAIT_FLAGS && Fake_Flags_Satisfied(t)) {
+        t->state = FAKE_THREAD_READY;
+    }
+    // Gọi từ thread: thread đích ưu tiên cao hơn chiếm CPU ngay (ISR thì chờ đến khi ra khỏi ngắt)
+    Fake_Thread_t *self = s_self;
+    if (self != NULL && s_isr_depth == 0U && t->state == FAKE_THREAD_READY && t->priority > self->priority) {
+        Fake_Thread_Block(self);
+    }
+    return result;
+}
+
+uint32_t osThreadFlagsWait(uint32_t flags, uint32_t options, uint32_t timeout)
+{
+    Fake_Thread_t *self = s_self;
+    if (self == NULL) {
+        return (uint32_t)osErrorISR;
+    }
+    self->wait_flags = flags;
+    self->wait_options = options;
+    if (!Fake_Flags_Satisfied(self)) {
+        if (timeout == 0U) {
+            return (uint32_t)osErrorResource;
+        }
+        self->state = FAKE_THREAD_WAIT_FLAGS;
+        self->has_timeout = (timeout != osWaitForever);
+        self->wake_tick = s_tick + timeout;
+        self->timed_out = 0;
+        Fake_Thread_Block(self);
+        if (self->timed_out) {
+            return (uint32_t)osErrorTimeout;
+        }
+    }
+    uint32_t result = self->flags;
+    if ((options & osFlagsNoClear) == 0U) {
+        self->flags &= ~flags;
+    }
+    return result;
+}
+
+osStatus_t osDelay(uint32_t ticks)
+{
+    Fake_Thread_t *self = s_self;
+    if (self == NULL) {
+        return osErrorISR;
+    }
+    if (ticks != 0U) {
+        self->state = FAKE_THREAD_DELAYED;
+        self->wake_tick = s_tick + ticks;
+        Fake_Thread_Block(self);
+    }
+    return osOK;
+}
+
+osStatus_t osDelayUntil(uint32_t ticks)
+{
+    Fake_Thread_t *self = s_self;
+    if (self == NULL) {
+        return osErrorISR;
+    }
+    // Như cmsis_os2.c: mốc bằng hoặc trước tick hiện tại -> osErrorParameter, không chờ
+    uint32_t delay = ticks - s_tick;
+    if (delay == 0U || (delay >> 31) != 0U) {
+        return osErrorParameter;
+    }
+    self->state = FAKE_THREAD_DELAYED;
+    self->wake_tick = ticks;
+    Fake_Thread_Block(self);
+    return osOK;
+}
+
+osTimerId_t osTimerNew(osTimerFunc_t func, osTimerType_t type, void *argument, const osTimerAttr_t *attr)
+{
+    (void)attr;
+    if (s_timer_count >= FAKE_TIMER_MAX) {
+        return NULL;
+    }
+    Fake_Timer_t *timer = &s_timers[s_timer_count++];
+    memset(timer, 0, sizeof(*timer));
+    timer->func = func;
+    timer->argument = argument;
+    timer->type = type;
+    return (osTimerId_t)timer;
+}
+
+osStatus_t osTimerStart(osTimerId_t timer_id, uint32_t ticks)
+{
+    Fake_Timer_t *timer = (Fake_Timer_t *)timer_id;
+    if (timer == NULL || ticks == 0U) {
+        return osErrorParameter;
+    }
+    timer->period = ticks;
+    timer->expiry = s_tick + ticks;
+    timer->running = 1;
+    return osOK;
+}
+
+osStatus_t osTimerStop(osTimerId_t timer_id)
+{
+    Fake_Timer_t *timer = (Fake_Timer_t *)timer_id;
+    if (timer == NULL || !timer->running) {
+        return osErrorResource;
+    }
+    timer->running = 0;
+    return osOK;
+}
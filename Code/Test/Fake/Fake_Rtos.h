@@ -0,0 +1,29 @@
+#ifndef FAKE_RTOS_H
+#define FAKE_RTOS_H
+
+#include <stdint.h>
+
+/* Bản thay thế CMSIS-RTOS2 + port FreeRTOS cho bộ mô phỏng trên host.
+ * Mỗi thread firmware là một pthread nhưng chỉ một ngữ cảnh chạy tại một thời điểm
+ * (trao quyền qua mutex/condvar). Thread chạy tức thời theo thời gian mô phỏng; thời gian
+ * chỉ trôi khi mọi thread đã block, do Sim điều khiển. */
+
+/**
+ * @brief Chạy hàm main của firmware đến osKernelStart() rồi quay về
+ * @param entry: Firmware_Main (main.c biên dịch với -Dmain=Firmware_Main)
+ */
+void Fake_Rtos_Boot(int (*entry)(void));
+
+/**
+ * @brief Chạy các thread sẵn sàng (ưu tiên cao trước) và callback timer đến khi tất cả block
+ * @note Chỉ gọi từ ngữ cảnh mô phỏng (thread của test)
+ */
+void Fake_Rtos_Run(void);
+
+/* Đánh dấu đang ở trong ISR: osThreadFlagsSet không chuyển ngữ cảnh ngay */
+void Fake_Rtos_Enter_Isr(void);
+void Fake_Rtos_Exit_Isr(void);
+
+uint8_t Fake_Rtos_Started(void);
+
+#endif /* FAKE_RTOS_H */
@@ -0,0 +1,57 @@
+/**
+ * @file core_cm3.h (host)
+ * @brief Chặn trước core_cm3.h của CMSIS khi build trên máy host
+ * @note stm32f103xb.h include "core_cm3.h" từ thư mục Device nên file này (đứng trước trong
+ *       đường dẫn include) được lấy thay. Định nghĩa sẵn các macro của cmsis_gcc.h bằng C
+ *       thuần rồi chuyển sang bản gốc - các hàm nội tại dùng lệnh ARM không được sinh ra.
+ */
+#ifndef FAKE_CORE_CM3_H
+#define FAKE_CORE_CM3_H
+
+#include <stdint.h>
+
+/* Bỏ qua toàn bộ cmsis_gcc.h (inline asm ARM) */
+#define __CMSIS_GCC_H
+
+#define __ASM                       __asm
+#define __INLINE                    inline
+#define __STATIC_INLINE             static inline
+#define __STATIC_FORCEINLINE        __attribute__((always_inline)) static inline
+#define __NO_RETURN                 __attribute__((__noreturn__))
+#define __USED                      __attribute__((used))
+#define __WEAK                      __attribute__((weak))
+#define __PACKED                    __attribute__((packed, aligned(1)))
+#define __PACKED_STRUCT             struct __attribute__((packed, aligned(1)))
+#define __PACKED_UNION              union __attribute__((packed, aligned(1)))
+#define __ALIGNED(x)                __attribute__((aligned(x)))
+#define __RESTRICT                  __restrict
+#define __COMPILER_BARRIER()        __asm volatile("" ::: "memory")
+
+/* Rào bộ nhớ: mô phỏng chạy từng ngữ cảnh một, chỉ cần chặn trình biên dịch sắp xếp lại */
+#define __NOP()                     __COMPILER_BARRIER()
+#define __DSB()                     __COMPILER_BARRIER()
+#define __ISB()                     __COMPILER_BARRIER()
+#define __DMB()                     __COMPILER_BARRIER()
+#define __WFI()                     __COMPILER_BARRIER()
+
+#define __CLZ(value)                ((uint8_t)((value) == 0U ? 32U : (uint32_t)__builtin_clz(value)))
+#define __REV(value)                __builtin_bswap32(value)
+
+static inline uint32_t __RBIT(uint32_t value)
+{
+    uint32_t result = 0U;
+    for (uint32_t i = 0U; i < 32U; i++) {
+        result = (result << 1) | (value & 1U);
+        value >>= 1;
+    }
+    return result;
+}
+
+/* Firmware chỉ khóa ngắt trong Error_Handler: trên host coi đó là lỗi và dừng test */
+void Fake_Disable_Irq(void);
+#define __disable_irq()             Fake_Disable_Irq()
+#define __enable_irq()              ((void)0)
+
+#include_next "core_cm3.h"
+
+#endif /* FAKE_CORE_CM3_H */
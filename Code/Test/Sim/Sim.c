@@ -0,0 +1,466 @@
+/**
+ * @file Sim.c
+ * @brief Lịch sự kiện phần cứng và API kịch bản cho test trên host
+ * @note Thread firmware chạy tức thời; thời gian chỉ trôi giữa các sự kiện (SysTick mỗi 1 ms,
+ *       nửa bộ đệm ADC, từng byte UART, IDLE, hết phát). Ngắt chạy trong ngữ cảnh của Sim.
+ */
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "Sim.h"
+#include "Fake_Hal.h"
+#include "Fake_Rtos.h"
+#include "UartModbus.h"
+#include "Safety_Monitor.h"
+
+#define SIM_EVENT_MAX           2048U
+#define SIM_TX_FRAME_MAX        16U
+#define SIM_TX_FRAME_SIZE       260U
+
+typedef struct {
+    uint64_t at;
+    uint64_t seq;
+    void (*fn)(uintptr_t);
+    uintptr_t arg;
+} Sim_Event_t;
+
+typedef struct {
+    uint8_t data[SIM_TX_FRAME_SIZE];
+    uint16_t length;
+    uint64_t start_ns;
+} Sim_Tx_Frame_t;
+
+int Firmware_Main(void);
+
+static Sim_Event_t s_events[SIM_EVENT_MAX];
+static uint32_t s_event_count;
+static uint64_t s_event_seq;
+static pthread_t s_sim_thread;
+
+static uint16_t s_analog_code[ANALOG_SENSOR_COUNT];
+static Sim_Analog_Source_t s_analog_source[ANALOG_SENSOR_COUNT];
+static void *s_analog_context[ANALOG_SENSOR_COUNT];
+static uint8_t s_adc_half;
+
+static uint64_t s_line_free_ns;
+static uint32_t s_tx_sequence;
+static Sim_Tx_Frame_t s_tx_frames[SIM_TX_FRAME_MAX];
+static uint32_t s_tx_head;
+static uint32_t s_tx_tail;
+static uint32_t s_tx_total;
+static uint64_t s_last_tx_start_ns;
+
+static GPIO_TypeDef *const s_di_port[DIGITAL_SENSOR_COUNT] = {
+    DI1_GPIO_Port, DI2_GPIO_Port, DI3_GPIO_Port, DI4_GPIO_Port
+};
+static const uint16_t s_di_pin[DIGITAL_SENSOR_COUNT] = { DI1_Pin, DI2_Pin, DI3_Pin, DI4_Pin };
+
+static void Sim_Schedule(uint64_t at, void (*fn)(uintptr_t), uintptr_t arg)
+{
+    if (s_event_count >= SIM_EVENT_MAX) {
+        fprintf(stderr, "sim: event queue full\n");
+        abort();
+    }
+    s_events[s_event_count++] = (Sim_Event_t){ at, s_event_seq++, fn, arg };
+}
+
+// Sự kiện sớm nhất (cùng thời điểm: theo thứ tự lên lịch)
+static int Sim_Next_Event(void)
+{
+    int best = -1;
+    for (uint32_t i = 0; i < s_event_count; i++) {
+        if (best < 0 || s_events[i].at < s_events[best].at ||
+            (s_events[i].at == s_events[best].at && s_events[i].seq < s_events[best].seq)) {
+            best = (int)i;
+        }
+    }
+    return best;
+}
+
+static void Sim_Dispatch(int index)
+{
+    Sim_Event_t event = s_events[index];
+    s_events[index] = s_events[--s_event_count];
+    if (event.at > Fake_Now_Ns()) {
+        Fake_Set_Now_Ns(event.at);
+    }
+    event.fn(event.arg);
+}
+
+// Xử lý mọi ngắt đã đến hạn rồi cho các thread chạy đến khi block
+static void Sim_Service(void)
+{
+    for (;;) {
+        int next = Sim_Next_Event();
+        if (next >= 0 && s_events[next].at <= Fake_Now_Ns()) {
+            Sim_Dispatch(next);
+            continue;
+        }
+        Fake_Rtos_Run();
+        next = Sim_Next_Event();
+        if (next < 0 || s_events[next].at > Fake_Now_Ns()) {
+            break;
+        }
+    }
+}
+
+// CPU vừa thoát khỏi một thao tác flash: chỉ xử lý tiếp khi đang ở ngữ cảnh Sim (timer task)
+static void Sim_Stall_Hook(void)
+{
+    if (pthread_equal(pthread_self(), s_sim_thread)) {
+        Sim_Service();
+    }
+}
+
+static void Sim_Systick_Event(uintptr_t arg)
+{
+    (void)arg;
+    Fake_Systick();
+    Sim_Schedule(Fake_Now_Ns() + SIM_NS_PER_MS, Sim_Systick_Event, 0);
+}
+
+static uint16_t Sim_Analog_Sample(uint8_t channel, uint64_t time_ns)
+{
+    if (s_analog_source[channel] != NULL) {
+        return s_analog_source[channel](channel, time_ns, s_analog_context[channel]);
+    }
+    return s_analog_code[channel];
+}
+
+// Một nửa bộ đệm DMA: ADC_OVERSAMPLE_RATIO lần quét 4 kênh, mỗi lần một chu kỳ TIM2
+static void Sim_Adc_Event(uintptr_t half_start_ns)
+{
+    uint32_t length;
+    uint16_t *buffer = Fake_Adc_Buffer(&length);
+    uint64_t period = Fake_Adc_Scan_Period_Ns();
+    uint32_t scans = length / 2U / ANALOG_SENSOR_COUNT;
+
+    if (buffer != NULL) {
+        uint16_t *samples = &buffer[s_adc_half ? length / 2U : 0U];
+        for (uint32_t scan = 0; scan < scans; scan++) {
+            uint64_t t = (uint64_t)half_start_ns + scan * period;
+            for (uint8_t ch = 0; ch < ANALOG_SENSOR_COUNT; ch++) {
+                *samples++ = Sim_Analog_Sample(ch, t) & 0x0FFFU;
+            }
+        }
+        Fake_Adc_Transfer_Event(s_adc_half == 0);
+        s_adc_half ^= 1U;
+    }
+    uint64_t next_start = (uint64_t)half_start_ns + scans * period;
+    Sim_Schedule(next_start + scans * period, Sim_Adc_Event, (uintptr_t)next_start);
+}
+
+static uint64_t Sim_Char_Ns(void)
+{
+    uint32_t baud = Fake_Uart_Baudrate();
+    return (baud != 0U) ? (10ULL * 1000000000ULL + baud - 1U) / baud : 0U;
+}
+
+static void Sim_Uart_Tx_Done(uintptr_t sequence)
+{
+    if ((uint32_t)sequence == s_tx_sequence) {
+        Fake_Uart_Tx_Complete();
+    }
+}
+
+static void Sim_Uart_Tx_Hook(const uint8_t *data, uint16_t length)
+{
+    s_tx_sequence++;
+    if (data == NULL) {
+        return;     // Abort/DeInit: bỏ sự kiện hết phát đang chờ
+    }
+    if (s_tx_head - s_tx_tail < SIM_TX_FRAME_MAX) {
+        Sim_Tx_Frame_t *frame = &s_tx_frames[s_tx_head++ % SIM_TX_FRAME_MAX];
+        frame->length = (length > SIM_TX_FRAME_SIZE) ? SIM_TX_FRAME_SIZE : length;
+        memcpy(frame->data, data, frame->length);
+        frame->start_ns = Fake_Now_Ns();
+    }
+    s_tx_total++;
+    Sim_Schedule(Fake_Now_Ns() + length * Sim_Char_Ns(), Sim_Uart_Tx_Done, s_tx_sequence);
+}
+
+static void Sim_Uart_Rx_Event(uintptr_t data)
+{
+    (void)Fake_Uart_Rx_Byte((uint8_t)data);
+}
+
+static void Sim_Uart_Error_Event(uintptr_t arg)
+{
+    (void)arg;
+    Fake_Uart_Rx_Frame_Error();
+}
+
+static void Sim_Uart_Idle_Event(uintptr_t arg)
+{
+    (void)arg;
+    Fake_Uart_Rx_Idle();
+}
+
+void Sim_Boot(void)
+{
+    s_sim_thread = pthread_self();
+    Fake_Set_Uart_Tx_Hook(Sim_Uart_Tx_Hook);
+    Fake_Set_Stall_Hook(Sim_Stall_Hook);
+
+    Fake_Rtos_Boot(Firmware_Main);
+
+    uint64_t now = Fake_Now_Ns();
+    Sim_Schedule(now + SIM_NS_PER_MS, Sim_Systick_Event, 0);
+    uint32_t length;
+    if (Fake_Adc_Buffer(&length) != NULL) {
+        uint64_t half = (uint64_t)(length / 2U / ANALOG_SENSOR_COUNT) * Fake_Adc_Scan_Period_Ns();
+        Sim_Schedule(now + half, Sim_Adc_Event, (uintptr_t)now);
+    }
+    s_line_free_ns = now;
+}
+
+int Sim_Run_Previous_Boot(void (*session)(void))
+{
+    fflush(NULL);
+    pid_t pid = fork();
+    if (pid == 0) {
+        Sim_Boot();
+        session();
+        fflush(NULL);
+        _exit(0);
+    }
+    int status;
+    if (pid < 0 || waitpid(pid, &status, 0) != pid || !WIFEXITED(status)) {
+        return -1;
+    }
+    return WEXITSTATUS(status);
+}
+
+void Sim_Run_Us(uint64_t us)
+{
+    uint64_t end = Fake_Now_Ns() + us * SIM_NS_PER_US;
+    for (;;) {
+        Sim_Service();
+        int next = Sim_Next_Event();
+        if (next < 0 || s_events[next].at > end) {
+            break;
+        }
+        Sim_Dispatch(next);
+    }
+    if (Fake_Now_Ns() < end) {
+        Fake_Set_Now_Ns(end);
+    }
+}
+
+void Sim_Run_Ms(uint32_t ms)
+{
+    Sim_Run_Us((uint64_t)ms * 1000U);
+}
+
+uint64_t Sim_Now_Ns(void)
+{
+    return Fake_Now_Ns();
+}
+
+/* ---- Analog / Digital / đầu ra ---- */
+
+void Sim_Set_Analog_Code(uint8_t channel, uint16_t code)
+{
+    s_analog_code[channel] = code;
+    s_analog_source[channel] = NULL;
+}
+
+void Sim_Set_Analog_Source(uint8_t channel, Sim_Analog_Source_t source, void *context)
+{
+    s_analog_source[channel] = source;
+    s_analog_context[channel] = context;
+}
+
+void Sim_Set_Digital(uint8_t channel, uint8_t level)
+{
+    Fake_Gpio_Set_Input(s_di_port[channel], s_di_pin[channel], level);
+}
+
+uint8_t Sim_Relay(uint8_t relay)
+{
+    return (relay == 1U) ? Fake_Gpio_Output(RELAY1_GPIO_Port, RELAY1_Pin)
+                         : Fake_Gpio_Output(RELAY2_GPIO_Port, RELAY2_Pin);
+}
+
+/* ---- Modbus ---- */
+
+// CRC-16/MODBUS theo bit (đa thức 0xA001) - độc lập với bảng tra của firmware
+uint16_t Sim_Modbus_CRC(const uint8_t *data, uint16_t length)
+{
+    uint16_t crc = 0xFFFFU;
+    for (uint16_t i = 0; i < length; i++) {
+        crc ^= data[i];
+        for (uint8_t bit = 0; bit < 8U; bit++) {
+            crc = (crc & 1U) ? (uint16_t)((crc >> 1) ^ 0xA001U) : (uint16_t)(crc >> 1);
+        }
+    }
+    return crc;
+}
+
+static uint64_t Sim_Modbus_Send(const uint8_t *frame, uint16_t length, uint16_t error_index)
+{
+    uint64_t char_ns = Sim_Char_Ns();
+    uint64_t t = (s_line_free_ns > Fake_Now_Ns()) ? s_line_free_ns : Fake_Now_Ns();
+    for (uint16_t i = 0; i < length; i++) {
+        t += char_ns;
+        if (i == error_index) {
+            Sim_Schedule(t, Sim_Uart_Error_Event, 0);
+        } else {
+            Sim_Schedule(t, Sim_Uart_Rx_Event, frame[i]);
+        }
+    }
+    // Đường truyền rảnh một ký tự sau byte cuối -> cờ IDLE
+    Sim_Schedule(t + char_ns, Sim_Uart_Idle_Event, 0);
+    // Khoảng lặng 3,5 ký tự giữa hai khung RTU
+    s_line_free_ns = t + (char_ns * 7U) / 2U;
+    return t;
+}
+
+uint64_t Sim_Modbus_Send_Raw(const uint8_t *frame, uint16_t length)
+{
+    return Sim_Modbus_Send(frame, length, UINT16_MAX);
+}
+
+uint64_t Sim_Modbus_Send_Frame_Error(const uint8_t *frame, uint16_t length, uint16_t error_index)
+{
+    return Sim_Modbus_Send(frame, length, error_index);
+}
+
+int Sim_Modbus_Receive(uint8_t *response, uint16_t max_length, uint32_t timeout_ms)
+{
+    uint64_t deadline = Fake_Now_Ns() + (uint64_t)timeout_ms * SIM_NS_PER_MS;
+    while (s_tx_head == s_tx_tail && Fake_Now_Ns() < deadline) {
+        Sim_Run_Us(100);
+    }
+    if (s_tx_head == s_tx_tail) {
+        return SIM_MODBUS_NO_RESPONSE;
+    }
+    Sim_Tx_Frame_t *frame = &s_tx_frames[s_tx_tail++ % SIM_TX_FRAME_MAX];
+    s_last_tx_start_ns = frame->start_ns;
+    uint16_t length = (frame->length < max_length) ? frame->length : max_length;
+    memcpy(response, frame->data, length);
+    // Để việc phát hoàn tất trước khi test gửi khung kế tiếp
+    uint64_t tx_end = frame->start_ns + frame->length * Sim_Char_Ns();
+    if (tx_end > Fake_Now_Ns()) {
+        Sim_Run_Us((tx_end - Fake_Now_Ns() + SIM_NS_PER_US - 1U) / SIM_NS_PER_US);
+    }
+    return length;
+}
+
+uint64_t Sim_Modbus_Last_Tx_Start_Ns(void)
+{
+    return s_last_tx_start_ns;
+}
+
+uint32_t Sim_Modbus_Tx_Frame_Count(void)
+{
+    return s_tx_total;
+}
+
+int Sim_Modbus_Transact(const uint8_t *pdu, uint16_t length, uint8_t *response, uint16_t max_length)
+{
+    uint8_t frame[SIM_TX_FRAME_SIZE];
+    frame[0] = MODBUS_SLAVE_ADDRESS;
+    memcpy(&frame[1], pdu, length);
+    uint16_t crc = Sim_Modbus_CRC(frame, length + 1U);
+    frame[length + 1U] = (uint8_t)crc;
+    frame[length + 2U] = (uint8_t)(crc >> 8);
+    Sim_Modbus_Send_Raw(frame, length + 3U);
+
+    int received = Sim_Modbus_Receive(response, max_length, SIM_MODBUS_TIMEOUT_MS);
+    if (received < 0) {
+        return received;
+    }
+    if (received < 5 || response[0] != MODBUS_SLAVE_ADDRESS || Sim_Modbus_CRC(response, (uint16_t)received) != 0U) {
+        return SIM_MODBUS_BAD_RESPONSE;
+    }
+    return received;
+}
+
+// Phản hồi exception: trả mã exception, ngược lại 0
+static int Sim_Modbus_Exception(const uint8_t *response, uint8_t function)
+{
+    if (response[1] == (uint8_t)(function | 0x80U)) {
+        return response[2];
+    }
+    return (response[1] == function) ? 0 : SIM_MODBUS_BAD_RESPONSE;
+}
+
+int Sim_Modbus_Read(uint8_t function, uint16_t address, uint16_t quantity, uint16_t *values)
+{
+    uint8_t pdu[5] = { function, (uint8_t)(address >> 8), (uint8_t)address,
+                       (uint8_t)(quantity >> 8), (uint8_t)quantity };
+    uint8_t response[SIM_TX_FRAME_SIZE];
+    int length = Sim_Modbus_Transact(pdu, sizeof(pdu), response, sizeof(response));
+    if (length < 0) {
+        return length;
+    }
+    int status = Sim_Modbus_Exception(response, function);
+    if (status != 0) {
+        return status;
+    }
+    if (response[2] != quantity * 2U || length != 5 + quantity * 2) {
+        return SIM_MODBUS_BAD_RESPONSE;
+    }
+    for (uint16_t i = 0; i < quantity; i++) {
+        values[i] = (uint16_t)((response[3 + 2 * i] << 8) | response[4 + 2 * i]);
+    }
+    return 0;
+}
+
+int Sim_Modbus_Read_Bits(uint8_t function, uint16_t address, uint16_t quantity, uint8_t *bits)
+{
+    uint8_t pdu[5] = { function, (uint8_t)(address >> 8), (uint8_t)address,
+                       (uint8_t)(quantity >> 8), (uint8_t)quantity };
+    uint8_t response[SIM_TX_FRAME_SIZE];
+    int length = Sim_Modbus_Transact(pdu, sizeof(pdu), response, sizeof(response));
+    if (length < 0) {
+        return length;
+    }
+    int status = Sim_Modbus_Exception(response, function);
+    if (status != 0) {
+        return status;
+    }
+    for (uint16_t i = 0; i < quantity; i++) {
+        bits[i] = (response[3 + i / 8] >> (i % 8)) & 1U;
+    }
+    return 0;
+}
+
+int Sim_Modbus_Write_Register(uint16_t address, uint16_t value)
+{
+    uint8_t pdu[5] = { 6, (uint8_t)(address >> 8), (uint8_t)address, (uint8_t)(value >> 8), (uint8_t)value };
+    uint8_t response[SIM_TX_FRAME_SIZE];
+    int length = Sim_Modbus_Transact(pdu, sizeof(pdu), response, sizeof(response));
+    return (length < 0) ? length : Sim_Modbus_Exception(response, 6);
+}
+
+int Sim_Modbus_Write_Registers(uint16_t address, uint16_t quantity, const uint16_t *values)
+{
+    uint8_t pdu[6 + 2 * 123];
+    pdu[0] = 16;
+    pdu[1] = (uint8_t)(address >> 8);
+    pdu[2] = (uint8_t)address;
+    pdu[3] = (uint8_t)(quantity >> 8);
+    pdu[4] = (uint8_t)quantity;
+    pdu[5] = (uint8_t)(quantity * 2U);
+    for (uint16_t i = 0; i < quantity; i++) {
+        pdu[6 + 2 * i] = (uint8_t)(values[i] >> 8);
+        pdu[7 + 2 * i] = (uint8_t)values[i];
+    }
+    uint8_t response[SIM_TX_FRAME_SIZE];
+    int length = Sim_Modbus_Transact(pdu, (uint16_t)(6U + 2U * quantity), response, sizeof(response));
+    return (length < 0) ? length : Sim_Modbus_Exception(response, 16);
+}
+
+int Sim_Modbus_Write_Coil(uint16_t address, uint8_t on)
+{
+    uint8_t pdu[5] = { 5, (uint8_t)(address >> 8), (uint8_t)address, on ? 0xFF : 0x00, 0x00 };
+    uint8_t response[SIM_TX_FRAME_SIZE];
+    int length = Sim_Modbus_Transact(pdu, sizeof(pdu), response, sizeof(response));
+    return (length < 0) ? length : Sim_Modbus_Exception(response, 5);
+}
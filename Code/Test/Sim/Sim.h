@@ -0,0 +1,68 @@
+#ifndef SIM_H
+#define SIM_H
+
+#include <stdint.h>
+#include "main.h"
+
+/* Mô hình bo mạch cho test trên host: chạy firmware thật (main.c, Safety_Monitor.c,
+ * UartModbus.c, Analog_Filter.c, Config_Store.c...) trên HAL/RTOS giả, thời gian mô phỏng.
+ * Test kịch bản hóa mã ADC, mức DI và khung Modbus rồi kiểm tra relay. */
+
+#define SIM_NS_PER_US               1000ULL
+#define SIM_NS_PER_MS               1000000ULL
+
+/* Khởi động firmware (main() đến osKernelStart) và bật SysTick, ADC, UART mô phỏng */
+void Sim_Boot(void);
+
+/* Lần chạy firmware trước (tiến trình con): Sim_Boot, session() rồi mất điện. Chỉ vùng flash
+ * cấu hình (MAP_SHARED) còn lại cho Sim_Boot kế tiếp của test. Gọi trước Sim_Boot.
+ * Trả mã thoát của lần chạy đó (0 = session chạy hết, TEST_ASSERT sai = 1) */
+int Sim_Run_Previous_Boot(void (*session)(void));
+
+/* Chạy mô phỏng thêm một khoảng thời gian */
+void Sim_Run_Us(uint64_t us);
+void Sim_Run_Ms(uint32_t ms);
+uint64_t Sim_Now_Ns(void);
+
+/* ---- Analog: mã ADC 12 bit mỗi lần quét, kênh = thứ tự trong adc_buffer (0-3) ---- */
+typedef uint16_t (*Sim_Analog_Source_t)(uint8_t channel, uint64_t time_ns, void *context);
+
+void Sim_Set_Analog_Code(uint8_t channel, uint16_t code);
+void Sim_Set_Analog_Source(uint8_t channel, Sim_Analog_Source_t source, void *context);
+
+/* ---- Digital: DI1-DI4 (channel 0-3), đổi mức ngay, EXTI chạy như phần cứng ---- */
+void Sim_Set_Digital(uint8_t channel, uint8_t level);
+
+/* ---- Đầu ra: mức chân RELAY1 (PB5) / RELAY2 (PB4); RELAY1 = 1 là đã cắt (trạng thái an toàn) ---- */
+uint8_t Sim_Relay(uint8_t relay);
+
+/* ---- Modbus RTU qua USART2 (thời gian byte theo baudrate hiện tại) ---- */
+#define SIM_MODBUS_TIMEOUT_MS       100U
+#define SIM_MODBUS_NO_RESPONSE      (-1)
+#define SIM_MODBUS_BAD_RESPONSE     (-2)
+
+uint16_t Sim_Modbus_CRC(const uint8_t *data, uint16_t length);
+
+/* Gửi khung (đã có CRC) bắt đầu khi đường truyền rảnh; trả thời điểm byte cuối tới (ns) */
+uint64_t Sim_Modbus_Send_Raw(const uint8_t *frame, uint16_t length);
+// Như Sim_Modbus_Send_Raw nhưng byte thứ error_index đến với lỗi khung (FE) thay vì dữ liệu
+uint64_t Sim_Modbus_Send_Frame_Error(const uint8_t *frame, uint16_t length, uint16_t error_index);
+
+/* Khung phản hồi kế tiếp firmware phát (kể cả CRC); chạy mô phỏng tối đa timeout_ms để chờ.
+ * Trả độ dài, SIM_MODBUS_NO_RESPONSE nếu không có */
+int Sim_Modbus_Receive(uint8_t *response, uint16_t max_length, uint32_t timeout_ms);
+// Thời điểm firmware bắt đầu phát khung Sim_Modbus_Receive vừa trả (ns)
+uint64_t Sim_Modbus_Last_Tx_Start_Ns(void);
+uint32_t Sim_Modbus_Tx_Frame_Count(void);
+
+/* Gửi PDU (địa chỉ slave và CRC do Sim thêm) rồi chờ phản hồi. Trả độ dài phản hồi */
+int Sim_Modbus_Transact(const uint8_t *pdu, uint16_t length, uint8_t *response, uint16_t max_length);
+
+/* Tiện ích: trả 0 nếu thành công, mã exception Modbus (> 0) hoặc SIM_MODBUS_* (< 0) */
+int Sim_Modbus_Read(uint8_t function, uint16_t address, uint16_t quantity, uint16_t *values);
+int Sim_Modbus_Read_Bits(uint8_t function, uint16_t address, uint16_t quantity, uint8_t *bits);
+int Sim_Modbus_Write_Register(uint16_t address, uint16_t value);
+int Sim_Modbus_Write_Registers(uint16_t address, uint16_t quantity, const uint16_t *values);
+int Sim_Modbus_Write_Coil(uint16_t address, uint8_t on);
+
+#endif /* SIM_H */
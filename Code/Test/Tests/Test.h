@@ -0,0 +1,33 @@
+#ifndef TEST_H
+#define TEST_H
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Kiểm tra tối giản cho test host: lỗi đầu tiên in vị trí và thoát mã 1 (ctest báo FAIL) */
+#define TEST_ASSERT(cond)                                                           \
+    do {                                                                            \
+        if (!(cond)) {                                                              \
+            fprintf(stderr, "%s:%d: FAIL: %s\n", __FILE__, __LINE__, #cond);        \
+            exit(1);                                                                \
+        }                                                                           \
+    } while (0)
+
+#define TEST_ASSERT_EQ(actual, expected)                                            \
+    do {                                                                            \
+        long long test_a_ = (long long)(actual);                                    \
+        long long test_e_ = (long long)(expected);                                  \
+        if (test_a_ != test_e_) {                                                   \
+            fprintf(stderr, "%s:%d: FAIL: %s == %lld, expected %lld\n",             \
+                    __FILE__, __LINE__, #actual, test_a_, test_e_);                 \
+            exit(1);                                                                \
+        }                                                                           \
+    } while (0)
+
+#define TEST_PASS()                                                                 \
+    do {                                                                            \
+        printf("PASS\n");                                                           \
+        return 0;                                                                   \
+    } while (0)
+
+#endif /* TEST_H */
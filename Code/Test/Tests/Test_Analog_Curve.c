@@ -0,0 +1,64 @@
+/**
+ * @file Test_Analog_Curve.c
+ * @brief Kênh đường cong điểm gãy: miền hợp lệ lấy từ điểm đầu/cuối, không dùng DISTANCE_VALID_MIN/MAX
+ * @note Chạy với cả hai cách phân vùng (SAFETY_CLASSIFY_RAW_CODE = 1 và 0)
+ */
+#include "Test.h"
+#include "Sim.h"
+#include "ModbusMap.h"
+#include "Safety_Monitor.h"
+
+/* Mã 14 bit sau decimate = 4 x mã 12 bit của Sim */
+static const uint16_t s_curve[] = {
+    3,
+    2000, 300,
+    8000, 100,
+    14000, 20,
+};
+
+static uint16_t Read_Register(uint16_t address)
+{
+    uint16_t value = 0;
+    TEST_ASSERT_EQ(Sim_Modbus_Read(3, address, 1, &value), 0);
+    return value;
+}
+
+static void Expect_Status(uint16_t code12, uint8_t status, uint8_t relay)
+{
+    Sim_Set_Analog_Code(0, code12);
+    Sim_Run_Ms(10);
+    TEST_ASSERT_EQ(Read_Register(REG_SNAPSHOT_ANALOG_STATUS) & 0x0FU, status);
+    TEST_ASSERT_EQ(Sim_Relay(1), relay);
+    if (relay) {
+        Sim_Set_Analog_Code(0, 1000);
+        Sim_Run_Ms(10);
+        TEST_ASSERT_EQ(Sim_Modbus_Write_Register(REG_RESET_FLAG, 0), 0);
+        Sim_Run_Ms(10);
+        TEST_ASSERT_EQ(Sim_Relay(1), 0);
+    }
+}
+
+int main(void)
+{
+    Sim_Set_Analog_Code(0, 1000);
+    Sim_Boot();
+    Sim_Run_Ms(20);
+
+    TEST_ASSERT_EQ(Sim_Modbus_Write_Registers(REG_ANALOG_CURVE(0), sizeof(s_curve) / sizeof(s_curve[0]), s_curve), 0);
+    TEST_ASSERT_EQ(Sim_Modbus_Write_Register(REG_ANALOG_1_MODEL, ANALOG_MODEL_CURVE), 0);
+    TEST_ASSERT_EQ(Sim_Modbus_Write_Register(REG_ANALOG_1_ENABLE, 1), 0);
+    Sim_Run_Ms(10);
+    TEST_ASSERT_EQ(Read_Register(REG_SAFETY_ERROR_CODE) & SAFETY_ERROR_CALIBRATION, 0);
+
+    /* 4000 -> ~233: ngoài 10..95 nhưng nằm trên đường cong -> an toàn */
+    Expect_Status(1000, SENSOR_STATUS_OK, 0);
+    TEST_ASSERT(Read_Register(REG_SNAPSHOT_ANALOG_1) > 200);
+    /* 13600 -> ~25: vùng 1 */
+    Expect_Status(3400, SENSOR_STATUS_CRITICAL, 1);
+    /* Điểm cuối (14000 -> 20) vẫn hợp lệ */
+    Expect_Status(3500, SENSOR_STATUS_CRITICAL, 1);
+    /* Ngoài dải đo hai phía: lỗi cảm biến */
+    Expect_Status(400, SENSOR_STATUS_ERROR, 1);
+    Expect_Status(3600, SENSOR_STATUS_ERROR, 1);
+    TEST_PASS();
+}
@@ -0,0 +1,49 @@
+/**
+ * @file Test_Analog_Filter_Config.c
+ * @brief Đổi bộ lọc rồi đổi lại trước khi ISR ADC áp dụng (trong cùng một nửa bộ đệm): bộ lọc
+ *        chạy phải là cấu hình ghi sau cùng, khớp với thanh ghi
+ */
+#include "Test.h"
+#include "Analog_Filter.h"
+
+#define LOW_CODE    1000U
+#define HIGH_CODE   9000U
+
+// Đáp ứng bước thấp -> cao sau một mẫu: NONE ra ngay HIGH_CODE, trung bình 4 ra (3 LOW + HIGH) / 4
+static uint16_t Step_Response(uint8_t channel)
+{
+    for (uint8_t n = 0; n < 8U; n++) {
+        Analog_Filter_Process(channel, LOW_CODE);
+    }
+    return Analog_Filter_Process(channel, HIGH_CODE);
+}
+
+int main(void)
+{
+    Analog_Filter_Init();
+
+    // Đang chạy trung bình 4
+    Analog_Filter_Configure(0, ANALOG_FILTER_MOVING_AVERAGE, 4);
+    TEST_ASSERT_EQ(Step_Response(0), (3U * LOW_CODE + HIGH_CODE) / 4U);
+
+    // Master ghi trung vị 5 rồi ghi lại trung bình 4, ISR chưa chạy giữa hai lần
+    Analog_Filter_Configure(0, ANALOG_FILTER_MEDIAN, 5);
+    Analog_Filter_Configure(0, ANALOG_FILTER_MOVING_AVERAGE, 4);
+    TEST_ASSERT_EQ(Step_Response(0), (3U * LOW_CODE + HIGH_CODE) / 4U);
+    TEST_ASSERT_EQ(g_analog_filters[0].type, ANALOG_FILTER_MOVING_AVERAGE);
+    TEST_ASSERT_EQ(g_analog_filters[0].param, 4);
+
+    // Ngược lại: từ NONE, đổi sang trung bình rồi về NONE trước mẫu kế tiếp
+    Analog_Filter_Configure(1, ANALOG_FILTER_MOVING_AVERAGE, 16);
+    Analog_Filter_Configure(1, ANALOG_FILTER_NONE, 0);
+    TEST_ASSERT_EQ(Step_Response(1), HIGH_CODE);
+    TEST_ASSERT_EQ(g_analog_filters[1].type, ANALOG_FILTER_NONE);
+
+    // Tham số khác nhưng cùng giá trị sau giới hạn: không đặt lại trạng thái bộ lọc đang chạy
+    Analog_Filter_Configure(2, ANALOG_FILTER_IIR, ANALOG_FILTER_IIR_MAX_SHIFT);
+    Analog_Filter_Process(2, LOW_CODE);
+    Analog_Filter_Configure(2, ANALOG_FILTER_IIR, 0xFF);
+    TEST_ASSERT_EQ(g_analog_filters[2].pending, 0);
+
+    TEST_PASS();
+}
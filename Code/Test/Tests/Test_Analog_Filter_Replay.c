@@ -0,0 +1,157 @@
+/**
+ * @file Test_Analog_Filter_Replay.c
+ * @brief Phát lại vết mã ADC (sau oversample, mỗi mẫu 1 nửa bộ đệm = ADC_HALF_BUFFER_US) qua từng
+ *        cấu hình bộ lọc: độ trễ bước nhảy, loại gai, nhiễu còn lại và thời gian mỗi mẫu
+ * @note Không có tham số: vết dựng sẵn (nền + nhiễu, bước nhảy, gai 1 và 2 mẫu). Tham số 1: file
+ *       vết ghi từ thiết bị, mỗi dòng một mã ADC 14 bit - chỉ in độ trễ/chi phí, không kiểm tra
+ */
+#include <stdlib.h>
+#include <time.h>
+
+#include "Test.h"
+#include "Analog_Filter.h"
+#include "Safety_Monitor.h"
+
+#define TRACE_MAX           20000U
+#define TRACE_BASE          2000U
+#define TRACE_STEP          6000U
+#define TRACE_NOISE         24U         // Biên độ nhiễu đều +-
+#define STEP_AT             200U
+#define SPIKE1_AT           400U        // Gai 1 mẫu
+#define SPIKE2_AT           500U        // Gai 2 mẫu
+#define SPIKE_CODE          16000U
+#define STEP_BACK_AT        600U
+#define TRACE_SYNTH_LENGTH  800U
+
+typedef struct {
+    const char *name;
+    uint8_t type;
+    uint8_t param;
+} Filter_Case_t;
+
+static const Filter_Case_t s_cases[] = {
+    { "none",       ANALOG_FILTER_NONE,           0 },
+    { "average 4",  ANALOG_FILTER_MOVING_AVERAGE, 4 },
+    { "average 16", ANALOG_FILTER_MOVING_AVERAGE, 16 },
+    { "iir 1/4",    ANALOG_FILTER_IIR,            2 },
+    { "iir 1/16",   ANALOG_FILTER_IIR,            4 },
+    { "median 3",   ANALOG_FILTER_MEDIAN,         3 },
+    { "median 5",   ANALOG_FILTER_MEDIAN,         5 },
+};
+
+static uint16_t s_trace[TRACE_MAX];
+static uint16_t s_output[TRACE_MAX];
+static uint32_t s_length;
+
+static void Build_Synthetic_Trace(void)
+{
+    uint32_t seed = 0xC0FFEEU;
+    for (uint32_t n = 0; n < TRACE_SYNTH_LENGTH; n++) {
+        seed = seed * 1103515245U + 12345U;
+        int32_t noise = (int32_t)((seed >> 16) % (2U * TRACE_NOISE + 1U)) - (int32_t)TRACE_NOISE;
+        uint32_t level = (n >= STEP_AT && n < STEP_BACK_AT) ? TRACE_STEP : TRACE_BASE;
+        if (n == SPIKE1_AT || n == SPIKE2_AT || n == SPIKE2_AT + 1U) level = SPIKE_CODE;
+        s_trace[n] = (uint16_t)((int32_t)level + noise);
+    }
+    s_length = TRACE_SYNTH_LENGTH;
+}
+
+static void Load_Trace(const char *path)
+{
+    FILE *file = fopen(path, "r");
+    TEST_ASSERT(file != NULL);
+    unsigned code;
+    s_length = 0;
+    while (s_length < TRACE_MAX && fscanf(file, "%u", &code) == 1) {
+        s_trace[s_length++] = (uint16_t)(code > ADC_CODE_MAX ? ADC_CODE_MAX : code);
+    }
+    fclose(file);
+    TEST_ASSERT(s_length > 0);
+}
+
+static double Replay(const Filter_Case_t *filter)
+{
+    struct timespec t0, t1;
+    Analog_Filter_Init();
+    Analog_Filter_Configure(0, filter->type, filter->param);
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (uint32_t n = 0; n < s_length; n++) {
+        s_output[n] = Analog_Filter_Process(0, s_trace[n]);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    return ((t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec)) / s_length;
+}
+
+// Số mẫu từ bước nhảy đến khi đầu ra vượt phân số frac của bước
+static uint32_t Step_Latency(uint32_t from, double frac)
+{
+    double target = TRACE_BASE + frac * (TRACE_STEP - TRACE_BASE);
+    for (uint32_t n = from; n < s_length; n++) {
+        if (s_output[n] >= target) return n - from;
+    }
+    return s_length;
+}
+
+static uint32_t Max_Deviation(uint32_t from, uint32_t to, uint32_t level)
+{
+    uint32_t worst = 0;
+    for (uint32_t n = from; n < to; n++) {
+        uint32_t deviation = (uint32_t)abs((int32_t)s_output[n] - (int32_t)level);
+        if (deviation > worst) worst = deviation;
+    }
+    return worst;
+}
+
+int main(int argc, char **argv)
+{
+    uint8_t recorded = (argc > 1);
+    if (recorded) {
+        Load_Trace(argv[1]);
+    } else {
+        Build_Synthetic_Trace();
+    }
+    printf("%u samples, %u us per sample\n", (unsigned)s_length, (unsigned)ADC_HALF_BUFFER_US);
+    printf("%-11s %10s %10s %10s %10s %10s\n", "filter", "50% (ms)", "90% (ms)", "spike1", "spike2", "ns/sample");
+
+    for (uint8_t c = 0; c < sizeof(s_cases) / sizeof(s_cases[0]); c++) {
+        const Filter_Case_t *filter = &s_cases[c];
+        double ns = Replay(filter);
+        if (recorded) {
+            printf("%-11s %54.1f\n", filter->name, ns);
+            continue;
+        }
+
+        uint32_t ms = ADC_HALF_BUFFER_US / 1000U;
+        uint32_t half = Step_Latency(STEP_AT, 0.5);
+        uint32_t ninety = Step_Latency(STEP_AT, 0.9);
+        // Độ lệch lớn nhất quanh gai so với mức trước gai (đã gồm nhiễu)
+        uint32_t spike1 = Max_Deviation(SPIKE1_AT, SPIKE1_AT + 20U, TRACE_STEP);
+        uint32_t spike2 = Max_Deviation(SPIKE2_AT, SPIKE2_AT + 20U, TRACE_STEP);
+        uint32_t noise = Max_Deviation(STEP_AT + 100U, SPIKE1_AT, TRACE_STEP);
+        printf("%-11s %10u %10u %10u %10u %10.1f\n", filter->name, (unsigned)(half * ms),
+               (unsigned)(ninety * ms), (unsigned)spike1, (unsigned)spike2, ns);
+
+        // Trễ đúng như thiết kế: trung bình N mẫu đạt bước sau tối đa N-1 mẫu, IIR 90% sau ~2,3 / alpha
+        switch (filter->type) {
+        case ANALOG_FILTER_NONE:
+            TEST_ASSERT_EQ(ninety, 0);
+            break;
+        case ANALOG_FILTER_MOVING_AVERAGE:
+            TEST_ASSERT(ninety < filter->param);
+            TEST_ASSERT(noise <= TRACE_NOISE);
+            break;
+        case ANALOG_FILTER_IIR:
+            TEST_ASSERT(ninety <= (uint32_t)(2.4 * (1U << filter->param)));
+            break;
+        case ANALOG_FILTER_MEDIAN:
+            // Trung vị N loại bỏ gai ngắn hơn (N+1)/2 mẫu, trễ bước (N-1)/2 mẫu
+            TEST_ASSERT(ninety <= (filter->param - 1U) / 2U);
+            TEST_ASSERT(spike1 <= 2U * TRACE_NOISE);
+            if (filter->param >= 5U) {
+                TEST_ASSERT(spike2 <= 2U * TRACE_NOISE);
+            }
+            break;
+        }
+    }
+    TEST_PASS();
+}
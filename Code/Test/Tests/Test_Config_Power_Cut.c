@@ -0,0 +1,150 @@
+/**
+ * @file Test_Config_Power_Cut.c
+ * @brief Mất điện trước từng thao tác flash của một lần lưu (ghi log, chép sang bank dự phòng, xóa
+ *        bank cũ): lần khởi động sau mỗi thanh ghi mang giá trị cũ hoặc mới, không bao giờ hỏng,
+ *        và kho cấu hình vẫn ghi tiếp được
+ */
+#include <string.h>
+#include <unistd.h>
+
+#include "Test.h"
+#include "Sim.h"
+#include "Fake_Hal.h"
+#include "ModbusMap.h"
+#include "Config_Store.h"
+#include "Safety_Monitor.h"
+
+#define SESSION_POWER_CUT   2
+#define CURVE_REGS          REG_ANALOG_CURVE_STRIDE
+#define GAIN_OLD            1500U
+#define GAIN_NEW            2500U
+#define GAIN_RECOVERED      3500U
+#define DEBOUNCE_OLD        20U
+#define CURVE_OLD(i)        (uint16_t)(1000U + (i))
+#define CURVE_NEW(i)        (uint16_t)(2000U + (i))
+#define SAVE_MS             (CONFIG_STORE_COALESCE_MS + 3U * CONFIG_STORE_SERVICE_MS)
+
+static uint8_t s_baseline[CONFIG_STORE_BANK_COUNT * CONFIG_STORE_BANK_SIZE];
+static uint32_t s_cut_at;
+
+// Mất điện: tiến trình của lần khởi động này dừng ngay, flash giữ nguyên như lúc cắt
+static void Power_Cut(void)
+{
+    _exit(SESSION_POWER_CUT);
+}
+
+static void Write_Curve(uint8_t channel, uint8_t updated)
+{
+    uint16_t values[CURVE_REGS];
+    for (uint16_t i = 0; i < CURVE_REGS; i++) {
+        values[i] = updated ? CURVE_NEW(i) : CURVE_OLD(i);
+    }
+    TEST_ASSERT_EQ(Sim_Modbus_Write_Registers(REG_ANALOG_CURVE(channel), CURVE_REGS, values), 0);
+}
+
+static void Erase_Spare(void)
+{
+    TEST_ASSERT_EQ(Sim_Modbus_Write_Register(REG_CONFIG_ERASE_COMMAND, 1), 0);
+    Sim_Run_Ms(4U * CONFIG_STORE_SERVICE_MS);
+}
+
+// Bank 1 gần đầy: bản chép đầu tiên (mọi thanh ghi được lưu) rồi 4 đường cong ghi dạng log
+static void Baseline_Session(void)
+{
+    Sim_Run_Ms(50);
+    TEST_ASSERT_EQ(Sim_Modbus_Write_Register(REG_ANALOG_1_GAIN, GAIN_OLD), 0);
+    TEST_ASSERT_EQ(Sim_Modbus_Write_Register(REG_DI_DEBOUNCE_TIME, DEBOUNCE_OLD), 0);
+    Sim_Run_Ms(SAVE_MS);
+    for (uint8_t ch = 0; ch < 4; ch++) {
+        Write_Curve(ch, 0);
+    }
+    Sim_Run_Ms(SAVE_MS);
+}
+
+// Lưu cập nhật: vài bản ghi log, bank đầy nên chép sang bank kia, rồi lệnh xóa bank cũ
+static void Update_Session(void)
+{
+    Sim_Run_Ms(50);
+    Fake_Flash_Set_Power_Cut(s_cut_at, Power_Cut);
+    Write_Curve(0, 1);
+    TEST_ASSERT_EQ(Sim_Modbus_Write_Register(REG_ANALOG_1_GAIN, GAIN_NEW), 0);
+    Sim_Run_Ms(SAVE_MS);
+    Erase_Spare();
+
+    Fake_Flash_Stats_t stats;
+    Fake_Flash_Stats(&stats);
+    TEST_ASSERT(stats.erases > 0);
+}
+
+// Khởi động sau mất điện: giá trị cũ hoặc mới, thanh ghi không liên quan giữ nguyên; rồi ghi tiếp
+static void Check_Session(void)
+{
+    Sim_Run_Ms(50);
+    uint16_t gain, debounce;
+    uint16_t curve[4][CURVE_REGS];
+    TEST_ASSERT_EQ(Sim_Modbus_Read(3, REG_ANALOG_1_GAIN, 1, &gain), 0);
+    TEST_ASSERT_EQ(Sim_Modbus_Read(3, REG_DI_DEBOUNCE_TIME, 1, &debounce), 0);
+    for (uint8_t ch = 0; ch < 4; ch++) {
+        TEST_ASSERT_EQ(Sim_Modbus_Read(3, REG_ANALOG_CURVE(ch), CURVE_REGS, curve[ch]), 0);
+    }
+    TEST_ASSERT(gain == GAIN_OLD || gain == GAIN_NEW);
+    TEST_ASSERT_EQ(debounce, DEBOUNCE_OLD);
+    for (uint16_t i = 0; i < CURVE_REGS; i++) {
+        TEST_ASSERT(curve[0][i] == CURVE_OLD(i) || curve[0][i] == CURVE_NEW(i));
+        for (uint8_t ch = 1; ch < 4; ch++) {
+            TEST_ASSERT_EQ(curve[ch][i], CURVE_OLD(i));
+        }
+    }
+
+    // Bank dở dang (chép hoặc xóa bị cắt) được dọn khi có lệnh xóa, lần lưu sau vẫn thành công
+    TEST_ASSERT_EQ(Sim_Modbus_Write_Register(REG_ANALOG_1_GAIN, GAIN_RECOVERED), 0);
+    Erase_Spare();
+    Sim_Run_Ms(SAVE_MS);
+    Erase_Spare();
+}
+
+static void Recovered_Session(void)
+{
+    Sim_Run_Ms(50);
+    uint16_t gain;
+    TEST_ASSERT_EQ(Sim_Modbus_Read(3, REG_ANALOG_1_GAIN, 1, &gain), 0);
+    TEST_ASSERT_EQ(gain, GAIN_RECOVERED);
+}
+
+static void Check_Updated_Session(void)
+{
+    Sim_Run_Ms(50);
+    uint16_t gain;
+    uint16_t curve[CURVE_REGS];
+    TEST_ASSERT_EQ(Sim_Modbus_Read(3, REG_ANALOG_1_GAIN, 1, &gain), 0);
+    TEST_ASSERT_EQ(Sim_Modbus_Read(3, REG_ANALOG_CURVE(0), CURVE_REGS, curve), 0);
+    TEST_ASSERT_EQ(gain, GAIN_NEW);
+    for (uint16_t i = 0; i < CURVE_REGS; i++) {
+        TEST_ASSERT_EQ(curve[i], CURVE_NEW(i));
+    }
+}
+
+int main(void)
+{
+    TEST_ASSERT_EQ(Sim_Run_Previous_Boot(Baseline_Session), 0);
+    memcpy(s_baseline, (const void *)CONFIG_STORE_BASE, sizeof(s_baseline));
+
+    uint32_t cuts = 0;
+    for (s_cut_at = 0;; s_cut_at++) {
+        memcpy((void *)CONFIG_STORE_BASE, s_baseline, sizeof(s_baseline));
+        int result = Sim_Run_Previous_Boot(Update_Session);
+        if (result == 0) {
+            // Không còn thao tác flash nào để cắt: lần lưu chạy hết
+            TEST_ASSERT_EQ(Sim_Run_Previous_Boot(Check_Updated_Session), 0);
+            break;
+        }
+        TEST_ASSERT_EQ(result, SESSION_POWER_CUT);
+        TEST_ASSERT_EQ(Sim_Run_Previous_Boot(Check_Session), 0);
+        TEST_ASSERT_EQ(Sim_Run_Previous_Boot(Recovered_Session), 0);
+        cuts++;
+    }
+    printf("power cut before each of %u flash operations: every boot restored old or new values\n",
+           (unsigned)s_cut_at);
+    TEST_ASSERT(cuts > 3U * CURVE_REGS);
+    TEST_PASS();
+}
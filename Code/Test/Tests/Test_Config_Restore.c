@@ -0,0 +1,56 @@
+/**
+ * @file Test_Config_Restore.c
+ * @brief Cấu hình đã lưu flash có hiệu lực ngay từ Safety_Monitor_Init (trước vòng safety đầu tiên),
+ *        không phải DEFAULT_*
+ */
+#include "Test.h"
+#include "Sim.h"
+#include "Fake_Hal.h"
+#include "ModbusMap.h"
+#include "Config_Store.h"
+#include "Safety_Monitor.h"
+
+#define CODE_CLEAR          496U    // ~80 cm với gain mặc định
+#define RESTORED_GAIN       (2U * DEFAULT_ANALOG_COEFFICIENT)
+#define RESTORED_DEBOUNCE   20U
+
+// Lần khởi động trước: master cấu hình rồi chờ ghi flash xong
+static void Configure_Session(void)
+{
+    Sim_Run_Ms(50);
+    TEST_ASSERT_EQ(Sim_Modbus_Write_Register(REG_ANALOG_1_GAIN, RESTORED_GAIN), 0);
+    TEST_ASSERT_EQ(Sim_Modbus_Write_Register(REG_ANALOG_1_ENABLE, 1), 0);
+    TEST_ASSERT_EQ(Sim_Modbus_Write_Register(REG_DI2_ENABLE, 1), 0);
+    TEST_ASSERT_EQ(Sim_Modbus_Write_Register(REG_DI_DEBOUNCE_TIME, RESTORED_DEBOUNCE), 0);
+    Sim_Run_Ms(CONFIG_STORE_COALESCE_MS + 3U * CONFIG_STORE_SERVICE_MS);
+
+    Fake_Flash_Stats_t stats;
+    Fake_Flash_Stats(&stats);
+    TEST_ASSERT(stats.programs > 0);
+}
+
+int main(void)
+{
+    TEST_ASSERT_EQ(Sim_Run_Previous_Boot(Configure_Session), 0);
+
+    for (uint8_t ch = 0; ch < 4; ch++) {
+        Sim_Set_Analog_Code(ch, CODE_CLEAR);
+    }
+    Sim_Boot();
+
+    // Firmware đã tới osKernelStart, chưa task nào chạy: chỉ Safety_Monitor_Init đã áp dụng cấu hình
+    TEST_ASSERT_EQ(g_analog_sensors[0].sensor_active, 1);
+    TEST_ASSERT_EQ(g_analog_sensors[1].sensor_active, DEFAULT_ANALOG_2_ENABLE);
+    TEST_ASSERT_EQ(g_digital_sensors[1].sensor_active, 1);
+    TEST_ASSERT_EQ(g_digital_sensors[0].sensor_active, DEFAULT_DI1_ENABLE);
+    TEST_ASSERT_EQ(g_digital_sensors[1].debounce_time_ms, RESTORED_DEBOUNCE);
+
+    // Bảng tra AI1 theo gain đã lưu: khoảng cách gấp đôi so với gain mặc định
+    Sim_Run_Ms(20);
+    uint16_t value = 0;
+    TEST_ASSERT_EQ(Sim_Modbus_Read(3, REG_ANALOG_1_GAIN, 1, &value), 0);
+    TEST_ASSERT_EQ(value, RESTORED_GAIN);
+    TEST_ASSERT_EQ(Sim_Modbus_Read(3, REG_SNAPSHOT_ANALOG_1, 1, &value), 0);
+    TEST_ASSERT(value >= 150 && value <= 170);
+    TEST_PASS();
+}
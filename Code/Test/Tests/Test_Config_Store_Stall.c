@@ -0,0 +1,104 @@
+/**
+ * @file Test_Config_Store_Stall.c
+ * @brief CPU dừng vì flash cấu hình: khi đầu ra chưa cắt chỉ có ghi halfword, xóa trang chỉ
+ *        khi RELAY1 đã cắt hoặc có lệnh REG_CONFIG_ERASE_COMMAND
+ */
+#include "Test.h"
+#include "Sim.h"
+#include "Fake_Hal.h"
+#include "ModbusMap.h"
+#include "Config_Store.h"
+
+#define CURVE_REGS      (REG_ANALOG_CURVE_LAST - REG_ANALOG_CURVE_BASE + 1)
+
+static uint16_t s_batch;
+
+/* Ghi lại cả khối đường cong (4 x 33 thanh ghi) bằng giá trị mới -> 132 bản ghi flash */
+static void Write_Curve_Batch(void)
+{
+    uint16_t values[CURVE_REGS];
+    s_batch++;
+    for (uint16_t i = 0; i < CURVE_REGS; i++) {
+        values[i] = (uint16_t)(s_batch * 1000U + i);
+    }
+    for (uint16_t offset = 0; offset < CURVE_REGS; offset += 66U) {
+        uint16_t qty = (CURVE_REGS - offset < 66U) ? (uint16_t)(CURVE_REGS - offset) : 66U;
+        TEST_ASSERT_EQ(Sim_Modbus_Write_Registers(REG_ANALOG_CURVE_BASE + offset, qty, &values[offset]), 0);
+    }
+    Sim_Run_Ms(CONFIG_STORE_COALESCE_MS + 3U * CONFIG_STORE_SERVICE_MS);
+}
+
+static uint16_t Read_Register(uint16_t address)
+{
+    uint16_t value = 0;
+    TEST_ASSERT_EQ(Sim_Modbus_Read(3, address, 1, &value), 0);
+    return value;
+}
+
+int main(void)
+{
+    Fake_Flash_Stats_t stats;
+
+    Sim_Boot();
+    Sim_Run_Ms(50);
+    Fake_Reset_Max_Stall();
+
+    /* Lần đầu chép sang bank trắng, sau đó nối bản ghi đến khi bank đầy rồi chép sang bank kia:
+     * relay chưa cắt nên không có lần xóa nào, CPU dừng lâu nhất là một halfword */
+    for (uint8_t i = 0; i < 3; i++) {
+        Write_Curve_Batch();
+    }
+    Fake_Flash_Stats(&stats);
+    TEST_ASSERT_EQ(stats.erases, 0);
+    TEST_ASSERT(stats.programs > 0);
+    uint64_t running_stall = Fake_Max_Stall_Ns();
+    TEST_ASSERT(running_stall <= FAKE_FLASH_PROGRAM_NS);
+
+    /* Bank dự phòng chưa xóa: lần chép kế tiếp phải chờ, không xóa khi relay đang đóng */
+    Write_Curve_Batch();
+    Write_Curve_Batch();
+    Fake_Flash_Stats(&stats);
+    uint32_t programs_blocked = stats.programs;
+    Write_Curve_Batch();
+    Fake_Flash_Stats(&stats);
+    TEST_ASSERT_EQ(stats.erases, 0);
+    TEST_ASSERT_EQ(stats.programs, programs_blocked);
+    TEST_ASSERT(Fake_Max_Stall_Ns() <= FAKE_FLASH_PROGRAM_NS);
+
+    /* RELAY1 cắt (DI1): được xóa từng trang, sau đó các giá trị đang chờ được ghi */
+    TEST_ASSERT_EQ(Sim_Modbus_Write_Register(REG_DI1_ACTIVE_LEVEL, 1), 0);
+    TEST_ASSERT_EQ(Sim_Modbus_Write_Register(REG_DI1_ENABLE, 1), 0);
+    Sim_Set_Digital(0, 1);
+    Sim_Run_Ms(20);
+    TEST_ASSERT_EQ(Sim_Relay(1), 1);
+    Fake_Reset_Max_Stall();
+    Sim_Run_Ms(CONFIG_STORE_COALESCE_MS + 5U * CONFIG_STORE_SERVICE_MS);
+    Fake_Flash_Stats(&stats);
+    TEST_ASSERT(stats.erases >= CONFIG_STORE_BANK_PAGES);
+    TEST_ASSERT(stats.programs > programs_blocked);
+    uint64_t tripped_stall = Fake_Max_Stall_Ns();
+    TEST_ASSERT_EQ(tripped_stall, FAKE_FLASH_ERASE_NS);
+
+    /* Nhả relay, đổ đầy bank lần nữa rồi xóa bằng lệnh */
+    Sim_Set_Digital(0, 0);
+    Sim_Run_Ms(20);
+    TEST_ASSERT_EQ(Sim_Modbus_Write_Register(REG_RESET_FLAG, 0), 0);
+    Sim_Run_Ms(10);
+    TEST_ASSERT_EQ(Sim_Relay(1), 0);
+    Fake_Flash_Stats(&stats);
+    uint32_t erases = stats.erases;
+    Write_Curve_Batch();
+    Write_Curve_Batch();
+    Fake_Flash_Stats(&stats);
+    TEST_ASSERT_EQ(stats.erases, erases);
+    TEST_ASSERT_EQ(Sim_Modbus_Write_Register(REG_CONFIG_ERASE_COMMAND, 1), 0);
+    TEST_ASSERT_EQ(Read_Register(REG_CONFIG_ERASE_COMMAND), 1);
+    Sim_Run_Ms(5U * CONFIG_STORE_SERVICE_MS);
+    Fake_Flash_Stats(&stats);
+    TEST_ASSERT_EQ(stats.erases, erases + CONFIG_STORE_BANK_PAGES);
+    TEST_ASSERT_EQ(Read_Register(REG_CONFIG_ERASE_COMMAND), 0);
+
+    printf("worst flash stall: %.3f ms with outputs active, %.3f ms with RELAY1 tripped\n",
+           running_stall / 1e6, tripped_stall / 1e6);
+    TEST_PASS();
+}
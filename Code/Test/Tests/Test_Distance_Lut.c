@@ -0,0 +1,82 @@
+/**
+ * @file Test_Distance_Lut.c
+ * @brief Bảng tra khoảng cách so với powf mỗi mẫu: sai số trên toàn dải mã ADC và thời gian đổi
+ *        một mẫu (ns trên host - tỉ lệ, không phải số chu kỳ Cortex-M3)
+ */
+#include <math.h>
+#include <time.h>
+
+#include "Test.h"
+#include "ModbusMap.h"
+#include "Safety_Monitor.h"
+
+extern volatile uint16_t adc_buffer[4];
+
+#define BENCH_ROUNDS        200U
+
+static volatile float s_sink;
+
+// Đường cũ: powf mỗi mẫu, như Safety_Convert_To_Distance trước khi có bảng tra
+static float Distance_Powf(uint16_t code, float k, float p)
+{
+    float voltage = (float)code * ADC_VREF / (float)ADC_CODE_MAX;
+    return (voltage < DISTANCE_MIN_VOLTAGE) ? 0.0f : k * powf(voltage, p);
+}
+
+static double Now_Ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+int main(void)
+{
+    const float k = DEFAULT_ANALOG_COEFFICIENT / 100.0f;
+    const float p = DEFAULT_ANALOG_CALIBRATION / -100.0f;
+    TEST_ASSERT_EQ(Safety_Build_Distance_Table(0, DEFAULT_ANALOG_COEFFICIENT, DEFAULT_ANALOG_CALIBRATION, 0), HAL_OK);
+
+    // Sai số: lớn nhất trong dải hợp lệ (vùng so ngưỡng) và trên toàn dải
+    double max_error_valid = 0.0;
+    double max_error_all = 0.0;
+    for (uint32_t code = 0; code <= ADC_CODE_MAX; code++) {
+        float reference = Distance_Powf((uint16_t)code, k, p);
+        adc_buffer[0] = (uint16_t)code;
+        float lut = SAFETY_VALUE_TO_FLOAT(Safety_Convert_To_Distance(0));
+        double error = fabs((double)lut - reference);
+        if (reference >= DISTANCE_VALID_MIN && reference <= DISTANCE_VALID_MAX && error > max_error_valid) {
+            max_error_valid = error;
+        }
+        if (reference < DISTANCE_LUT_MAX && error > max_error_all) {
+            max_error_all = error;
+        }
+    }
+    // Nửa đơn vị khoảng cách: phân vùng dùng phần nguyên nên sai số nhỏ hơn thế không đổi kết quả
+    // trừ sát ngưỡng
+    TEST_ASSERT(max_error_valid < 0.5);
+
+    // Thời gian: cùng dãy mã cho hai đường
+    double start = Now_Ns();
+    for (uint32_t round = 0; round < BENCH_ROUNDS; round++) {
+        for (uint32_t code = 0; code <= ADC_CODE_MAX; code += 7U) {
+            s_sink = Distance_Powf((uint16_t)code, k, p);
+        }
+    }
+    double powf_ns = Now_Ns() - start;
+
+    start = Now_Ns();
+    for (uint32_t round = 0; round < BENCH_ROUNDS; round++) {
+        for (uint32_t code = 0; code <= ADC_CODE_MAX; code += 7U) {
+            adc_buffer[0] = (uint16_t)code;
+            s_sink = SAFETY_VALUE_TO_FLOAT(Safety_Convert_To_Distance(0));
+        }
+    }
+    double lut_ns = Now_Ns() - start;
+    double samples = (double)BENCH_ROUNDS * (ADC_CODE_MAX / 7U + 1U);
+
+    printf("distance LUT (%u entries) vs powf: max error %.4f cm in %d-%d cm, %.4f cm over the table range\n",
+           (unsigned)DISTANCE_LUT_SIZE, max_error_valid, DISTANCE_VALID_MIN, DISTANCE_VALID_MAX, max_error_all);
+    printf("host time per sample: powf %.1f ns, LUT %.1f ns (x%.1f)\n",
+           powf_ns / samples, lut_ns / samples, powf_ns / lut_ns);
+    TEST_PASS();
+}
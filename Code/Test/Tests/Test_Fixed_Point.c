@@ -0,0 +1,107 @@
+/**
+ * @file Test_Fixed_Point.c
+ * @brief Pipeline analog Q16.16 và float cho cùng khoảng cách trong sai số nêu ở Safety_Monitor.h:
+ *        so với cùng bảng tra nội suy bằng double, và cùng phần nguyên (kết quả phân vùng)
+ * @note Chạy với thư viện firmware (Q16.16) và firmware_float (SAFETY_USE_FIXED_POINT=0)
+ */
+#include <math.h>
+#include <time.h>
+
+#include "Test.h"
+#include "ModbusMap.h"
+#include "Safety_Monitor.h"
+
+extern volatile uint16_t adc_buffer[4];
+
+// Cắt khi nạp bảng (1/65536) + phần dư bị cắt khi nội suy (1/65536); trên 256 cm phép nhân
+// float x 65536 của SAFETY_VALUE_FROM_FLOAT còn làm tròn tương đối 2^-24 mỗi mục
+#define FIXED_TOLERANCE     (2.0 / 65536.0)
+#define FIXED_RELATIVE      (2.0 / 16777216.0)
+// float: sai số tương đối của phép nội suy một lần nhân-cộng
+#define FLOAT_TOLERANCE     1e-6
+
+typedef struct {
+    uint16_t gain;
+    uint16_t exponent;
+    int16_t offset;
+} Lut_Params_t;
+
+static const Lut_Params_t s_cases[] = {
+    { DEFAULT_ANALOG_COEFFICIENT, DEFAULT_ANALOG_CALIBRATION, 0 },
+    { 1500, 100, -250 },
+    { 6000, 140, 175 },
+};
+
+static volatile Safety_Value_t s_sink;
+
+// Cùng bảng như Safety_Build_Distance_Table (mục tính bằng float), nội suy bằng double
+static double Reference_Distance(const Lut_Params_t *params, uint16_t code)
+{
+    float k = params->gain / 100.0f;
+    float p = params->exponent / -100.0f;
+    float shift = params->offset / 100.0f;
+    double y[2];
+    uint16_t index = code >> DISTANCE_LUT_SHIFT;
+    for (uint8_t j = 0; j < 2; j++) {
+        float voltage = (float)((index + j) << DISTANCE_LUT_SHIFT) * ADC_VREF / (float)ADC_CODE_MAX;
+        float entry = (voltage > 0.0f) ? k * powf(voltage, p) : DISTANCE_LUT_MAX;
+        if (entry > DISTANCE_LUT_MAX) entry = DISTANCE_LUT_MAX;
+        y[j] = (double)(entry + shift);
+    }
+    double frac = (double)(code & ((1U << DISTANCE_LUT_SHIFT) - 1U)) / (double)(1U << DISTANCE_LUT_SHIFT);
+    return y[0] + (y[1] - y[0]) * frac;
+}
+
+int main(void)
+{
+    double max_error = 0.0;
+    uint32_t checked = 0;
+
+    for (uint8_t c = 0; c < sizeof(s_cases) / sizeof(s_cases[0]); c++) {
+        const Lut_Params_t *params = &s_cases[c];
+        TEST_ASSERT_EQ(Safety_Build_Distance_Table(0, params->gain, params->exponent, params->offset), HAL_OK);
+        uint16_t min_code = (uint16_t)ceilf(DISTANCE_MIN_VOLTAGE * (float)ADC_CODE_MAX / ADC_VREF);
+
+        for (uint32_t code = min_code; code <= ADC_CODE_MAX; code++) {
+            double reference = Reference_Distance(params, (uint16_t)code);
+            if (reference > 1000.0) continue;   // Đầu điện áp thấp: ngoài mọi ngưỡng (tối đa LIMIT_SAFETY_THRESHOLD_MAX)
+
+            adc_buffer[0] = (uint16_t)code;
+            Safety_Value_t value = Safety_Convert_To_Distance(0);
+            double distance = SAFETY_VALUE_TO_FLOAT(value);
+            double error = fabs(distance - reference);
+#if SAFETY_USE_FIXED_POINT
+            double tolerance = FIXED_TOLERANCE + FIXED_RELATIVE * fabs(reference);
+#else
+            double tolerance = FLOAT_TOLERANCE * fabs(reference) + 1e-6;
+#endif
+            if (error > tolerance) {
+                fprintf(stderr, "code %u: %.7f vs %.7f\n", (unsigned)code, distance, reference);
+            }
+            TEST_ASSERT(error <= tolerance);
+            if (error > max_error) max_error = error;
+
+            // Phân vùng so phần nguyên: giống nhau trừ khi tham chiếu nằm sát một số nguyên
+            double floor_ref = floor(reference);
+            if (reference - floor_ref > tolerance && floor_ref + 1.0 - reference > tolerance) {
+                TEST_ASSERT_EQ(SAFETY_VALUE_TO_INT(value), (int32_t)floor_ref);
+            }
+            checked++;
+        }
+    }
+
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (uint32_t round = 0; round < 100U; round++) {
+        for (uint32_t code = 0; code <= ADC_CODE_MAX; code += 3U) {
+            adc_buffer[0] = (uint16_t)code;
+            s_sink = Safety_Convert_To_Distance(0);
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    double ns = ((t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec)) / (100.0 * (ADC_CODE_MAX / 3U + 1U));
+
+    printf("%s: %u codes, max deviation %.2e cm from the double reference, %.1f ns per conversion on host\n",
+           SAFETY_USE_FIXED_POINT ? "Q16.16" : "float", (unsigned)checked, max_error, ns);
+    TEST_PASS();
+}
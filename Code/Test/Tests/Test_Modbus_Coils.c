@@ -0,0 +1,102 @@
+/**
+ * @file Test_Modbus_Coils.c
+ * @brief Coil 1 điều khiển RELAY2 qua Output_Control, coil 0 không chạm RELAY1 (thuộc safety logic);
+ *        số lượng sai hoặc khung FC1-FC6 không đủ 8 byte trả exception 3, địa chỉ ngoài vùng trả exception 2
+ */
+#include "Test.h"
+#include "Sim.h"
+#include "ModbusMap.h"
+#include "UartModbus.h"
+
+// Gửi PDU thô, trả mã exception (0 nếu phản hồi bình thường)
+static int Raw_Exception(const uint8_t *pdu, uint16_t length)
+{
+    uint8_t response[260];
+    int received = Sim_Modbus_Transact(pdu, length, response, sizeof(response));
+    TEST_ASSERT(received > 0);
+    return (response[1] & 0x80U) ? response[2] : 0;
+}
+
+int main(void)
+{
+    Sim_Boot();
+    Sim_Run_Ms(50);
+    TEST_ASSERT_EQ(Sim_Relay(1), 0);
+    TEST_ASSERT_EQ(Sim_Relay(2), 0);
+
+    // Coil 1 = Relay2_Control: đóng/nhả RELAY2 ở chu kỳ safety kế tiếp
+    TEST_ASSERT_EQ(Sim_Modbus_Write_Coil(1, 1), 0);
+    Sim_Run_Ms(5);
+    TEST_ASSERT_EQ(Sim_Relay(2), 1);
+    TEST_ASSERT_EQ(Sim_Modbus_Write_Register(REG_RELAY2_CONTROL, 0), 0);
+    Sim_Run_Ms(5);
+    TEST_ASSERT_EQ(Sim_Relay(2), 0);
+
+    // FC15 cả 4 coil: chỉ RELAY2 ra chân, coil 0 không cắt RELAY1, coil 2-3 chỉ lưu lệnh
+    uint8_t fc15[] = { 15, 0x00, 0x00, 0x00, 0x04, 0x01, 0x0F };
+    TEST_ASSERT_EQ(Raw_Exception(fc15, sizeof(fc15)), 0);
+    Sim_Run_Ms(5);
+    TEST_ASSERT_EQ(Sim_Relay(1), 0);
+    TEST_ASSERT_EQ(Sim_Relay(2), 1);
+    uint8_t bits[4];
+    TEST_ASSERT_EQ(Sim_Modbus_Read_Bits(1, 0, 4, bits), 0);
+    for (uint8_t i = 0; i < 4; i++) {
+        TEST_ASSERT_EQ(bits[i], 1);
+    }
+
+    // RELAY1 vẫn theo safety logic: cắt bởi DI1, nhả bởi Reset_Flag, Relay1_Control không đổi gì
+    TEST_ASSERT_EQ(Sim_Modbus_Write_Register(REG_DI1_ACTIVE_LEVEL, 1), 0);
+    TEST_ASSERT_EQ(Sim_Modbus_Write_Register(REG_DI1_ENABLE, 1), 0);
+    Sim_Set_Digital(0, 1);
+    Sim_Run_Ms(DEFAULT_DI_DEBOUNCE_TIME + 5);
+    TEST_ASSERT_EQ(Sim_Relay(1), 1);
+    Sim_Set_Digital(0, 0);
+    Sim_Run_Ms(DEFAULT_DI_DEBOUNCE_TIME + 5);
+    TEST_ASSERT_EQ(Sim_Modbus_Write_Coil(0, 0), 0);
+    Sim_Run_Ms(5);
+    TEST_ASSERT_EQ(Sim_Relay(1), 1);
+    TEST_ASSERT_EQ(Sim_Modbus_Write_Register(REG_RESET_FLAG, 0), 0);
+    Sim_Run_Ms(5);
+    TEST_ASSERT_EQ(Sim_Relay(1), 0);
+    TEST_ASSERT_EQ(Sim_Relay(2), 1);
+
+    // Số lượng 0 hoặc vượt giới hạn: exception 3
+    uint16_t value;
+    TEST_ASSERT_EQ(Sim_Modbus_Read_Bits(1, 0, 0, bits), 3);
+    TEST_ASSERT_EQ(Sim_Modbus_Read_Bits(2, 0, MODBUS_MAX_READ_BITS + 1, bits), 3);
+    TEST_ASSERT_EQ(Sim_Modbus_Read(3, REG_DEVICE_ID, 0, &value), 3);
+    TEST_ASSERT_EQ(Sim_Modbus_Read(3, REG_DEVICE_ID, MODBUS_MAX_READ_REGS + 1, &value), 3);
+    TEST_ASSERT_EQ(Sim_Modbus_Read(4, 0, 0, &value), 3);
+    TEST_ASSERT_EQ(Sim_Modbus_Read(4, 0, MODBUS_MAX_READ_REGS + 1, &value), 3);
+    uint8_t fc15_zero[] = { 15, 0x00, 0x00, 0x00, 0x00, 0x00 };
+    TEST_ASSERT_EQ(Raw_Exception(fc15_zero, sizeof(fc15_zero)), 3);
+    uint8_t fc15_bytes[] = { 15, 0x00, 0x00, 0x00, 0x02, 0x02, 0x03, 0x00 };
+    TEST_ASSERT_EQ(Raw_Exception(fc15_bytes, sizeof(fc15_bytes)), 3);
+    uint8_t fc16_zero[] = { 16, 0x01, 0x00, 0x00, 0x00, 0x00 };
+    TEST_ASSERT_EQ(Raw_Exception(fc16_zero, sizeof(fc16_zero)), 3);
+    uint8_t fc23_zero[] = { 23, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x01, 0x02, 0x00, 0x05 };
+    TEST_ASSERT_EQ(Raw_Exception(fc23_zero, sizeof(fc23_zero)), 3);
+
+    // FC1-FC6 dài đúng 8 byte: khung 6, 7 hoặc 9 byte (CRC vẫn đúng) trả exception 3, không ghi gì
+    uint8_t fixed[] = { 0, 0x00, 0x01, 0x00, 0x01, 0x00 };
+    for (uint8_t fc = 1; fc <= 6; fc++) {
+        fixed[0] = fc;
+        TEST_ASSERT_EQ(Raw_Exception(fixed, 3), 3);
+        TEST_ASSERT_EQ(Raw_Exception(fixed, 4), 3);
+        TEST_ASSERT_EQ(Raw_Exception(fixed, 6), 3);
+    }
+    uint8_t fc6_short[] = { 6, REG_RELAY2_CONTROL >> 8, REG_RELAY2_CONTROL & 0xFF, 0x00 };
+    TEST_ASSERT_EQ(Raw_Exception(fc6_short, sizeof(fc6_short)), 3);
+    Sim_Run_Ms(5);
+    TEST_ASSERT_EQ(Sim_Relay(2), 1);
+
+    // Số lượng hợp lệ nhưng địa chỉ ngoài vùng: exception 2
+    TEST_ASSERT_EQ(Sim_Modbus_Read_Bits(1, 2, 3, bits), 2);
+    TEST_ASSERT_EQ(Sim_Modbus_Read(4, INPUT_REG_COUNT - 1, 2, &value), 2);
+    TEST_ASSERT_EQ(Sim_Modbus_Read(3, 0x0F00, 1, &value), 2);
+    uint8_t fc15_range[] = { 15, 0x00, 0x03, 0x00, 0x02, 0x01, 0x03 };
+    TEST_ASSERT_EQ(Raw_Exception(fc15_range, sizeof(fc15_range)), 2);
+    uint8_t fc23_range[] = { 23, 0x0F, 0x00, 0x00, 0x01, 0x01, 0x00, 0x00, 0x01, 0x02, 0x00, 0x05 };
+    TEST_ASSERT_EQ(Raw_Exception(fc23_range, sizeof(fc23_range)), 2);
+    TEST_PASS();
+}
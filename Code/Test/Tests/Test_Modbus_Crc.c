@@ -0,0 +1,91 @@
+/**
+ * @file Test_Modbus_Crc.c
+ * @brief Vector kiểm tra CRC-16/MODBUS, CRC tăng dần theo từng đoạn DMA và thời gian mỗi byte
+ *        so với vòng 8 lần dịch bit cũ
+ * @note Chạy với bảng 256 phần tử (firmware) và bảng nibble (firmware_crc_nibble)
+ */
+#include <string.h>
+#include <time.h>
+
+#include "Test.h"
+#include "UartModbus.h"
+
+#define BENCH_BYTES     256U
+#define BENCH_ROUNDS    20000U
+
+static volatile uint16_t s_sink;
+
+// calcCRC trước khi có bảng: 8 lần dịch mỗi byte
+static uint16_t Crc_Bitwise(const uint8_t *buf, int len)
+{
+    uint16_t crc = 0xFFFF;
+    for (int pos = 0; pos < len; pos++) {
+        crc ^= buf[pos];
+        for (int i = 8; i != 0; i--) {
+            crc = (crc & 0x0001) ? (uint16_t)((crc >> 1) ^ 0xA001) : (uint16_t)(crc >> 1);
+        }
+    }
+    return crc;
+}
+
+static double Now_Ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+int main(void)
+{
+    // Giá trị kiểm tra chuẩn của CRC-16/MODBUS
+    uint8_t check[] = "123456789";
+    TEST_ASSERT_EQ(calcCRC(check, 9), 0x4B37);
+    TEST_ASSERT_EQ(calcCRC(check, 0), MODBUS_CRC_INIT);
+
+    // Khung FC3 mẫu trong đặc tả Modbus: CRC gửi byte thấp trước (C5 CD)
+    uint8_t request[8] = { 0x01, 0x03, 0x00, 0x00, 0x00, 0x0A };
+    uint16_t crc = calcCRC(request, 6);
+    TEST_ASSERT_EQ(crc, 0xCDC5);
+    request[6] = (uint8_t)crc;
+    request[7] = (uint8_t)(crc >> 8);
+    // Qua cả hai byte CRC thì bằng 0 - ISR nhận dùng điều này để kiểm tra khung
+    TEST_ASSERT_EQ(calcCRC(request, 8), 0);
+
+    // Dữ liệu giả ngẫu nhiên: bằng cách cũ, và tăng dần theo các đoạn bất kỳ như vòng DMA
+    uint8_t data[BENCH_BYTES];
+    uint32_t seed = 0x12345678U;
+    for (uint32_t i = 0; i < sizeof(data); i++) {
+        seed = seed * 1103515245U + 12345U;
+        data[i] = (uint8_t)(seed >> 16);
+    }
+    for (int len = 0; len <= (int)sizeof(data); len++) {
+        TEST_ASSERT_EQ(calcCRC(data, len), Crc_Bitwise(data, len));
+    }
+    for (uint32_t chunk = 1; chunk <= 64U; chunk++) {
+        uint16_t incremental = MODBUS_CRC_INIT;
+        for (uint32_t pos = 0; pos < sizeof(data); pos += chunk) {
+            uint32_t n = (sizeof(data) - pos < chunk) ? sizeof(data) - pos : chunk;
+            incremental = updateCRC(incremental, &data[pos], (int)n);
+        }
+        TEST_ASSERT_EQ(incremental, Crc_Bitwise(data, sizeof(data)));
+    }
+
+    double start = Now_Ns();
+    for (uint32_t round = 0; round < BENCH_ROUNDS; round++) {
+        data[0] = (uint8_t)round;
+        s_sink = Crc_Bitwise(data, sizeof(data));
+    }
+    double bitwise_ns = (Now_Ns() - start) / ((double)BENCH_ROUNDS * sizeof(data));
+
+    start = Now_Ns();
+    for (uint32_t round = 0; round < BENCH_ROUNDS; round++) {
+        data[0] = (uint8_t)round;
+        s_sink = calcCRC(data, sizeof(data));
+    }
+    double table_ns = (Now_Ns() - start) / ((double)BENCH_ROUNDS * sizeof(data));
+
+    printf("CRC-16/MODBUS %s: %.2f ns/byte vs bitwise %.2f ns/byte (x%.1f) on host\n",
+           MODBUS_CRC_FULL_TABLE ? "256-entry table" : "nibble table", table_ns, bitwise_ns,
+           bitwise_ns / table_ns);
+    TEST_PASS();
+}
@@ -0,0 +1,85 @@
+/**
+ * @file Test_Modbus_Latency.c
+ * @brief Thời gian từ byte cuối của yêu cầu đến lúc bắt đầu phát phản hồi: modbusTask được đánh
+ *        thức bởi IDLE line nên chỉ chờ một ký tự im lặng, không phụ thuộc pha so với tick
+ *        (trước đây poll mỗi 100 ms)
+ */
+#include "Test.h"
+#include "Sim.h"
+#include "ModbusMap.h"
+#include "UartModbus.h"
+
+#define PHASES          25U
+#define BURST_FRAMES    3U
+
+static uint64_t Char_Ns(uint32_t baud)
+{
+    return (10ULL * 1000000000ULL + baud - 1U) / baud;
+}
+
+// Khung FC3 đọc 10 thanh ghi từ REG_DEVICE_ID (kèm CRC)
+static void Build_Read(uint8_t *frame)
+{
+    uint8_t pdu[] = { MODBUS_SLAVE_ADDRESS, 3, REG_DEVICE_ID >> 8, REG_DEVICE_ID & 0xFF, 0x00, 0x0A };
+    for (uint8_t i = 0; i < sizeof(pdu); i++) frame[i] = pdu[i];
+    uint16_t crc = Sim_Modbus_CRC(frame, 6);
+    frame[6] = (uint8_t)crc;
+    frame[7] = (uint8_t)(crc >> 8);
+}
+
+static void Measure(uint32_t baud)
+{
+    uint8_t frame[8];
+    uint8_t response[64];
+    uint64_t worst = 0;
+    uint64_t char_ns = Char_Ns(baud);
+    Build_Read(frame);
+
+    // Yêu cầu đến ở nhiều pha khác nhau so với tick 1 ms và chu kỳ safety
+    for (uint32_t phase = 0; phase < PHASES; phase++) {
+        Sim_Run_Us(137U * phase + 50U);
+        uint64_t last_byte = Sim_Modbus_Send_Raw(frame, sizeof(frame));
+        TEST_ASSERT(Sim_Modbus_Receive(response, sizeof(response), SIM_MODBUS_TIMEOUT_MS) == 25);
+        uint64_t latency = Sim_Modbus_Last_Tx_Start_Ns() - last_byte;
+        if (latency > worst) worst = latency;
+    }
+    // Một ký tự im lặng (IDLE) + xử lý; không bao giờ chờ tick hay chu kỳ poll
+    TEST_ASSERT(worst <= 2U * char_ns);
+
+    // Dồn khung: phản hồi kế tiếp bắt đầu ngay khi phản hồi trước phát xong
+    uint64_t last_bytes[BURST_FRAMES];
+    for (uint32_t i = 0; i < BURST_FRAMES; i++) {
+        last_bytes[i] = Sim_Modbus_Send_Raw(frame, sizeof(frame));
+    }
+    uint64_t previous_end = 0;
+    uint64_t worst_burst = 0;
+    for (uint32_t i = 0; i < BURST_FRAMES; i++) {
+        TEST_ASSERT(Sim_Modbus_Receive(response, sizeof(response), SIM_MODBUS_TIMEOUT_MS) == 25);
+        uint64_t start = Sim_Modbus_Last_Tx_Start_Ns();
+        uint64_t ready = (last_bytes[i] > previous_end) ? last_bytes[i] : previous_end;
+        TEST_ASSERT(start >= ready);
+        if (start - ready > worst_burst) worst_burst = start - ready;
+        previous_end = start + 25U * char_ns;
+    }
+    TEST_ASSERT(worst_burst <= 2U * char_ns);
+
+    printf("%6u baud: request-to-response %.1f us worst over %u phases (1 char = %.1f us), "
+           "back-to-back %.1f us\n", (unsigned)baud, worst / 1e3, (unsigned)PHASES, char_ns / 1e3,
+           worst_burst / 1e3);
+}
+
+int main(void)
+{
+    Sim_Boot();
+    Sim_Run_Ms(50);
+
+    Measure(115200);
+
+    TEST_ASSERT_EQ(Sim_Modbus_Write_Register(REG_CONFIG_BAUDRATE, 1), 0);
+    Sim_Run_Ms(10);
+    uint16_t value = 0;
+    TEST_ASSERT_EQ(Sim_Modbus_Read(3, REG_CONFIG_BAUDRATE, 1, &value), 0);
+    TEST_ASSERT_EQ(value, 1);
+    Measure(9600);
+    TEST_PASS();
+}
@@ -0,0 +1,123 @@
+/**
+ * @file Test_Modbus_Rx_Queue.c
+ * @brief Hàng đợi khung nhận ISR -> modbusTask: master dồn khung khi phản hồi trước còn đang phát.
+ *        Tới MODBUS_RX_QUEUE_DEPTH khung đều được trả lời đúng thứ tự; vượt quá thì khung thừa bị
+ *        bỏ nguyên khung (không khung nào bị hỏng hay trả sai) và được đếm ở FC4 0x0083-0x0087.
+ *        Khung dở bị bỏ vì lỗi UART (FE) cũng được đếm
+ */
+#include <string.h>
+#include "Test.h"
+#include "Sim.h"
+#include "ModbusMap.h"
+#include "UartModbus.h"
+
+#define BURST_MAX       (3U * MODBUS_RX_QUEUE_DEPTH)
+#define QUANTITY_BASE   40U     // Phản hồi (~90 byte) dài hơn nhiều so với yêu cầu (8 byte) nên khung dồn lại
+
+typedef struct {
+    uint32_t dropped;
+    uint32_t overflows;
+    uint16_t peak;
+} Rx_Stats_t;
+
+static void Read_Stats(Rx_Stats_t *stats)
+{
+    uint16_t regs[INPUT_REG_RX_QUEUE_PEAK - INPUT_REG_RX_DROPPED + 1];
+    TEST_ASSERT_EQ(Sim_Modbus_Read(4, INPUT_REG_RX_DROPPED, sizeof(regs) / 2U, regs), 0);
+    stats->dropped = ((uint32_t)regs[0] << 16) | regs[1];
+    stats->overflows = ((uint32_t)regs[2] << 16) | regs[3];
+    stats->peak = regs[4];
+}
+
+// FC3 đọc quantity thanh ghi đường cong: độ dài phản hồi cho biết khung nào được trả lời
+static void Build_Read(uint8_t *frame, uint16_t quantity)
+{
+    const uint8_t pdu[6] = { MODBUS_SLAVE_ADDRESS, 3, REG_ANALOG_CURVE_BASE >> 8, REG_ANALOG_CURVE_BASE & 0xFF,
+                             (uint8_t)(quantity >> 8), (uint8_t)quantity };
+    memcpy(frame, pdu, sizeof(pdu));
+    uint16_t crc = Sim_Modbus_CRC(frame, 6);
+    frame[6] = (uint8_t)crc;
+    frame[7] = (uint8_t)(crc >> 8);
+}
+
+static void Send_Read(uint16_t quantity)
+{
+    uint8_t frame[8];
+    Build_Read(frame, quantity);
+    Sim_Modbus_Send_Raw(frame, sizeof(frame));
+}
+
+// Gửi dồn count khung (quantity QUANTITY_BASE + 1..count), trả số phản hồi; phản hồi phải đúng và theo thứ tự gửi
+static uint32_t Burst(uint32_t count)
+{
+    for (uint32_t i = 1; i <= count; i++) {
+        Send_Read((uint16_t)(QUANTITY_BASE + i));
+    }
+    uint8_t response[TX_BUFFER_SIZE];
+    uint32_t answered = 0;
+    uint16_t previous = 0;
+    int length;
+    while ((length = Sim_Modbus_Receive(response, sizeof(response), SIM_MODBUS_TIMEOUT_MS)) > 0) {
+        TEST_ASSERT_EQ(Sim_Modbus_CRC(response, (uint16_t)length), 0);
+        TEST_ASSERT_EQ(response[1], 3);
+        uint16_t quantity = response[2] / 2U;
+        TEST_ASSERT_EQ(length, 5 + 2 * quantity);
+        TEST_ASSERT(quantity > previous && quantity <= QUANTITY_BASE + count);
+        previous = quantity;
+        answered++;
+    }
+    return answered;
+}
+
+int main(void)
+{
+    Sim_Boot();
+    Sim_Run_Ms(50);
+
+    Rx_Stats_t before, after;
+    Read_Stats(&before);
+    TEST_ASSERT_EQ(before.dropped, 0);
+    TEST_ASSERT_EQ(before.overflows, 0);
+
+    // Vừa đủ hàng đợi: mọi khung được trả lời, không khung nào bị bỏ
+    TEST_ASSERT_EQ(Burst(MODBUS_RX_QUEUE_DEPTH), MODBUS_RX_QUEUE_DEPTH);
+    Read_Stats(&after);
+    TEST_ASSERT_EQ(after.dropped, 0);
+    TEST_ASSERT_EQ(after.overflows, 0);
+    TEST_ASSERT(after.peak >= 2U && after.peak <= MODBUS_RX_QUEUE_DEPTH);
+
+    // Dồn nhiều hơn: mỗi khung hoặc được trả lời hoặc được đếm là tràn
+    uint32_t answered = Burst(BURST_MAX);
+    Read_Stats(&after);
+    TEST_ASSERT(answered >= MODBUS_RX_QUEUE_DEPTH && answered < BURST_MAX);
+    TEST_ASSERT_EQ(after.overflows, BURST_MAX - answered);
+    TEST_ASSERT_EQ(after.dropped, after.overflows);
+    TEST_ASSERT_EQ(after.peak, MODBUS_RX_QUEUE_DEPTH);
+
+    // Khung quá RX_BUFFER_SIZE: bỏ (đếm dropped, không phải tràn), khung kế tiếp vẫn bình thường
+    uint8_t oversize[RX_BUFFER_SIZE + 8];
+    for (uint16_t i = 0; i < sizeof(oversize); i++) {
+        oversize[i] = (i == 0) ? MODBUS_SLAVE_ADDRESS : (uint8_t)i;
+    }
+    Sim_Modbus_Send_Raw(oversize, sizeof(oversize));
+    uint8_t response[64];
+    TEST_ASSERT_EQ(Sim_Modbus_Receive(response, sizeof(response), SIM_MODBUS_TIMEOUT_MS), SIM_MODBUS_NO_RESPONSE);
+    Rx_Stats_t final;
+    Read_Stats(&final);
+    TEST_ASSERT_EQ(final.dropped, after.dropped + 1U);
+    TEST_ASSERT_EQ(final.overflows, after.overflows);
+
+    // Lỗi khung ở byte cuối: 7 byte đầu còn nằm trong vòng DMA bị bỏ khi khởi động lại phía nhận
+    uint8_t frame[8];
+    Build_Read(frame, 1);
+    Sim_Modbus_Send_Frame_Error(frame, sizeof(frame), sizeof(frame) - 1U);
+    TEST_ASSERT_EQ(Sim_Modbus_Receive(response, sizeof(response), SIM_MODBUS_TIMEOUT_MS), SIM_MODBUS_NO_RESPONSE);
+    Read_Stats(&final);
+    TEST_ASSERT_EQ(final.dropped, after.dropped + 2U);
+    TEST_ASSERT_EQ(final.overflows, after.overflows);
+
+    printf("queue depth %u: burst of %u answered %u, %u overflowed, peak %u slots\n",
+           (unsigned)MODBUS_RX_QUEUE_DEPTH, (unsigned)BURST_MAX, (unsigned)answered,
+           (unsigned)final.overflows, (unsigned)final.peak);
+    TEST_PASS();
+}
@@ -0,0 +1,99 @@
+/**
+ * @file Test_Modbus_Scan.c
+ * @brief Số giao dịch và thời gian bus cho một chu kỳ quét PLC (đọc 6 thanh ghi trạng thái, ghi
+ *        4 lệnh relay): FC3 + 4 x FC6 trước đây, FC3 + FC15 (coil) và một FC23
+ */
+#include "Test.h"
+#include "Sim.h"
+#include "ModbusMap.h"
+#include "UartModbus.h"
+
+#define STATUS_COUNT    (REG_SAFETY_ERROR_CODE - REG_SAFETY_SYSTEM_STATUS + 1)
+#define RELAY_COUNT     4U
+#define SCANS           10U
+
+typedef void (*Scan_t)(uint16_t *status, const uint16_t *relays);
+
+static void Scan_Fc6(uint16_t *status, const uint16_t *relays)
+{
+    TEST_ASSERT_EQ(Sim_Modbus_Read(3, REG_SAFETY_SYSTEM_STATUS, STATUS_COUNT, status), 0);
+    for (uint8_t i = 0; i < RELAY_COUNT; i++) {
+        TEST_ASSERT_EQ(Sim_Modbus_Write_Register(REG_RELAY1_CONTROL + i, relays[i]), 0);
+    }
+}
+
+static void Scan_Fc15(uint16_t *status, const uint16_t *relays)
+{
+    TEST_ASSERT_EQ(Sim_Modbus_Read(3, REG_SAFETY_SYSTEM_STATUS, STATUS_COUNT, status), 0);
+    uint8_t bits = 0;
+    for (uint8_t i = 0; i < RELAY_COUNT; i++) {
+        bits |= (uint8_t)((relays[i] ? 1U : 0U) << i);
+    }
+    uint8_t pdu[] = { 15, 0x00, 0x00, 0x00, RELAY_COUNT, 0x01, bits };
+    uint8_t response[16];
+    TEST_ASSERT_EQ(Sim_Modbus_Transact(pdu, sizeof(pdu), response, sizeof(response)), 8);
+    TEST_ASSERT_EQ(response[1], 15);
+}
+
+static void Scan_Fc23(uint16_t *status, const uint16_t *relays)
+{
+    uint8_t pdu[10 + 2 * RELAY_COUNT] = {
+        23, REG_SAFETY_SYSTEM_STATUS >> 8, REG_SAFETY_SYSTEM_STATUS & 0xFF, 0x00, STATUS_COUNT,
+        REG_RELAY1_CONTROL >> 8, REG_RELAY1_CONTROL & 0xFF, 0x00, RELAY_COUNT, 2U * RELAY_COUNT
+    };
+    for (uint8_t i = 0; i < RELAY_COUNT; i++) {
+        pdu[10 + 2 * i] = (uint8_t)(relays[i] >> 8);
+        pdu[11 + 2 * i] = (uint8_t)relays[i];
+    }
+    uint8_t response[64];
+    TEST_ASSERT_EQ(Sim_Modbus_Transact(pdu, sizeof(pdu), response, sizeof(response)), 5 + 2 * STATUS_COUNT);
+    TEST_ASSERT_EQ(response[1], 23);
+    TEST_ASSERT_EQ(response[2], 2 * STATUS_COUNT);
+    for (uint8_t i = 0; i < STATUS_COUNT; i++) {
+        status[i] = (uint16_t)((response[3 + 2 * i] << 8) | response[4 + 2 * i]);
+    }
+}
+
+// Chạy SCANS chu kỳ, RELAY2 đảo mỗi chu kỳ; trả số giao dịch mỗi chu kỳ
+static uint32_t Run_Scans(const char *name, Scan_t scan)
+{
+    uint16_t expected[STATUS_COUNT];
+    TEST_ASSERT_EQ(Sim_Modbus_Read(3, REG_SAFETY_SYSTEM_STATUS, STATUS_COUNT, expected), 0);
+
+    uint32_t frames = Sim_Modbus_Tx_Frame_Count();
+    uint64_t bus_ns = 0;
+    for (uint32_t n = 0; n < SCANS; n++) {
+        uint16_t relays[RELAY_COUNT] = { 0, (uint16_t)(n & 1U), 1, 0 };
+        uint16_t status[STATUS_COUNT];
+        uint64_t start = Sim_Now_Ns();
+        scan(status, relays);
+        bus_ns += Sim_Now_Ns() - start;
+        for (uint8_t i = 0; i < STATUS_COUNT; i++) {
+            TEST_ASSERT_EQ(status[i], expected[i]);
+        }
+        Sim_Run_Ms(5);
+        // Chỉ RELAY2 ra chân; Relay1_Control không chạm RELAY1 (safety logic)
+        TEST_ASSERT_EQ(Sim_Relay(2), relays[1]);
+        TEST_ASSERT_EQ(Sim_Relay(1), 0);
+    }
+    uint32_t per_scan = (Sim_Modbus_Tx_Frame_Count() - frames) / SCANS;
+    printf("  %-10s %u transactions, %.2f ms bus time per scan\n", name, (unsigned)per_scan,
+           bus_ns / 1e6 / SCANS);
+    return per_scan;
+}
+
+int main(void)
+{
+    Sim_Boot();
+    Sim_Run_Ms(50);
+
+    printf("PLC scan: read %u status registers, write %u relay commands\n", (unsigned)STATUS_COUNT,
+           (unsigned)RELAY_COUNT);
+    uint32_t fc6 = Run_Scans("FC3+4xFC6", Scan_Fc6);
+    uint32_t fc15 = Run_Scans("FC3+FC15", Scan_Fc15);
+    uint32_t fc23 = Run_Scans("FC23", Scan_Fc23);
+    TEST_ASSERT_EQ(fc6, 1U + RELAY_COUNT);
+    TEST_ASSERT_EQ(fc15, 2);
+    TEST_ASSERT_EQ(fc23, 1);
+    TEST_PASS();
+}
@@ -0,0 +1,91 @@
+/**
+ * @file Test_Param_Staging.c
+ * @brief Lệnh ghi khối tham số an toàn (0x0044-0x004C) qua bản nháp: bộ ngưỡng không tăng dần
+ *        (zone1 < zone2 < zone3 < zone4) bị từ chối bằng exception 3 và không thanh ghi nào đổi;
+ *        dời cả 4 ngưỡng bằng một FC16 được công bố nguyên vẹn ở chu kỳ safety kế tiếp
+ */
+#include "Test.h"
+#include "Sim.h"
+#include "ModbusMap.h"
+#include "Safety_Monitor.h"
+
+#define CODE_CLEAR          496U    // ~80 cm: ngoài vùng với ngưỡng mặc định, trong vùng 1 với s_far
+#define ZONE_COUNT          4U
+
+static const uint16_t s_default[ZONE_COUNT] = {
+    DEFAULT_SAFETY_ZONE1_THRESHOLD, DEFAULT_SAFETY_ZONE2_THRESHOLD,
+    DEFAULT_SAFETY_ZONE3_THRESHOLD, DEFAULT_SAFETY_ZONE4_THRESHOLD
+};
+static const uint16_t s_far[ZONE_COUNT] = { 100, 120, 140, 160 };
+
+static void Expect_Zones(const uint16_t *expected)
+{
+    uint16_t zones[ZONE_COUNT];
+    TEST_ASSERT_EQ(Sim_Modbus_Read(3, REG_SAFETY_ZONE1_THRESHOLD, ZONE_COUNT, zones), 0);
+    for (uint8_t z = 0; z < ZONE_COUNT; z++) {
+        TEST_ASSERT_EQ(zones[z], expected[z]);
+    }
+}
+
+int main(void)
+{
+    for (uint8_t ch = 0; ch < 4; ch++) {
+        Sim_Set_Analog_Code(ch, CODE_CLEAR);
+    }
+    Sim_Boot();
+    Sim_Run_Ms(50);
+    TEST_ASSERT_EQ(Sim_Modbus_Write_Register(REG_ANALOG_1_ENABLE, 1), 0);
+    Sim_Run_Ms(10);
+    TEST_ASSERT_EQ(Sim_Relay(1), 0);
+
+    // Từng FC6 theo thứ tự nào cũng đi qua một bộ không nhất quán: bị từ chối, không đổi gì
+    TEST_ASSERT_EQ(Sim_Modbus_Write_Register(REG_SAFETY_ZONE1_THRESHOLD, s_far[0]), 3);
+    TEST_ASSERT_EQ(Sim_Modbus_Write_Register(REG_SAFETY_ZONE4_THRESHOLD, DEFAULT_SAFETY_ZONE3_THRESHOLD), 3);
+    TEST_ASSERT_EQ(Sim_Modbus_Write_Register(REG_SAFETY_ZONE2_THRESHOLD, DEFAULT_SAFETY_ZONE1_THRESHOLD), 3);
+    Expect_Zones(s_default);
+
+    // FC16 bộ không tăng dần, và bộ đúng thứ tự nhưng chu kỳ safety sai: cả lệnh bị từ chối
+    uint16_t swapped[ZONE_COUNT] = { s_far[0], s_far[2], s_far[1], s_far[3] };
+    TEST_ASSERT_EQ(Sim_Modbus_Write_Registers(REG_SAFETY_ZONE1_THRESHOLD, ZONE_COUNT, swapped), 3);
+    uint16_t with_period[REG_SAFETY_LOOP_PERIOD - REG_SAFETY_ZONE1_THRESHOLD + 1] = {
+        s_far[0], s_far[1], s_far[2], s_far[3], DEFAULT_PROXIMITY_THRESHOLD, DEFAULT_SAFETY_RESPONSE_TIME,
+        DEFAULT_AUTO_RESET_ENABLE, DEFAULT_SAFETY_MODE, SAFETY_LOOP_PERIOD_MAX_MS + 1U
+    };
+    TEST_ASSERT_EQ(Sim_Modbus_Write_Registers(REG_SAFETY_ZONE1_THRESHOLD, sizeof(with_period) / 2U, with_period), 3);
+    Expect_Zones(s_default);
+
+    // FC23 ghi bộ sai: exception 3, không trả dữ liệu đọc, không ghi
+    uint8_t fc23[] = { 23, REG_SAFETY_ZONE1_THRESHOLD >> 8, REG_SAFETY_ZONE1_THRESHOLD & 0xFF, 0x00, ZONE_COUNT,
+                       REG_SAFETY_ZONE2_THRESHOLD >> 8, REG_SAFETY_ZONE2_THRESHOLD & 0xFF, 0x00, 0x01, 0x02,
+                       0x00, DEFAULT_SAFETY_ZONE1_THRESHOLD };
+    uint8_t response[64];
+    TEST_ASSERT_EQ(Sim_Modbus_Transact(fc23, sizeof(fc23), response, sizeof(response)), 5);
+    TEST_ASSERT_EQ(response[1], 23 | 0x80);
+    TEST_ASSERT_EQ(response[2], 3);
+    Expect_Zones(s_default);
+    Sim_Run_Ms(10);
+    TEST_ASSERT_EQ(Sim_Relay(1), 0);
+
+    // Cả 4 ngưỡng trong một FC16: công bố nguyên bộ, AI1 ở ~80 cm giờ nằm trong vùng 1
+    TEST_ASSERT_EQ(Sim_Modbus_Write_Registers(REG_SAFETY_ZONE1_THRESHOLD, ZONE_COUNT, s_far), 0);
+    Expect_Zones(s_far);
+    Sim_Run_Ms(5);
+    TEST_ASSERT_EQ(Sim_Relay(1), 1);
+
+    // Lệnh đơn nhất quán với bộ mới được nhận; lệnh đơn phá thứ tự thì không
+    TEST_ASSERT_EQ(Sim_Modbus_Write_Register(REG_SAFETY_ZONE4_THRESHOLD, s_far[3] + 10U), 0);
+    TEST_ASSERT_EQ(Sim_Modbus_Write_Register(REG_SAFETY_ZONE1_THRESHOLD, s_far[1]), 3);
+
+    // Dời về mặc định bằng một FC16, rồi reset: relay nhả và giữ nhả
+    TEST_ASSERT_EQ(Sim_Modbus_Write_Registers(REG_SAFETY_ZONE1_THRESHOLD, ZONE_COUNT, s_default), 0);
+    Expect_Zones(s_default);
+    Sim_Run_Ms(5);
+    TEST_ASSERT_EQ(Sim_Modbus_Write_Register(REG_RESET_FLAG, 0), 0);
+    Sim_Run_Ms(10);
+    TEST_ASSERT_EQ(Sim_Relay(1), 0);
+
+    uint16_t error_code = 0;
+    TEST_ASSERT_EQ(Sim_Modbus_Read(3, REG_SAFETY_ERROR_CODE, 1, &error_code), 0);
+    TEST_ASSERT_EQ(error_code & SAFETY_ERROR_PARAMETERS, 0);
+    TEST_PASS();
+}
@@ -0,0 +1,142 @@
+/**
+ * @file Test_Reaction_Sweep.c
+ * @brief Quét thời điểm AI1 vào vùng 1 / sườn DI1 theo pha so với nửa bộ đệm ADC và chu kỳ safety:
+ *        thời gian phản ứng đo trong mô phỏng (từ lúc đổi đầu vào đến RELAY1) so với số firmware báo
+ *        (Reaction_Last) và phân bố Reaction_Histogram. AI1 quét thêm lần nữa với trung bình trượt
+ *        FILTER_WINDOW mẫu: cắt nhanh so trên mã chưa lọc nên không chậm hơn lần không lọc
+ * @note Chạy với firmware (cắt nhanh trong ISR) và firmware_no_fast_trip (chỉ vòng safety)
+ */
+#include "Test.h"
+#include "Sim.h"
+#include "ModbusMap.h"
+#include "Safety_Monitor.h"
+
+#define CODE_CLEAR          496U    // ~80 cm, ngoài mọi vùng
+#define CODE_ZONE1          1656U   // ~20 cm, vùng 1 (CRITICAL)
+#define SWEEP_STEPS         20U
+#define SWEEP_STEP_US       (2U * ADC_HALF_BUFFER_US / SWEEP_STEPS)
+#define POLL_US             10U
+#define TIMEOUT_US          100000U
+#define FILTER_WINDOW       16U
+
+typedef struct {
+    uint64_t min_ns;
+    uint64_t max_ns;
+    uint64_t sum_ns;
+    uint32_t reported_max_us;
+    uint32_t count;
+} Sweep_Stats_t;
+
+static uint32_t Read_U32(uint16_t address)
+{
+    uint16_t words[2];
+    TEST_ASSERT_EQ(Sim_Modbus_Read(4, address, 2, words), 0);
+    return ((uint32_t)words[0] << 16) | words[1];
+}
+
+static void Reset_Trip(void)
+{
+    TEST_ASSERT_EQ(Sim_Modbus_Write_Register(REG_RESET_FLAG, 0), 0);
+    Sim_Run_Ms(5);
+    TEST_ASSERT_EQ(Sim_Relay(1), 0);
+}
+
+// Đổi đầu vào (set), chờ RELAY1 cắt, cộng thời gian thật (ns) và số firmware báo vào stats
+static void Trip_Once(void (*set)(uint8_t active), Sweep_Stats_t *stats)
+{
+    uint64_t start = Sim_Now_Ns();
+    set(1);
+    uint32_t waited = 0;
+    while (Sim_Relay(1) == 0 && waited < TIMEOUT_US) {
+        Sim_Run_Us(POLL_US);
+        waited += POLL_US;
+    }
+    TEST_ASSERT_EQ(Sim_Relay(1), 1);
+    uint64_t reaction = Sim_Now_Ns() - start;
+    set(0);
+    Sim_Run_Ms(20);
+
+    uint32_t reported = Read_U32(INPUT_REG_REACTION_BASE + 2U);
+    TEST_ASSERT(reported < DEFAULT_SAFETY_RESPONSE_TIME * 1000U);
+    if (stats->count == 0 || reaction < stats->min_ns) stats->min_ns = reaction;
+    if (reaction > stats->max_ns) stats->max_ns = reaction;
+    if (reported > stats->reported_max_us) stats->reported_max_us = reported;
+    stats->sum_ns += reaction;
+    stats->count++;
+    Reset_Trip();
+}
+
+static void Set_Analog(uint8_t active)
+{
+    Sim_Set_Analog_Code(0, active ? CODE_ZONE1 : CODE_CLEAR);
+}
+
+static void Set_Digital(uint8_t active)
+{
+    Sim_Set_Digital(0, active);
+}
+
+// Trả thời gian phản ứng xấu nhất (ns)
+static uint64_t Sweep(const char *name, void (*set)(uint8_t active))
+{
+    Sweep_Stats_t stats = {0};
+    for (uint32_t step = 0; step < SWEEP_STEPS; step++) {
+        Sim_Run_Us(SWEEP_STEP_US * step + 1U);
+        Trip_Once(set, &stats);
+    }
+    // Trong ngân sách mặc định, kể cả trường hợp xấu nhất của phép quét
+    TEST_ASSERT(stats.max_ns < DEFAULT_SAFETY_RESPONSE_TIME * SIM_NS_PER_MS);
+    printf("  %-6s input->RELAY1 min %7.1f avg %7.1f max %7.1f us, firmware worst %5u us\n", name,
+           stats.min_ns / 1e3, stats.sum_ns / 1e3 / stats.count, stats.max_ns / 1e3,
+           (unsigned)stats.reported_max_us);
+    return stats.max_ns;
+}
+
+int main(void)
+{
+    for (uint8_t ch = 0; ch < 4; ch++) {
+        Sim_Set_Analog_Code(ch, CODE_CLEAR);
+        Sim_Set_Digital(ch, 0);
+    }
+    Sim_Boot();
+    Sim_Run_Ms(50);
+    TEST_ASSERT_EQ(Sim_Modbus_Write_Register(REG_ANALOG_1_ENABLE, 1), 0);
+    TEST_ASSERT_EQ(Sim_Modbus_Write_Register(REG_DI1_ACTIVE_LEVEL, 1), 0);
+    Sim_Run_Ms(20);
+
+    printf("%s, %u steps of %u us:\n", SAFETY_FAST_TRIP_ENABLE ? "fast trip in ISR" : "safety loop only",
+           (unsigned)SWEEP_STEPS, (unsigned)SWEEP_STEP_US);
+    uint64_t unfiltered_ns = Sweep("AI1", Set_Analog);
+
+    TEST_ASSERT_EQ(Sim_Modbus_Write_Register(REG_ANALOG_1_FILTER_TYPE, 1), 0);
+    TEST_ASSERT_EQ(Sim_Modbus_Write_Register(REG_ANALOG_1_FILTER_PARAM, FILTER_WINDOW), 0);
+    Sim_Run_Ms(20);
+    uint64_t filtered_ns = Sweep("AI1/16", Set_Analog);
+#if SAFETY_FAST_TRIP_ENABLE
+    TEST_ASSERT(filtered_ns <= unfiltered_ns);
+#else
+    (void)unfiltered_ns;
+    (void)filtered_ns;
+#endif
+    TEST_ASSERT_EQ(Sim_Modbus_Write_Register(REG_ANALOG_1_FILTER_TYPE, 0), 0);
+
+    TEST_ASSERT_EQ(Sim_Modbus_Write_Register(REG_ANALOG_1_ENABLE, 0), 0);
+    TEST_ASSERT_EQ(Sim_Modbus_Write_Register(REG_DI1_ENABLE, 1), 0);
+    Sim_Run_Ms(20);
+    Sweep("DI1", Set_Digital);
+
+    // Mỗi lần cắt một mẫu trong histogram, không lần nào vượt ngân sách
+    uint16_t hist[REACTION_HIST_BUCKETS];
+    TEST_ASSERT_EQ(Sim_Modbus_Read(4, INPUT_REG_REACTION_BASE + 8U, REACTION_HIST_BUCKETS, hist), 0);
+    uint32_t total = 0;
+    printf("  histogram:");
+    for (uint8_t i = 0; i < REACTION_HIST_BUCKETS; i++) {
+        printf(" <%uus:%u", (unsigned)(REACTION_HIST_BASE_US << i), hist[i]);
+        total += hist[i];
+    }
+    printf("\n");
+    TEST_ASSERT_EQ(total, 3U * SWEEP_STEPS);
+    TEST_ASSERT_EQ(Read_U32(INPUT_REG_REACTION_BASE), 3U * SWEEP_STEPS);
+    TEST_ASSERT_EQ(Read_U32(INPUT_REG_REACTION_BASE + 6U), 0);
+    TEST_PASS();
+}
@@ -0,0 +1,107 @@
+/**
+ * @file Test_Register_Map.c
+ * @brief Bảng mô tả holding register: chỉ địa chỉ được định nghĩa đọc được (mỗi ô lưu trữ đúng một
+ *        địa chỉ), khoảng trống và ghi vào thanh ghi chỉ đọc trả exception 2, giá trị ngoài [min, max]
+ *        trả exception 3 - cả hai trường hợp không thanh ghi nào của lệnh bị ghi
+ */
+#include "Test.h"
+#include "Sim.h"
+#include "ModbusMap.h"
+#include "UartModbus.h"
+
+#define SCAN_END    0x0200U     // Quét quá REG_SNAPSHOT_LAST một đoạn
+
+// Đọc một thanh ghi: 1 nếu đọc được, 0 nếu exception 2
+static uint8_t Readable(uint16_t addr)
+{
+    uint16_t value;
+    int result = Sim_Modbus_Read(3, addr, 1, &value);
+    TEST_ASSERT(result == 0 || result == 2);
+    return result == 0;
+}
+
+static uint16_t Read_One(uint16_t addr)
+{
+    uint16_t value = 0;
+    TEST_ASSERT_EQ(Sim_Modbus_Read(3, addr, 1, &value), 0);
+    return value;
+}
+
+int main(void)
+{
+    Sim_Boot();
+    Sim_Run_Ms(50);
+
+    // Toàn bộ không gian địa chỉ: số địa chỉ đọc được bằng số ô lưu trữ, khoảng trống trả exception 2
+    uint32_t readable = 0;
+    for (uint16_t addr = 0; addr < SCAN_END; addr++) {
+        readable += Readable(addr);
+    }
+    TEST_ASSERT_EQ(readable, HOLDING_REG_STORAGE);
+    const uint16_t gaps[] = { 0x0006, 0x000F, 0x002F, 0x0038, 0x003F, 0x004D, 0x004F, 0x00E4, 0x00FF,
+                              0x010C, 0x010F, REG_SNAPSHOT_LAST + 1 };
+    for (uint8_t i = 0; i < sizeof(gaps) / sizeof(gaps[0]); i++) {
+        TEST_ASSERT_EQ(Readable(gaps[i]), 0);
+        TEST_ASSERT_EQ(Sim_Modbus_Write_Register(gaps[i], 0), 2);
+    }
+    // Đọc nhiều thanh ghi vắt qua khoảng trống
+    uint16_t values[8];
+    TEST_ASSERT_EQ(Sim_Modbus_Read(3, REG_RESET_FLAG, 4, values), 2);
+    TEST_ASSERT_EQ(Sim_Modbus_Read(3, REG_SAFETY_LOOP_PERIOD, 2, values), 2);
+
+    // Thanh ghi chỉ đọc
+    const uint16_t read_only[] = { REG_SAFETY_SYSTEM_STATUS, REG_SAFETY_ERROR_CODE, REG_ANALOG_INPUT_1,
+                                   REG_DI1_STATUS, REG_FIRMWARE_VERSION, REG_SYSTEM_ERROR,
+                                   REG_SNAPSHOT_SEQUENCE };
+    for (uint8_t i = 0; i < sizeof(read_only) / sizeof(read_only[0]); i++) {
+        uint16_t before = Read_One(read_only[i]);
+        TEST_ASSERT_EQ(Sim_Modbus_Write_Register(read_only[i], (uint16_t)(before + 1U)), 2);
+        if (read_only[i] == REG_FIRMWARE_VERSION) {
+            TEST_ASSERT_EQ(Read_One(read_only[i]), before);
+        }
+    }
+
+    // Ngoài [min, max]: exception 3, giá trị cũ giữ nguyên
+    typedef struct { uint16_t addr; uint16_t value; } Bad_Write_t;
+    const Bad_Write_t bad[] = {
+        { REG_SAFETY_ZONE1_THRESHOLD, LIMIT_SAFETY_THRESHOLD_MAX + 1 },
+        { REG_PROXIMITY_THRESHOLD,    0xFFFF },
+        { REG_SAFETY_RESPONSE_TIME,   0 },
+        { REG_SAFETY_RESPONSE_TIME,   LIMIT_SAFETY_RESPONSE_TIME_MAX + 1 },
+        { REG_SAFETY_MODE,            5 },
+        { REG_SAFETY_LOOP_PERIOD,     0 },
+        { REG_DI_DEBOUNCE_TIME,       LIMIT_DI_DEBOUNCE_MAX + 1 },
+        { REG_DI1_ENABLE,             2 },
+        { REG_RESET_FLAG,             2 },
+        { REG_DEVICE_ID,              0 },
+        { REG_CONFIG_BAUDRATE,        6 },
+    };
+    for (uint8_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+        uint16_t before = Read_One(bad[i].addr);
+        TEST_ASSERT_EQ(Sim_Modbus_Write_Register(bad[i].addr, bad[i].value), 3);
+        TEST_ASSERT_EQ(Read_One(bad[i].addr), before);
+    }
+
+    // FC16: một giá trị sai hoặc một địa chỉ chỉ đọc làm hỏng cả lệnh - thanh ghi hợp lệ đứng trước cũng không bị ghi
+    uint16_t response_before = Read_One(REG_SAFETY_RESPONSE_TIME);
+    uint16_t block[] = { (uint16_t)(response_before + 5U), 1, 9 };     // Response time, auto reset, mode = 9
+    TEST_ASSERT_EQ(Sim_Modbus_Write_Registers(REG_SAFETY_RESPONSE_TIME, 3, block), 3);
+    TEST_ASSERT_EQ(Read_One(REG_SAFETY_RESPONSE_TIME), response_before);
+    TEST_ASSERT_EQ(Read_One(REG_AUTO_RESET_ENABLE), DEFAULT_AUTO_RESET_ENABLE);
+    uint16_t across[] = { 1, 0, 0 };        // 0x010A-0x010B ghi được, 0x010C là khoảng trống
+    TEST_ASSERT_EQ(Sim_Modbus_Write_Registers(REG_CONFIG_ERASE_COMMAND - 1, 3, across), 2);
+    uint16_t onto_status[] = { 1, 0 };      // REG_RESET_FLAG rồi REG_SAFETY_ERROR_CODE (chỉ đọc)
+    TEST_ASSERT_EQ(Sim_Modbus_Write_Registers(REG_PROXIMITY_ALERT_STATUS + 1, 2, onto_status), 2);
+
+    // Số có dấu: offset nhận cả giá trị âm
+    TEST_ASSERT_EQ(Sim_Modbus_Write_Register(REG_ANALOG_1_OFFSET, (uint16_t)-250), 0);
+    TEST_ASSERT_EQ(Read_One(REG_ANALOG_1_OFFSET), (uint16_t)-250);
+
+    // Giá trị biên hợp lệ vẫn ghi được
+    TEST_ASSERT_EQ(Sim_Modbus_Write_Register(REG_DI_DEBOUNCE_TIME, LIMIT_DI_DEBOUNCE_MAX), 0);
+    TEST_ASSERT_EQ(Read_One(REG_DI_DEBOUNCE_TIME), LIMIT_DI_DEBOUNCE_MAX);
+
+    printf("%u of %u holding addresses defined, %u bytes of storage (300-entry array: 600)\n",
+           (unsigned)readable, (unsigned)SCAN_END, (unsigned)sizeof(g_holdingRegisters));
+    TEST_PASS();
+}
@@ -0,0 +1,77 @@
+/**
+ * @file Test_Sim_Smoke.c
+ * @brief Khởi động firmware trên bộ mô phỏng: cấu hình qua Modbus, kích DI/analog, kiểm tra RELAY1
+ */
+#include "Test.h"
+#include "Sim.h"
+#include "ModbusMap.h"
+
+/* Luật lũy thừa mặc định: 27,86 * V^-1,15 (cm) */
+#define CODE_CLEAR      496U    // ~0,40 V -> ~80 cm, ngoài mọi vùng
+#define CODE_ZONE1      1656U   // ~1,33 V -> ~20 cm, vùng 1 (CRITICAL)
+
+static void Reset_Trip(void)
+{
+    TEST_ASSERT_EQ(Sim_Modbus_Write_Register(REG_RESET_FLAG, 0), 0);
+    Sim_Run_Ms(5);
+}
+
+int main(void)
+{
+    for (uint8_t ch = 0; ch < 4; ch++) {
+        Sim_Set_Analog_Code(ch, CODE_CLEAR);
+        Sim_Set_Digital(ch, 0);
+    }
+    Sim_Boot();
+    Sim_Run_Ms(50);
+
+    uint16_t value = 0;
+    TEST_ASSERT_EQ(Sim_Modbus_Read(3, REG_DEVICE_ID, 1, &value), 0);
+    TEST_ASSERT_EQ(value, DEFAULT_DEVICE_ID);
+    TEST_ASSERT_EQ(Sim_Relay(1), 0);
+
+    /* DI1 tích cực mức cao: sườn lên cắt RELAY1, chốt đến khi master xóa REG_RESET_FLAG */
+    TEST_ASSERT_EQ(Sim_Modbus_Write_Register(REG_DI1_ACTIVE_LEVEL, 1), 0);
+    TEST_ASSERT_EQ(Sim_Modbus_Write_Register(REG_DI1_ENABLE, 1), 0);
+    Sim_Run_Ms(20);
+    TEST_ASSERT_EQ(Sim_Relay(1), 0);
+
+    Sim_Set_Digital(0, 1);
+    Sim_Run_Ms(DEFAULT_DI_DEBOUNCE_TIME + 5);
+    TEST_ASSERT_EQ(Sim_Relay(1), 1);
+    TEST_ASSERT_EQ(Sim_Modbus_Read(3, REG_RESET_FLAG, 1, &value), 0);
+    TEST_ASSERT_EQ(value, 1);
+
+    Sim_Set_Digital(0, 0);
+    Sim_Run_Ms(DEFAULT_DI_DEBOUNCE_TIME + 5);
+    TEST_ASSERT_EQ(Sim_Relay(1), 1);
+    Reset_Trip();
+    TEST_ASSERT_EQ(Sim_Relay(1), 0);
+    TEST_ASSERT_EQ(Sim_Modbus_Write_Register(REG_DI1_ENABLE, 0), 0);
+
+    /* AI1 vào vùng 1 */
+    TEST_ASSERT_EQ(Sim_Modbus_Write_Register(REG_ANALOG_1_ENABLE, 1), 0);
+    Sim_Run_Ms(20);
+    TEST_ASSERT_EQ(Sim_Relay(1), 0);
+    TEST_ASSERT_EQ(Sim_Modbus_Read(3, REG_SNAPSHOT_ANALOG_1, 1, &value), 0);
+    TEST_ASSERT(value >= 75 && value <= 85);
+
+    Sim_Set_Analog_Code(0, CODE_ZONE1);
+    Sim_Run_Ms(5);
+    TEST_ASSERT_EQ(Sim_Relay(1), 1);
+
+    Sim_Set_Analog_Code(0, CODE_CLEAR);
+    Sim_Run_Ms(5);
+    Reset_Trip();
+    TEST_ASSERT_EQ(Sim_Relay(1), 0);
+
+    /* Vòng safety 1 ms không trễ hạn lần nào */
+    uint16_t overrun[2];
+    TEST_ASSERT_EQ(Sim_Modbus_Read(4, INPUT_REG_LOOP_OVERRUN, 2, overrun), 0);
+    TEST_ASSERT_EQ(overrun[0], 0);
+    TEST_ASSERT_EQ(overrun[1], 0);
+
+    /* Mã exception: địa chỉ không tồn tại */
+    TEST_ASSERT_EQ(Sim_Modbus_Read(3, 0x0F00, 1, &value), 2);
+    TEST_PASS();
+}
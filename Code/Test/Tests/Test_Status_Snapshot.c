@@ -0,0 +1,107 @@
+/**
+ * @file Test_Status_Snapshot.c
+ * @brief Khối snapshot 0x0110 (một FC3, 14 thanh ghi): số thứ tự tăng mỗi chu kỳ safety, khớp với
+ *        các thanh ghi rời khi đầu vào đứng yên, và mỗi lần đọc là một chu kỳ trọn vẹn khi AI1/DI1
+ *        đổi liên tục (khoảng cách và trạng thái vùng của cùng kênh luôn khớp nhau)
+ * @note Chạy với firmware (phân vùng theo mã thô) và firmware_classify_distance
+ */
+#include "Test.h"
+#include "Sim.h"
+#include "ModbusMap.h"
+#include "Safety_Monitor.h"
+
+#define CODE_CLEAR          496U    // ~80 cm, ngoài mọi vùng
+#define CODE_ZONE1          1656U   // ~20 cm, vùng 1 (CRITICAL)
+#define POLLS               200U
+#define SNAP(reg)           (snapshot[(reg) - REG_SNAPSHOT_BASE])
+
+// AI1 đổi giữa vùng 1 và ngoài vùng mỗi ms: đọc rời giữa hai chu kỳ sẽ ghép sai khoảng cách/trạng thái
+static uint16_t Square_Source(uint8_t channel, uint64_t time_ns, void *context)
+{
+    (void)channel;
+    (void)context;
+    return ((time_ns / SIM_NS_PER_MS) & 1U) ? CODE_ZONE1 : CODE_CLEAR;
+}
+
+static void Read_Snapshot(uint16_t *snapshot)
+{
+    TEST_ASSERT_EQ(Sim_Modbus_Read(3, REG_SNAPSHOT_BASE, REG_SNAPSHOT_COUNT, snapshot), 0);
+}
+
+int main(void)
+{
+    for (uint8_t ch = 0; ch < 4; ch++) {
+        Sim_Set_Analog_Code(ch, CODE_CLEAR);
+        Sim_Set_Digital(ch, 0);
+    }
+    Sim_Boot();
+    Sim_Run_Ms(50);
+    TEST_ASSERT_EQ(Sim_Modbus_Write_Register(REG_ANALOG_1_ENABLE, 1), 0);
+    TEST_ASSERT_EQ(Sim_Modbus_Write_Register(REG_DI1_ACTIVE_LEVEL, 1), 0);
+    TEST_ASSERT_EQ(Sim_Modbus_Write_Register(REG_DI1_ENABLE, 1), 0);
+    Sim_Run_Ms(20);
+
+    // Đầu vào đứng yên: snapshot trùng các thanh ghi rời
+    uint16_t snapshot[REG_SNAPSHOT_COUNT];
+    uint16_t status[REG_SAFETY_ERROR_CODE + 1];
+    uint16_t analog, di[4];
+    Read_Snapshot(snapshot);
+    TEST_ASSERT_EQ(Sim_Modbus_Read(3, REG_SAFETY_SYSTEM_STATUS, REG_SAFETY_ERROR_CODE + 1, status), 0);
+    TEST_ASSERT_EQ(Sim_Modbus_Read(3, REG_ANALOG_INPUT_1, 1, &analog), 0);
+    TEST_ASSERT_EQ(Sim_Modbus_Read(3, REG_DI1_STATUS, 4, di), 0);
+    TEST_ASSERT_EQ(SNAP(REG_SNAPSHOT_SYSTEM_STATUS), status[REG_SAFETY_SYSTEM_STATUS]);
+    TEST_ASSERT_EQ(SNAP(REG_SNAPSHOT_RESET_FLAG), status[REG_RESET_FLAG]);
+    TEST_ASSERT_EQ(SNAP(REG_SNAPSHOT_ERROR_CODE), status[REG_SAFETY_ERROR_CODE]);
+    TEST_ASSERT_EQ(SNAP(REG_SNAPSHOT_ANALOG_1), analog);
+    TEST_ASSERT(analog > DEFAULT_SAFETY_ZONE4_THRESHOLD);
+    for (uint8_t i = 0; i < 4; i++) {
+        TEST_ASSERT_EQ((SNAP(REG_SNAPSHOT_DI_STATE) >> i) & 1U, di[i]);
+    }
+
+    // Số thứ tự: một lần mỗi chu kỳ safety (DEFAULT_SAFETY_LOOP_PERIOD ms)
+    // (hai lần đọc cùng độ dài nên khoảng cách giữa hai lần chụp bằng khoảng cách giữa hai lần gửi)
+    uint64_t start = Sim_Now_Ns();
+    Read_Snapshot(snapshot);
+    uint16_t first = SNAP(REG_SNAPSHOT_SEQUENCE);
+    Sim_Run_Ms(100);
+    uint32_t elapsed_ms = (uint32_t)((Sim_Now_Ns() - start) / SIM_NS_PER_MS);
+    Read_Snapshot(snapshot);
+    uint16_t cycles = (uint16_t)(SNAP(REG_SNAPSHOT_SEQUENCE) - first);
+    uint32_t expected = elapsed_ms / DEFAULT_SAFETY_LOOP_PERIOD;
+    TEST_ASSERT(cycles + 1U >= expected && cycles <= expected + 1U);
+
+    // Đầu vào đổi liên tục, đọc ở nhiều pha: mỗi snapshot tự nhất quán
+    Sim_Set_Analog_Source(0, Square_Source, NULL);
+    uint16_t previous = SNAP(REG_SNAPSHOT_SEQUENCE);
+    uint32_t critical = 0;
+    uint32_t clear = 0;
+    for (uint32_t n = 0; n < POLLS; n++) {
+        Sim_Set_Digital(0, (uint8_t)((n / 3U) & 1U));
+        Sim_Run_Us(137U * (n % 11U) + 50U);
+        Read_Snapshot(snapshot);
+
+        uint16_t sequence = SNAP(REG_SNAPSHOT_SEQUENCE);
+        TEST_ASSERT((int16_t)(sequence - previous) > 0);
+        previous = sequence;
+
+        uint16_t distance = SNAP(REG_SNAPSHOT_ANALOG_1);
+        uint8_t ai1_status = SNAP(REG_SNAPSHOT_ANALOG_STATUS) & 0x0FU;
+        if (ai1_status != SENSOR_STATUS_ERROR) {
+            TEST_ASSERT_EQ(ai1_status == SENSOR_STATUS_CRITICAL, distance <= DEFAULT_SAFETY_ZONE1_THRESHOLD);
+            if (ai1_status == SENSOR_STATUS_CRITICAL) critical++; else clear++;
+        }
+        uint8_t di1_state = SNAP(REG_SNAPSHOT_DI_STATE) & 1U;
+        uint8_t di1_status = SNAP(REG_SNAPSHOT_DI_STATUS) & 0x0FU;
+        TEST_ASSERT_EQ(di1_state, di1_status == SENSOR_STATUS_CRITICAL);
+        // Vùng 1 hoặc DI1 tác động trong cùng chu kỳ: relay đã cắt, cờ reset đã set
+        if (ai1_status == SENSOR_STATUS_CRITICAL || di1_state) {
+            TEST_ASSERT_EQ(SNAP(REG_SNAPSHOT_RESET_FLAG), 1);
+        }
+    }
+    TEST_ASSERT(critical > POLLS / 4U && clear > POLLS / 4U);
+
+    printf("%s: %u cycles in %u ms, %u polls consistent (%u in zone 1, %u clear)\n",
+           SAFETY_CLASSIFY_RAW_CODE ? "raw-code classify" : "distance classify", (unsigned)cycles,
+           (unsigned)elapsed_ms, (unsigned)POLLS, (unsigned)critical, (unsigned)clear);
+    TEST_PASS();
+}